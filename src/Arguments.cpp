@@ -113,6 +113,8 @@ Arguments::Arguments() :
 	        "  pack             Pack files from directory to FS archive\n"
 	        "  export-texts     Export texts to CSV from FIELD/WORLD FS archive\n"
 	        "  import-texts     Import texts from a CSV file to existing FIELD/WORLD FS archive\n"
+	        "  export-backgrounds Export field backgrounds to PNG files from FIELD FS archive\n"
+	        "  check-text-layout Check that the texts of FIELD FS archive fit on screen\n"
 	        "\n"
 	        "\"%1 unpack --help\" to see help of the specific subcommand"
 	    ).arg(QFileInfo(qApp->arguments().first()).fileName())
@@ -142,6 +144,10 @@ void Arguments::parse()
 		_command = Unpack;
 	} else if (command == "pack") {
 		_command = Pack;
+	} else if (command == "export-backgrounds") {
+		_command = ExportBackgrounds;
+	} else if (command == "check-text-layout") {
+		_command = CheckTextLayout;
 	} else {
 		qWarning() << qPrintable(QCoreApplication::translate("Arguments", "Unknown command type:")) << qPrintable(command);
 		return;
@@ -60,7 +60,9 @@ public:
 		Export,
 		Import,
 		Unpack,
-		Pack
+		Pack,
+		ExportBackgrounds,
+		CheckTextLayout
 	};
 	Arguments();
 	inline Command command() const {
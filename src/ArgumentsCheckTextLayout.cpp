@@ -0,0 +1,63 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "ArgumentsCheckTextLayout.h"
+
+ArgumentsCheckTextLayout::ArgumentsCheckTextLayout() : CommonArguments()
+{
+	_ADD_ARGUMENT(_OPTION_NAMES("j", "jobs"), "Number of fields measured in parallel (default: number of CPU cores).", "jobs", "");
+
+	_parser.addPositionalArgument("archive", QCoreApplication::translate("ArgumentsCheckTextLayout", "Input Field FS archive."));
+
+	parse();
+}
+
+int ArgumentsCheckTextLayout::jobs() const
+{
+	QString value = _parser.value("jobs");
+
+	if (value.isEmpty()) {
+		return qMax(1, QThread::idealThreadCount());
+	}
+
+	bool ok;
+	int jobs = value.toInt(&ok);
+
+	if (!ok || jobs < 1) {
+		qWarning() << qPrintable(
+		    QCoreApplication::translate("Arguments", "Error: jobs must be a positive number"));
+		exit(1);
+	}
+
+	return jobs;
+}
+
+void ArgumentsCheckTextLayout::parse()
+{
+	_parser.process(*qApp);
+
+	if (_parser.positionalArguments().size() > 2) {
+		qWarning() << qPrintable(
+		    QCoreApplication::translate("Arguments", "Error: too much parameters"));
+		exit(1);
+	}
+
+	QStringList paths = wilcardParse();
+	if (paths.size() == 1) {
+		_path = paths.first();
+	}
+}
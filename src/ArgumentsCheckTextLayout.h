@@ -18,21 +18,13 @@
 #pragma once
 
 #include <QtCore>
+#include "Arguments.h"
 
-class FieldArchive;
-class Field;
-
-class FieldThread : public QThread
+class ArgumentsCheckTextLayout : public CommonArguments
 {
-	Q_OBJECT
 public:
-	explicit FieldThread(QObject *parent = nullptr)
-		: QThread(parent), fieldArchive(nullptr), field(nullptr) { }
-	void run();
-	void setData(FieldArchive *fieldArchive, Field *field);
-signals:
-	void background(QImage);
+	ArgumentsCheckTextLayout();
+	int jobs() const;
 private:
-	FieldArchive *fieldArchive;
-	Field *field;
+	void parse();
 };
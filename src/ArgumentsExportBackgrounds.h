@@ -15,29 +15,20 @@
  ** You should have received a copy of the GNU General Public License
  ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ****************************************************************************/
+#pragma once
 
-#include "FieldThread.h"
-#include "FF8Image.h"
-#include "FieldArchive.h"
-#include "Field.h"
+#include <QtCore>
+#include "Arguments.h"
 
-void FieldThread::run()
+class ArgumentsExportBackgrounds : public CommonArguments
 {
-	qDebug() << "thread started";
-
-	if (fieldArchive && field && fieldArchive->openBG(field)
-            && field->hasBackgroundFile()) {
-		qDebug() << "field opened";
-		QImage bg = field->getBackgroundFile()->background();
-		qDebug() << "background generated";
-        emit background(bg);
-    } else {
-		emit background(FF8Image::errorImage());
-    }
-}
-
-void FieldThread::setData(FieldArchive *fieldArchive, Field *field)
-{
-	this->fieldArchive = fieldArchive;
-	this->field = field;
-}
+public:
+	ArgumentsExportBackgrounds();
+	int jobs() const;
+	inline QString destination() const {
+		return _directory;
+	}
+private:
+	void parse();
+	QString _directory;
+};
@@ -21,6 +21,7 @@ ArgumentsPack::ArgumentsPack() : ArgumentsPackUnpack()
 	_ADD_FLAG(_OPTION_NAMES("f", "force"),
 	          "Overwrite destination file if exists.");
 	_ADD_ARGUMENT(_OPTION_NAMES("c", "compression"), "Compression format ([lzs], lz4, none).", "compression-format", "lzs");
+	_ADD_ARGUMENT("lzs-level", "LZS compression effort (fast, [normal], best).", "lzs-level", "normal");
 	_ADD_ARGUMENT("prefix", "Custom directory prefix inside the target archive (default \"c:\\ff8\\data\\\")", "prefix", "c:\\ff8\\data\\");
 
 	_parser.addPositionalArgument("directory", QCoreApplication::translate("ArgumentsPack", "Input directory."));
@@ -45,6 +46,24 @@ QString ArgumentsPack::prefix() const
 	return pre;
 }
 
+LzsEncoder::Level ArgumentsPack::lzsLevel() const
+{
+	QString level = _parser.value("lzs-level").toLower();
+	if (level.isEmpty() || level == "normal") {
+		return LzsEncoder::Normal;
+	}
+	if (level == "fast") {
+		return LzsEncoder::Fast;
+	}
+	if (level == "best") {
+		return LzsEncoder::Best;
+	}
+
+	qWarning() << qPrintable(
+	    QCoreApplication::translate("Arguments", "Error: unknown LZS level, available values: fast, normal, best"));
+	exit(1);
+}
+
 FiCompression ArgumentsPack::compressionFormat() const
 {
 	QString compression = _parser.value("compression");
@@ -26,6 +26,7 @@ public:
 	ArgumentsPack();
 	bool force() const;
 	FiCompression compressionFormat() const;
+	LzsEncoder::Level lzsLevel() const;
 	QString prefix() const;
 	inline QString source() const {
 		return _directory;
@@ -24,6 +24,7 @@ ArgumentsPackUnpack::ArgumentsPackUnpack() : CommonArguments()
 	                         "Exclude has the priority over the --include argument.", "exclude", "");
 	_ADD_ARGUMENT("include-from", "Include file names from file. The file format is one name per line.", "include", "");
 	_ADD_ARGUMENT("exclude-from", "Exclude file names from file. The file format is one name per line.", "exclude", "");
+	_ADD_ARGUMENT(_OPTION_NAMES("j", "jobs"), "Number of files processed in parallel (default: number of CPU cores).", "jobs", "");
 }
 
 QStringList ArgumentsPackUnpack::includes() const
@@ -36,6 +37,26 @@ QStringList ArgumentsPackUnpack::excludes() const
 	return _parser.values("exclude") + _excludesFromFile;
 }
 
+int ArgumentsPackUnpack::jobs() const
+{
+	QString value = _parser.value("jobs");
+
+	if (value.isEmpty()) {
+		return qMax(1, QThread::idealThreadCount());
+	}
+
+	bool ok;
+	int jobs = value.toInt(&ok);
+
+	if (!ok || jobs < 1) {
+		qWarning() << qPrintable(
+		    QCoreApplication::translate("Arguments", "Error: jobs must be a positive number"));
+		exit(1);
+	}
+
+	return jobs;
+}
+
 QStringList ArgumentsPackUnpack::mapNamesFromFile(const QString &path)
 {
 	QFile f(path);
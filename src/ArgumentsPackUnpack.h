@@ -25,6 +25,7 @@ public:
 	ArgumentsPackUnpack();
 	QStringList includes() const;
 	QStringList excludes() const;
+	int jobs() const;
 protected:
 	void mapNamesFromFiles();
 	static QStringList mapNamesFromFile(const QString &path);
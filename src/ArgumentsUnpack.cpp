@@ -20,6 +20,8 @@ ArgumentsUnpack::ArgumentsUnpack() : ArgumentsPackUnpack()
 {
 	_ADD_FLAG(_OPTION_NAMES("r", "recursive"),
 	          "Extract FS archives recursively.");
+	_ADD_FLAG("mmap", "Read FS archives through a memory mapping.");
+	_ADD_ARGUMENT("memory-budget", "Maximum size in MiB of the files being extracted at the same time (default: 256).", "memory-budget", "256");
 
 	_parser.addPositionalArgument("file", QCoreApplication::translate("ArgumentsUnpack", "Input file or directory."));
 	_parser.addPositionalArgument("directory", QCoreApplication::translate("ArgumentsUnpack", "Output directory."));
@@ -32,6 +34,31 @@ bool ArgumentsUnpack::recursive() const
 	return _parser.isSet("recursive");
 }
 
+bool ArgumentsUnpack::memoryMapped() const
+{
+	return _parser.isSet("mmap");
+}
+
+qint64 ArgumentsUnpack::memoryBudget() const
+{
+	QString value = _parser.value("memory-budget");
+
+	if (value.isEmpty()) {
+		return 256 * 1024 * 1024;
+	}
+
+	bool ok;
+	int budget = value.toInt(&ok);
+
+	if (!ok || budget < 1) {
+		qWarning() << qPrintable(
+		    QCoreApplication::translate("Arguments", "Error: memory budget must be a positive number"));
+		exit(1);
+	}
+
+	return qint64(budget) * 1024 * 1024;
+}
+
 void ArgumentsUnpack::parse()
 {
 	_parser.process(*qApp);
@@ -24,6 +24,8 @@ class ArgumentsUnpack : public ArgumentsPackUnpack
 public:
 	ArgumentsUnpack();
 	bool recursive() const;
+	bool memoryMapped() const;
+	qint64 memoryBudget() const;
 	inline QString destination() const {
 		return _directory;
 	}
@@ -26,43 +26,112 @@ BackgroundExporter::BackgroundExporter(FieldArchive *archive) :
 
 }
 
-bool BackgroundExporter::toDir(const QDir &dir, ArchiveObserver *observer)
+bool BackgroundExporter::toDir(const QDir &dir, ArchiveObserver *observer, int jobs)
 {
 	if (!_archive) {
 		return false;
 	}
 
+	jobs = qMax(1, jobs);
+
 	FieldArchiveIterator it = _archive->iterator();
+	QThreadPool pool;
+	// Each field in flight holds its map, its mim and its image
+	QSemaphore inFlight(jobs * 2);
+	QAtomicInt exportedCount = 0, canceled = 0;
+
+	pool.setMaxThreadCount(jobs);
 
 	if (observer) {
 		observer->setObserverMaximum(quint32(_archive->nbFields()));
 	}
 
-	int i = 0;
-
-	while (it.hasNext()) {
-		Field *f = it.next();
+	auto wasCanceled = [&]() {
+		QCoreApplication::processEvents();
 
 		if (observer) {
 			if (observer->observerWasCanceled()) {
-				return false;
+				canceled.storeRelaxed(1);
 			}
-			observer->setObserverValue(i++);
+			observer->setObserverValue(exportedCount.loadRelaxed());
 		}
 
-		if (f && f->isOpen() && (!f->isPc() || ((FieldPC *)f)->open2(((FieldArchivePC *)_archive)->getFsArchive())) && f->hasBackgroundFile()) {
-			BackgroundFile *background = f->getBackgroundFile();
-			QString fieldName = f->name();
+		return canceled.loadRelaxed() != 0;
+	};
 
-			if (fieldName.isEmpty()) {
-				fieldName = QObject::tr("Unamed");
-			}
+	while (it.hasNext() && !canceled.loadRelaxed()) {
+		Field *f = it.next();
+
+		if (!f || !f->isOpen()) {
+			exportedCount.fetchAndAddRelaxed(1);
+			continue;
+		}
 
-			if (!background->background().save(dir.filePath(fieldName + ".png"))) {
-				_lastErrorString = QObject::tr("Unable to export '%1' to image").arg(fieldName);
+		while (!inFlight.tryAcquire(1, 50)) {
+			if (wasCanceled()) {
+				break;
 			}
 		}
+
+		if (canceled.loadRelaxed()) {
+			break;
+		}
+
+		pool.start([this, f, &dir, &inFlight, &exportedCount, &canceled]() {
+			if (!canceled.loadRelaxed()) {
+				exportField(f, dir);
+			}
+			exportedCount.fetchAndAddRelaxed(1);
+			inFlight.release();
+		});
+	}
+
+	while (!pool.waitForDone(50)) {
+		wasCanceled();
+	}
+
+	// Lazy fields were loaded by the workers
+	_archive->addLoadedFields();
+	_archive->evictFields();
+
+	if (observer) {
+		observer->setObserverValue(exportedCount.loadRelaxed());
+	}
+
+	return !canceled.loadRelaxed();
+}
+
+bool BackgroundExporter::exportField(Field *f, const QDir &dir)
+{
+	bool wasOpened = f->hasBackgroundFile() && f->getBackgroundFile()->hasMim();
+
+	if (!wasOpened && f->isPc()
+	        && !((FieldPC *)f)->openBackground(((FieldArchivePC *)_archive)->getFsArchive())) {
+		return false;
+	}
+
+	if (!f->hasBackgroundFile()) {
+		return false;
+	}
+
+	BackgroundFile *background = f->getBackgroundFile();
+	QString fieldName = f->name();
+
+	if (fieldName.isEmpty()) {
+		fieldName = QObject::tr("Unamed");
+	}
+
+	bool ok = background->background().save(dir.filePath(fieldName + ".png"));
+
+	if (!ok) {
+		QMutexLocker locker(&_errorMutex);
+		_lastErrorString = QObject::tr("Unable to export '%1' to image").arg(fieldName);
+	}
+
+	// Do not keep the mim of every field in memory
+	if (!wasOpened && f->isPc()) {
+		background->releaseMim();
 	}
 
-	return true;
+	return ok;
 }
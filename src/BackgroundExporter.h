@@ -24,11 +24,15 @@ class BackgroundExporter
 {
 public:
 	explicit BackgroundExporter(FieldArchive *archive);
-	bool toDir(const QDir &dir, ArchiveObserver *observer = nullptr);
+	// Fields are opened, rendered and saved by several threads, at most 2 * jobs fields in memory
+	bool toDir(const QDir &dir, ArchiveObserver *observer = nullptr,
+	           int jobs = QThread::idealThreadCount());
 	inline const QString &errorString() const {
 		return _lastErrorString;
 	}
 private:
+	bool exportField(Field *field, const QDir &dir);
 	FieldArchive *_archive;
+	QMutex _errorMutex;
 	QString _lastErrorString;
 };
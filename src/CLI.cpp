@@ -21,8 +21,12 @@
 #include "ArgumentsImport.h"
 #include "ArgumentsUnpack.h"
 #include "ArgumentsPack.h"
+#include "ArgumentsExportBackgrounds.h"
+#include "ArgumentsCheckTextLayout.h"
 #include "FsArchive.h"
 #include "TextExporter.h"
+#include "BackgroundExporter.h"
+#include "TextLayoutChecker.h"
 #include "LZS.h"
 #include "QLZ4.h"
 #include "FieldArchivePC.h"
@@ -77,10 +81,73 @@ void CLI::commandExport()
 	TextExporter exporter(&fieldArchive);
 	
 	if (!exporter.toCsv(args.destination(), langs, args.separator(), args.quoteCharacter(), CsvFile::Utf8, &observer) && !observer.observerWasCanceled()) {
+		qWarning() << "Cannot export CSV file" << exporter.errorString();
 		return;
 	}
 }
 
+void CLI::commandExportBackgrounds()
+{
+	ArgumentsExportBackgrounds args;
+	if (args.help() || args.destination().isEmpty()) {
+		args.showHelp();
+	}
+
+	FieldArchivePC fieldArchive;
+	if (fieldArchive.open(args.path(), &observer) != 0) {
+		qWarning() << "Cannot open field archive" << fieldArchive.errorMessage();
+		return;
+	}
+
+	BackgroundExporter exporter(&fieldArchive);
+	if (!exporter.toDir(QDir(args.destination()), &observer, args.jobs())) {
+		qWarning() << qPrintable(QCoreApplication::translate("CLI", "Cannot export backgrounds"));
+		return;
+	}
+
+	if (!exporter.errorString().isEmpty()) {
+		qWarning() << qPrintable(exporter.errorString());
+	}
+}
+
+void CLI::commandCheckTextLayout()
+{
+	ArgumentsCheckTextLayout args;
+	if (args.help() || args.path().isEmpty()) {
+		args.showHelp();
+	}
+
+	FieldArchivePC fieldArchive;
+	if (fieldArchive.open(args.path(), &observer) != 0) {
+		qWarning() << "Cannot open field archive" << fieldArchive.errorMessage();
+		return;
+	}
+
+	TextLayoutChecker checker(&fieldArchive);
+	if (!checker.check(fieldArchive.languages(), args.noProgress() ? nullptr : &observer, args.jobs())) {
+		qWarning() << qPrintable(QCoreApplication::translate("CLI", "Cannot check text layout")) << qPrintable(checker.errorString());
+		return;
+	}
+
+	if (!args.noProgress()) {
+		printf("\n");
+	}
+
+	for (const TextLayoutChecker::Overflow &overflow: checker.overflows()) {
+		QString text = QString("%1 text %2").arg(overflow.fieldName).arg(overflow.textId);
+		if (!overflow.lang.isEmpty()) {
+			text.append(QString(" (%1)").arg(overflow.lang));
+		}
+		if (overflow.windowId >= 0) {
+			text.append(QString(" window %1").arg(overflow.windowId));
+		}
+		printf("%s page %d: %dx%d\n", qPrintable(text), overflow.page + 1,
+		       overflow.size.width(), overflow.size.height());
+	}
+
+	printf("%lld pages too big in %d texts\n", qlonglong(checker.overflows().size()), checker.textCount());
+}
+
 void CLI::commandImport()
 {
 	ArgumentsImport args;
@@ -106,6 +173,69 @@ void CLI::commandImport()
 	}
 }
 
+/*
+ * Files are read, decompressed and written by a pool of workers.
+ * The main thread reserves in budget the uncompressed size of every file
+ * before starting its worker, so the memory used stays bounded.
+ */
+struct UnpackContext
+{
+	QThreadPool pool;
+	QSemaphore budget;
+	int maxCost;
+	QString destination, commonPath;
+	QMutex errorMutex;
+	QString errorString;
+	QAtomicInteger<qint64> files, bytes;
+
+	UnpackContext(const QString &destination, const QString &commonPath, int jobs, int budgetSize) :
+	    budget(budgetSize), maxCost(budgetSize / 2), destination(destination), commonPath(commonPath), files(0), bytes(0) {
+		pool.setMaxThreadCount(jobs);
+	}
+
+	// Half of the budget at most: an inner archive and one of its files always fit
+	inline int cost(qint64 size) const {
+		return int(qMin(size, qint64(maxCost)));
+	}
+
+	inline bool hasError() {
+		QMutexLocker locker(&errorMutex);
+		return !errorString.isEmpty();
+	}
+
+	QString targetPath(QString fileName) const {
+		fileName = FsArchive::cleanPath(fileName);
+		fileName.chop(1);
+		return QDir::cleanPath(destination % QDir::separator() % fileName.mid(commonPath.size()).replace('\\', '/'));
+	}
+};
+
+// Inner archive read from the outer archive, without temporary files
+struct InnerArchive
+{
+	InnerArchive(const QByteArray &fl_data, const QByteArray &fi_data, const QByteArray &fs_data) :
+	    archive(fl_data, fi_data), fsData(fs_data) {}
+	FsArchive archive;
+	QByteArray fsData;
+};
+
+static void writeUnpackedFile(UnpackContext &context, const QByteArray &data, const QString &target)
+{
+	QDir().mkpath(QFileInfo(target).path());
+
+	QFile f(target);
+	if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(data) != data.size()) {
+		QMutexLocker locker(&context.errorMutex);
+		if (context.errorString.isEmpty()) {
+			context.errorString = target % ": " % f.errorString();
+		}
+		return;
+	}
+
+	context.files.fetchAndAddRelaxed(1);
+	context.bytes.fetchAndAddRelaxed(data.size());
+}
+
 void CLI::commandUnpack()
 {
 	ArgumentsUnpack args;
@@ -117,50 +247,178 @@ void CLI::commandUnpack()
 	if (archive == nullptr) {
 		return;
 	}
+
+	if (args.memoryMapped() && !archive->setMemoryMapped(true)) {
+		qWarning() << qPrintable(QCoreApplication::translate("CLI", "Cannot map archive in memory, fallback to file reads"));
+	}
 	
+	QElapsedTimer t;t.start();
 	QString commonPath = "c:\\ff8\\data\\";
 	QStringList fileList = archive->tocInDirectory(commonPath);
-	QStringList selectedFiles = filteredFiles(fileList, args.includes(), args.excludes());
+	QStringList selectedFiles = filteredFiles(fileList, args.includes(), args.excludes()), archiveFiles;
 	if (args.recursive()) {
-		QStringList archiveFiles = filteredFiles(fileList, QStringList() << "*.fs" << "*.fi" << "*.fl", QStringList());
+		// Inner archives are opened in memory, only their content is extracted
+		archiveFiles = filteredFiles(fileList, QStringList() << "*.fs", QStringList());
+		selectedFiles = filteredFiles(selectedFiles, QStringList(), QStringList() << "*.fs" << "*.fi" << "*.fl");
+	}
+
+	UnpackContext context(args.destination(), commonPath, args.jobs(),
+	                      int(qMin(args.memoryBudget(), qint64(std::numeric_limits<int>::max()))));
+	int i = 0;
 
-		FsArchive::Error error = archive->extractFiles(archiveFiles, commonPath, args.destination());
-		if (error != FsArchive::Ok) {
-			qWarning() << qPrintable(QCoreApplication::translate("CLI", "An error occured when exporting inner FS/FL/FI")) << qPrintable(FsArchive::errorString(error, args.path()));
+	auto stopped = [&]() {
+		return context.hasError() || observer.observerWasCanceled();
+	};
+	auto nextFile = [&](const QString &fileName) {
+		if (!args.noProgress()) {
+			observer.setFilename(fileName);
+			observer.setObserverValue(i);
 		}
-		
-		for (const QString &archiveFile: archiveFiles) {
-			if (!archiveFile.endsWith(".fs")) {
-				continue;
+		++i;
+		return !stopped();
+	};
+
+	if (!args.noProgress()) {
+		observer.setObserverMaximum(selectedFiles.size() + archiveFiles.size());
+	}
+
+	for (const QString &fileName: selectedFiles) {
+		if (!nextFile(fileName)) {
+			break;
+		}
+
+		FsHeader *header = archive->getFile(fileName);
+		if (header == nullptr) {
+			continue;
+		}
+
+		int cost = context.cost(header->uncompressedSize());
+		QString target = context.targetPath(fileName);
+		context.budget.acquire(cost);
+		context.pool.start([&context, archive, fileName, target, cost]() {
+			writeUnpackedFile(context, archive->fileData(fileName), target);
+			context.budget.release(cost);
+		});
+	}
+
+	for (const QString &archiveFile: archiveFiles) {
+		if (!nextFile(archiveFile)) {
+			break;
+		}
+
+		QString basePath = archiveFile.chopped(1);
+		FsHeader *fsHeader = archive->getFile(basePath % "s"),
+		        *flHeader = archive->getFile(basePath % "l"),
+		        *fiHeader = archive->getFile(basePath % "i");
+		if (fsHeader == nullptr || flHeader == nullptr || fiHeader == nullptr) {
+			continue;
+		}
+
+		// The budget is given back when the last file of this archive is written
+		int archiveCost = context.cost(qint64(fsHeader->uncompressedSize()) + flHeader->uncompressedSize() + fiHeader->uncompressedSize());
+		context.budget.acquire(archiveCost);
+		QSemaphore *budget = &context.budget;
+		QSharedPointer<InnerArchive> inner(
+		    new InnerArchive(archive->fileData(basePath % "l"), archive->fileData(basePath % "i"), archive->fileData(basePath % "s")),
+		    [budget, archiveCost](InnerArchive *inner) {
+			    delete inner;
+			    budget->release(archiveCost);
+		    });
+
+		if (!inner->archive.isOpen()) {
+			qWarning() << qPrintable(QCoreApplication::translate("CLI", "An error occured when exporting file inside inner FS/FL/FI")) << archiveFile;
+			continue;
+		}
+
+		for (const QString &fileName: filteredFiles(inner->archive.tocInDirectory(commonPath), args.includes(), args.excludes())) {
+			if (stopped()) {
+				break;
 			}
-			
-			QString fileName = QDir::cleanPath(args.destination() + QDir::separator() + archiveFile.mid(commonPath.size()).replace('\\', '/'));
-			fileName.chop(1);
-			{
-				FsArchive subArchive(fileName);
-				if (subArchive.isOpen()) {
-					QStringList fileList2 = subArchive.tocInDirectory(commonPath);
-					FsArchive::Error error = subArchive.extractFiles(filteredFiles(fileList2, args.includes(), args.excludes()), commonPath, args.destination());
-					if (error != FsArchive::Ok) {
-						qWarning() << qPrintable(QCoreApplication::translate("CLI", "An error occured when exporting file inside inner FS/FL/FI")) << fileName << qPrintable(FsArchive::errorString(error, args.path()));
-					}
-				}
+
+			FsHeader *header = inner->archive.getFile(fileName);
+			if (header == nullptr) {
+				continue;
 			}
-			
-			QFile::remove(fileName % "s");
-			QFile::remove(fileName % "l");
-			QFile::remove(fileName % "i");
+
+			int cost = context.cost(header->uncompressedSize());
+			QString target = context.targetPath(fileName);
+			context.budget.acquire(cost);
+			context.pool.start([&context, inner, fileName, target, cost]() {
+				writeUnpackedFile(context, inner->archive.fileData(fileName, inner->fsData), target);
+				context.budget.release(cost);
+			});
 		}
-		selectedFiles = filteredFiles(selectedFiles, QStringList(), QStringList() << "*.fs" << "*.fi" << "*.fl");
 	}
-	FsArchive::Error error = archive->extractFiles(selectedFiles, commonPath, args.destination(), args.noProgress() ? nullptr : &observer);
-	if (error != FsArchive::Ok) {
-		qWarning() << qPrintable(QCoreApplication::translate("CLI", "An error occured when exporting")) << qPrintable(FsArchive::errorString(error, args.path()));
+
+	context.pool.waitForDone();
+
+	if (!context.errorString.isEmpty()) {
+		qWarning() << qPrintable(QCoreApplication::translate("CLI", "An error occured when exporting")) << qPrintable(context.errorString);
 	}
 
+	if (!args.noProgress()) {
+		observer.setFilename(QCoreApplication::translate("CLI", "Done"));
+		observer.setObserverValue(i);
+		printf("\n");
+	}
+
+	double seconds = qMax(t.elapsed(), qint64(1)) / 1000.0, megabytes = context.bytes.loadRelaxed() / (1024.0 * 1024.0);
+	printf("%lld files, %.1f MiB in %.2f s (%.0f files/s, %.1f MiB/s)\n",
+	       context.files.loadRelaxed(), megabytes, seconds, context.files.loadRelaxed() / seconds, megabytes / seconds);
+
 	delete archive;
 }
 
+struct PackedFile
+{
+	QByteArray data;
+	quint32 uncompressedSize, compression;
+	QString errorString;
+	QSemaphore done;
+};
+
+static void packFile(const QString &filePath, FiCompression compressionFormat, LzsEncoder::Level lzsLevel, PackedFile &packed)
+{
+	// One encoder per worker thread
+	static thread_local LzsEncoder lzsEncoder;
+
+	QFile f(filePath);
+	if (!f.open(QIODevice::ReadOnly)) {
+		packed.errorString = f.errorString();
+		return;
+	}
+	QByteArray data = f.readAll(), compressedData;
+	f.close();
+	quint32 compressedSize = 0;
+	packed.uncompressedSize = quint32(data.size());
+
+	switch (compressionFormat) {
+	case FiCompression::CompressionLzs:
+		lzsEncoder.compress(data.constData(), data.size(), compressedData, lzsLevel);
+		compressedSize = quint32(data.size());
+		compressedData.prepend((const char *)&compressedSize, 4);
+		break;
+	case FiCompression::CompressionLz4:
+		compressedData = QLZ4::compress(data);
+		compressedSize = quint32(data.size());
+		compressedData.prepend((const char *)&compressedSize, 4);
+		break;
+	case FiCompression::CompressionNone:
+	case FiCompression::CompressionUnknown:
+		compressedData = data;
+		break;
+	}
+
+	packed.compression = quint32(compressionFormat);
+
+	if (compressedData.size() >= data.size()) {
+		packed.compression = quint32(FiCompression::CompressionNone);
+		compressedData = data;
+	}
+
+	packed.data = compressedData;
+}
+
 void CLI::commandPack()
 {
 	ArgumentsPack args;
@@ -168,6 +426,7 @@ void CLI::commandPack()
 		args.showHelp();
 	}
 	FiCompression compressionFormat = args.compressionFormat();
+	LzsEncoder::Level lzsLevel = args.lzsLevel();
 	
 	QString path = args.path().left(args.path().size() - 1),
 	        fsPath = FsArchive::fsPath(path),
@@ -196,56 +455,61 @@ void CLI::commandPack()
 	if (!args.noProgress()) {
 		observer.setObserverMaximum(selectedFiles.size());
 	}
+
+	// Files are read and compressed by a pool of workers, and written in order by this thread.
+	// At most window files are kept in memory.
+	const int jobs = args.jobs(), window = jobs * 2;
+	QThreadPool pool;
+	pool.setMaxThreadCount(jobs);
+	std::vector<PackedFile> packedFiles(size_t(window));
+
+	auto startPackFile = [&](int index) {
+		PackedFile *packed = &packedFiles[size_t(index % window)];
+		QString filePath = dir.filePath(selectedFiles.at(index));
+		pool.start([packed, filePath, compressionFormat, lzsLevel]() {
+			packFile(filePath, compressionFormat, lzsLevel, *packed);
+			packed->done.release();
+		});
+	};
+
+	for (int j = 0; j < qMin(window, int(selectedFiles.size())); ++j) {
+		startPackFile(j);
+	}
+
 	int i = 0;
 	for (QString fileName: selectedFiles) {
 		if (!args.noProgress()) {
 			observer.setFilename(fileName);
 			if (observer.observerWasCanceled()) {
+				pool.clear();
+				pool.waitForDone();
 				return;
 			}
-			observer.setObserverValue(i++);
+			observer.setObserverValue(i);
+		}
+		PackedFile &packed = packedFiles[size_t(i % window)];
+		packed.done.acquire();
+		if (!packed.errorString.isEmpty()) {
+			qWarning() << qPrintable(QCoreApplication::translate("CLI", "An error occured when exporting")) << qPrintable(packed.errorString);
+			pool.clear();
+			pool.waitForDone();
+			return;
 		}
 		QString fullName = commonPath + fileName.replace('/', '\\');
 		flFile.write(fullName.toLatin1() + "\r\n");
 		quint32 pos = quint32(fsFile.pos());
-		QFile f(dir.filePath(fileName));
-		if (!f.open(QIODevice::ReadOnly)) {
-			qWarning() << qPrintable(QCoreApplication::translate("CLI", "An error occured when exporting")) << qPrintable(f.errorString());
-			return;
-		}
-		QByteArray data = f.readAll(), compressedData;
-		f.close();
-		quint32 uncompressedSize = quint32(data.size()), compressedSize = 0;
-		
-		switch (compressionFormat) {
-		case FiCompression::CompressionLzs:
-			compressedData = LZS::compress(data);
-			compressedSize = quint32(data.size());
-			compressedData.prepend((const char *)&compressedSize, 4);
-			break;
-		case FiCompression::CompressionLz4:
-			compressedData = QLZ4::compress(data);
-			compressedSize = quint32(data.size());
-			compressedData.prepend((const char *)&compressedSize, 4);
-			break;
-		case FiCompression::CompressionNone:
-		case FiCompression::CompressionUnknown:
-			compressedData = data;
-			break;
-		}
-		
-		quint32 compression = quint32(compressionFormat);
-		
-		if (compressedData.size() >= data.size()) {
-			compression = quint32(FiCompression::CompressionNone);
-			compressedData = data;
-		}
-		
-		fsFile.write(compressedData);
 
-		fiFile.write((const char *)&uncompressedSize, 4);
+		fsFile.write(packed.data);
+		packed.data = QByteArray();
+
+		fiFile.write((const char *)&packed.uncompressedSize, 4);
 		fiFile.write((const char *)&pos, 4);
-		fiFile.write((const char *)&compression, 4);
+		fiFile.write((const char *)&packed.compression, 4);
+
+		++i;
+		if (i + window - 1 < selectedFiles.size()) {
+			startPackFile(i + window - 1);
+		}
 	}
 	
 	if (!args.noProgress()) {
@@ -336,5 +600,11 @@ void CLI::exec()
 	case Arguments::Pack:
 		commandPack();
 		break;
+	case Arguments::ExportBackgrounds:
+		commandExportBackgrounds();
+		break;
+	case Arguments::CheckTextLayout:
+		commandCheckTextLayout();
+		break;
 	}
 }
@@ -17,6 +17,7 @@
  ****************************************************************************/
 #include "ConfigDialog.h"
 #include "Config.h"
+#include "FF8Font.h"
 #include "Data.h"
 #include "TdwManagerDialog.h"
 
@@ -49,6 +50,9 @@ ConfigDialog::ConfigDialog(QWidget *parent)
 	encodingLayout->setContentsMargins(QMargins());
 
 //	hideUnusedTexts = new QCheckBox(tr("Cacher les textes inutilisés"), this);
+	fieldCache = new QCheckBox(tr("Keep a cache of opened fields on disk"), this);
+	lazyOpen = new QCheckBox(tr("Open fields only when needed"), this);
+	incrementalSave = new QCheckBox(tr("Save only modified fields (faster, the archive grows until optimized)"), this);
 
 	QPushButton *okButton = new QPushButton(tr("Save"), this);
 	okButton->setDefault(true);
@@ -66,7 +70,10 @@ ConfigDialog::ConfigDialog(QWidget *parent)
 	layout->addWidget(encodingLabel, 2, 0);
 	layout->addLayout(encodingLayout, 2, 1);
 //	layout->addWidget(hideUnusedTexts, 3, 0, 1, 2);
-	layout->addLayout(buttonsLayout, 4, 0, 1, 2, Qt::AlignRight);
+	layout->addWidget(fieldCache, 3, 0, 1, 2);
+	layout->addWidget(lazyOpen, 4, 0, 1, 2);
+	layout->addWidget(incrementalSave, 5, 0, 1, 2);
+	layout->addLayout(buttonsLayout, 6, 0, 1, 2, Qt::AlignRight);
 
 	connect(useRegAppPath, SIGNAL(toggled(bool)), appPathLine, SLOT(setDisabled(bool)));
 	connect(useRegAppPath, SIGNAL(toggled(bool)), appPathButton, SLOT(setDisabled(bool)));
@@ -92,6 +99,9 @@ ConfigDialog::ConfigDialog(QWidget *parent)
 	indexOfData = encodingComboBox->findData(Config::value("encoding", "00"));
 	encodingComboBox->setCurrentIndex(indexOfData != -1 ? indexOfData : 0);
 //	hideUnusedTexts->setChecked(Config::value("hideUnusedTexts").toBool());
+	fieldCache->setChecked(Config::value("fieldCache").toBool());
+	lazyOpen->setChecked(Config::value("lazyOpen").toBool());
+	incrementalSave->setChecked(Config::value("incrementalSave").toBool());
 
 	connect(encodingManage, SIGNAL(clicked()), SLOT(manageEncoding()));
 	connect(appPathButton, SIGNAL(clicked()), SLOT(setAppPath()));
@@ -162,8 +172,11 @@ void ConfigDialog::saveConfig()
 	QFileInfo fullFF8ExePath(appPathLine->text());
 	Config::setValue("appPath", fullFF8ExePath.absolutePath());
 	Config::setValue("ff8ExeName", fullFF8ExePath.fileName());
-	Config::setValue("encoding", encodingComboBox->itemData(encodingComboBox->currentIndex()));
+	FF8Font::setCurrentConfigFont(encodingComboBox->itemData(encodingComboBox->currentIndex()).toString());
 //	Config::setValue("hideUnusedTexts", hideUnusedTexts->isChecked());
+	Config::setValue("fieldCache", fieldCache->isChecked());
+	Config::setValue("lazyOpen", lazyOpen->isChecked());
+	Config::setValue("incrementalSave", incrementalSave->isChecked());
 
 	if (oldLang != Config::value("lang").toString()) {
 		restartNow();
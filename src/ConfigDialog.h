@@ -33,7 +33,7 @@ private:
 	void restartNow();
 
 	QComboBox *langComboBox;
-	QCheckBox *useRegAppPath;
+	QCheckBox *useRegAppPath, *fieldCache, *lazyOpen, *incrementalSave;
 	QLineEdit *appPathLine;
 	QComboBox *encodingComboBox;
 	QCheckBox *hideUnusedTexts;
@@ -18,135 +18,212 @@
 #include "CsvFile.h"
 
 CsvFile::CsvFile(QIODevice *io, const QChar &fieldSeparator, const QChar &quoteCharacter, CsvEncoding encoding) :
-      _io(io), _fieldSeparator(fieldSeparator), _quoteCharacter(quoteCharacter), _encoding(encoding)
+      _io(io), _fieldSeparator(fieldSeparator), _quoteCharacter(quoteCharacter), _encoding(encoding),
+      _readPos(0), _writeError(false)
 {
+	switch (_encoding) {
+	case Utf8:
+		_encoder = QStringEncoder(QStringEncoder::Utf8);
+		break;
+	}
+
+	_fieldSeparatorData = _encoder.encode(QStringView(&_fieldSeparator, 1));
+	_quoteCharacterData = _encoder.encode(QStringView(&_quoteCharacter, 1));
 }
 
-bool CsvFile::readLine(QStringList &line)
+CsvFile::~CsvFile()
 {
-	QString field;
-	line.clear();
-	State state = Start;
-	
-	do {
-		if (_io->atEnd()) {
-			return false;
+	flush();
+}
+
+bool CsvFile::nextLine(qsizetype &lineEnd)
+{
+	qsizetype scanPos = _readPos;
+
+	forever {
+		const char *data = _readBuffer.constData();
+		const char *newLine = (const char *)memchr(data + scanPos, '\n', size_t(_readBuffer.size() - scanPos));
+
+		if (newLine != nullptr) {
+			lineEnd = newLine - data + 1;
+			return true;
 		}
 
-		QByteArray lineData = _io->readLine();
-		QString l;
-		switch (_encoding) {
-		case Utf8:
-			l = QString::fromUtf8(lineData);
-			break;
+		// Keep only the unread data before reading the next block
+		_readBuffer.remove(0, _readPos);
+		_readPos = 0;
+		scanPos = _readBuffer.size();
+
+		QByteArray block = _io->read(CSV_FILE_BLOCK_SIZE);
+
+		if (block.isEmpty()) {
+			// Last line without line break
+			lineEnd = _readBuffer.size();
+			return lineEnd > 0;
 		}
-		
-		for (int i = 0; i < l.size(); ++i) {
-			QChar c = l.at(i);
-			
-			switch (state) {
-			case Start:
-				if (c == _fieldSeparator) {
-					state = NextField;
-				} else if (c == '\n' || c == '\r') {
-					state = End;
-				} else if (c == _quoteCharacter) {
-					state = FieldQuoted;
-				} else {
-					state = FieldUnquoted;
-				}
-				break;
-			case End:
-			case NextField:
-				// Should not happen
-				qWarning() << "Invalid state";
-				break;
-			case FieldQuoted:
-				if (c == _quoteCharacter) {
-					state = FieldQuotedEscape;
-				} else {
-					field.append(c);
+
+		_readBuffer.append(block);
+	}
+}
+
+qsizetype CsvFile::indexOf(QByteArrayView needle, qsizetype from, qsizetype lineEnd) const
+{
+	qsizetype index = QByteArrayView(_readBuffer.constData(), lineEnd).indexOf(needle, from);
+
+	return index < 0 ? lineEnd : index;
+}
+
+QString CsvFile::decode(const char *data, qsizetype size) const
+{
+	QString field;
+
+	switch (_encoding) {
+	case Utf8:
+		field = QString::fromUtf8(data, size);
+		break;
+	}
+
+	return field;
+}
+
+bool CsvFile::readLine(QStringList &line)
+{
+	qsizetype lineEnd;
+	line.clear();
+
+	if (!nextLine(lineEnd)) {
+		return false;
+	}
+
+	QByteArray unescaped; // Only for the fields with escaped quotes or line breaks
+	qsizetype pos = _readPos, crPos = -1,
+	        contentEnd = _readBuffer.at(lineEnd - 1) == '\n' ? lineEnd - 1 : lineEnd;
+
+	forever {
+		// Start of a field
+		if (matchAt(_quoteCharacterData, pos, lineEnd)) {
+			qsizetype start = pos + _quoteCharacterData.size(), fieldEnd;
+			bool escaped = false;
+			pos = start;
+
+			forever {
+				fieldEnd = indexOf(_quoteCharacterData, pos, lineEnd);
+
+				if (fieldEnd == lineEnd) {
+					// Line break in the field, read another line
+					unescaped.append(_readBuffer.constData() + start, lineEnd - start);
+					escaped = true;
+					_readPos = lineEnd;
+
+					if (!nextLine(lineEnd)) {
+						return false;
+					}
+
+					pos = start = _readPos;
+					crPos = -1;
+					contentEnd = _readBuffer.at(lineEnd - 1) == '\n' ? lineEnd - 1 : lineEnd;
+					continue;
 				}
-				break;
-			case FieldQuotedEscape:
-				if (c == _fieldSeparator) {
-					state = NextField;
-				} else if (c == '\n' || c == '\r') {
-					state = End;
-				} else if (c == _quoteCharacter) {
-					field.append(c);
-					state = FieldQuoted;
-				} else {
-					field.append(_quoteCharacter); // Abort escape, put the quote character of the previous iteration
-					field.append(c);
-					state = FieldQuoted;
+
+				pos = fieldEnd + _quoteCharacterData.size();
+
+				if (pos >= contentEnd || _readBuffer.at(pos) == '\r'
+				        || matchAt(_fieldSeparatorData, pos, lineEnd)) {
+					break;
 				}
-				break;
-			case FieldUnquoted:
-				if (c == _fieldSeparator) {
-					state = NextField;
-				} else if (c == '\n' || c == '\r') {
-					state = End;
-				} else {
-					field.append(c);
-					state = FieldUnquoted;
+
+				if (matchAt(_quoteCharacterData, pos, lineEnd)) {
+					// Escaped quote, keep only one
+					unescaped.append(_readBuffer.constData() + start, pos - start);
+					escaped = true;
+					pos = start = pos + _quoteCharacterData.size();
 				}
-				break;
+				// Otherwise the quote character is kept as is
 			}
-			
-			if (state == NextField) {
-				line.append(field);
-				field = QString();
-				if (i + 1 < l.size()) {
-					state = Start;
-				}
-			} else if (state == End) {
-				line.append(field);
-				break;
+
+			if (escaped) {
+				unescaped.append(_readBuffer.constData() + start, fieldEnd - start);
+				line.append(decode(unescaped.constData(), unescaped.size()));
+				unescaped.clear();
+			} else {
+				line.append(decode(_readBuffer.constData() + start, fieldEnd - start));
+			}
+		} else {
+			if (crPos < pos) {
+				const char *cr = (const char *)memchr(_readBuffer.constData() + pos, '\r', size_t(contentEnd - pos));
+				crPos = cr != nullptr ? cr - _readBuffer.constData() : contentEnd;
 			}
+
+			qsizetype fieldEnd = qMin(indexOf(_fieldSeparatorData, pos, contentEnd), crPos);
+			line.append(decode(_readBuffer.constData() + pos, fieldEnd - pos));
+			pos = fieldEnd;
 		}
-		
-		// Flush unfinished states
-		switch (state) {
-		case End:
-		case NextField:
-			// Nothing to do
-			break;
-		case FieldQuoted:
-			// Will read another line
-			break;
-		case Start:
-		case FieldQuotedEscape:
-		case FieldUnquoted:
-			line.append(field);
-			break;
+
+		// After the field: separator, end of line or end of file
+		if (pos < contentEnd && matchAt(_fieldSeparatorData, pos, lineEnd)) {
+			pos += _fieldSeparatorData.size();
+
+			if (pos < lineEnd) {
+				continue;
+			}
 		}
-	} while (state == FieldQuoted);
-	
-	return true;
+
+		_readPos = lineEnd;
+
+		return true;
+	}
 }
 
 bool CsvFile::writeLine(const QStringList &line)
 {
-	QString l, esc = QString().append(_quoteCharacter).append(_quoteCharacter);
+	for (const QString &field: line) {
+		_writeBuffer.append(_quoteCharacterData);
+
+		qsizetype start = _writeBuffer.size();
+		_writeBuffer.resize(start + _encoder.requiredSpace(field.size()));
+		char *end = _encoder.appendToBuffer(_writeBuffer.data() + start, field);
+		_writeBuffer.truncate(end - _writeBuffer.constData());
+
+		if (_writeBuffer.indexOf(_quoteCharacterData, start) >= 0) {
+			// Double every quote character
+			QByteArray fieldData = _writeBuffer.mid(start);
+			qsizetype from = 0, index;
+			_writeBuffer.truncate(start);
+
+			while ((index = fieldData.indexOf(_quoteCharacterData, from)) >= 0) {
+				index += _quoteCharacterData.size();
+				_writeBuffer.append(fieldData.constData() + from, index - from)
+				        .append(_quoteCharacterData);
+				from = index;
+			}
 
-	for (QString field: line) {
-		l.append(_quoteCharacter)
-		        .append(field.replace(_quoteCharacter, esc))
-		        .append(_quoteCharacter)
-		        .append(_fieldSeparator);
+			_writeBuffer.append(fieldData.constData() + from, fieldData.size() - from);
+		}
+
+		_writeBuffer.append(_quoteCharacterData)
+		        .append(_fieldSeparatorData);
 	}
 
-	l[l.size() - 1] = '\r';
-	l.append('\n');
-	
-	QByteArray lineData;
-	
-	switch (_encoding) {
-	case Utf8:
-		lineData = l.toUtf8();
-		break;
+	if (!line.isEmpty()) {
+		_writeBuffer.chop(_fieldSeparatorData.size());
 	}
-	
-	return _io->write(lineData) == lineData.size();
+	_writeBuffer.append("\r\n");
+
+	if (_writeBuffer.size() >= CSV_FILE_BLOCK_SIZE) {
+		flush();
+	}
+
+	return !_writeError;
+}
+
+bool CsvFile::flush()
+{
+	if (!_writeBuffer.isEmpty()) {
+		if (_io->write(_writeBuffer) != _writeBuffer.size()) {
+			_writeError = true;
+		}
+		_writeBuffer.clear();
+	}
+
+	return !_writeError;
 }
@@ -19,6 +19,12 @@
 
 #include <QtCore>
 
+/*
+ * Buffered CSV reader and writer, the device is read and written
+ * by blocks of CSV_FILE_BLOCK_SIZE bytes
+ */
+#define CSV_FILE_BLOCK_SIZE 65536
+
 class CsvFile
 {
 public:
@@ -27,18 +33,25 @@ public:
 	};
 	explicit CsvFile(QIODevice *io, const QChar &fieldSeparator = QChar(','), const QChar &quoteCharacter = QChar('"'),
 	                 CsvEncoding encoding = Utf8);
+	~CsvFile();
 	bool readLine(QStringList &line);
+	// Lines are written in the device by blocks, or by flush()
 	bool writeLine(const QStringList &line);
+	bool flush();
 private:
-	enum State {
-		Start,
-		End,
-		NextField,
-		FieldQuoted,
-		FieldQuotedEscape,
-		FieldUnquoted
-	};
+	bool nextLine(qsizetype &lineEnd);
+	qsizetype indexOf(QByteArrayView needle, qsizetype from, qsizetype lineEnd) const;
+	inline bool matchAt(QByteArrayView needle, qsizetype pos, qsizetype lineEnd) const {
+		return QByteArrayView(_readBuffer.constData() + pos, lineEnd - pos).startsWith(needle);
+	}
+	QString decode(const char *data, qsizetype size) const;
 	QIODevice *_io;
 	QChar _fieldSeparator, _quoteCharacter;
 	CsvEncoding _encoding;
+	QStringEncoder _encoder;
+	// Encoded separator and quote character, searched directly in the bytes
+	QByteArray _fieldSeparatorData, _quoteCharacterData;
+	QByteArray _readBuffer, _writeBuffer;
+	qsizetype _readPos;
+	bool _writeError;
 };
@@ -127,7 +127,11 @@ QByteArray FF8DiscArchive::fileLZS(const FF8DiscFile &file, bool strict)
 	if ((strict && file.getSize() != lzsSize+4) || (!strict && (lzsSize + 4)/SECTOR_SIZE_DATA + (int)(lzsSize%SECTOR_SIZE_DATA != 0) != file.getSize()/SECTOR_SIZE_DATA + (int)(file.getSize()%SECTOR_SIZE_DATA != 0)))
 		return QByteArray();
 
-	return LZS::decompress(readIso(lzsSize).constData(), lzsSize);
+	QByteArray ret;
+	LzsDecoder decoder;
+	decoder.decompress(readIso(lzsSize).constData(), lzsSize, ret);
+
+	return ret;
 }
 
 QByteArray FF8DiscArchive::fileGZ(const FF8DiscFile &file)
@@ -137,7 +141,18 @@ QByteArray FF8DiscArchive::fileGZ(const FF8DiscFile &file)
 	if (!seekToSector(file.getPos()))	return QByteArray();
 	seekIso(posIso() + 8);
 
-	return GZIP::decompress(readIso(file.getSize()-8));
+	QByteArray data = readIso(file.getSize()-8);
+	quint32 decSize = 0;
+
+	// gzip trailer: uncompressed size, only used as a hint (there can be padding)
+	if (data.size() > 4) {
+		memcpy(&decSize, data.constData() + data.size() - 4, 4);
+		if (qint64(decSize) > qint64(data.size()) * 1032) { // Max deflate ratio
+			decSize = 0;
+		}
+	}
+
+	return GZIP::decompress(data, int(decSize));
 }
 
 bool FF8DiscArchive::extract(const FF8DiscFile &file, const QString &destination)
@@ -39,6 +39,8 @@ void FF8Font::setTables(const QList<QStringList> &tables)
 {
 	_tables = tables;
 	modified = true;
+	QMutexLocker locker(&codecMutex);
+	_codec.reset();
 }
 
 void FF8Font::setChar(int tableId, int charId, const QString &c)
@@ -46,9 +48,22 @@ void FF8Font::setChar(int tableId, int charId, const QString &c)
 	if (tableId < _tables.size() && charId < 224) {
 		_tables[tableId][charId] = c;
 		modified = true;
+		QMutexLocker locker(&codecMutex);
+		_codec.reset();
 	}
 }
 
+QSharedPointer<const FF8TextCodec> FF8Font::codec() const
+{
+	QMutexLocker locker(&codecMutex);
+
+	if (_codec.isNull()) {
+		_codec = QSharedPointer<const FF8TextCodec>(new FF8TextCodec(_tables));
+	}
+
+	return _codec;
+}
+
 bool FF8Font::isValid() const
 {
 	return !_tables.isEmpty() && !_tdw->isNull();
@@ -202,9 +217,13 @@ void FF8Font::print()
 
 QMap<QString, FF8Font *> FF8Font::fonts;
 QString FF8Font::font_dirPath;
+FF8Font *FF8Font::currentFont = nullptr;
+bool FF8Font::currentFontCached = false;
+QMutex FF8Font::currentFontMutex;
 
 bool FF8Font::listFonts()
 {
+	resetCurrentConfigFont();
 	fonts.clear();
 
 #ifdef Q_OS_WIN
@@ -283,11 +302,13 @@ FF8Font *FF8Font::openFont(const QString &tdwPath, const QString &txtPath)
 void FF8Font::registerFont(const QString &name, FF8Font *font)
 {
 	fonts.insert(name, font);
+	resetCurrentConfigFont();
 }
 
 void FF8Font::deregisterFont(const QString &name)
 {
 	if (fonts.contains(name)) {
+		resetCurrentConfigFont();
 		delete fonts.take(name);
 	}
 }
@@ -318,13 +339,34 @@ FF8Font *FF8Font::font(const QString &constName)
 
 FF8Font *FF8Font::getCurrentConfigFont()
 {
-	QString fnt = Config::value("encoding", "00").toString();
+	QMutexLocker locker(&currentFontMutex);
 
-	QStringList fontL = fontList();
-	if (fontL.contains(fnt)) {
-		return font(fnt);
+	if (!currentFontCached) {
+		QString fnt = Config::value("encoding", "00").toString();
+
+		QStringList fontL = fontList();
+		if (fontL.contains(fnt)) {
+			currentFont = font(fnt);
+		} else {
+			currentFont = font(fontL.isEmpty() ? QString() : fontL.first());
+		}
+		currentFontCached = true;
 	}
-	return font(fontL.isEmpty() ? QString() : fontL.first());
+
+	return currentFont;
+}
+
+void FF8Font::setCurrentConfigFont(const QString &name)
+{
+	Config::setValue("encoding", name);
+	resetCurrentConfigFont();
+}
+
+void FF8Font::resetCurrentConfigFont()
+{
+	QMutexLocker locker(&currentFontMutex);
+	currentFont = nullptr;
+	currentFontCached = false;
 }
 
 bool FF8Font::saveFonts()
@@ -403,6 +445,7 @@ bool FF8Font::copyFont(const QString &name, const QString &from, const QString &
 	ftdw2.close();
 
 	fonts.insert(name, nullptr);
+	resetCurrentConfigFont();
 
 	ff8Font = font(name);
 	if (!ff8Font) {
@@ -429,6 +472,7 @@ bool FF8Font::removeFont(const QString &name)
 		return false;
 	}
 
+	resetCurrentConfigFont();
 	delete fonts.take(name);
 
 	return true;
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <QtCore>
+#include "FF8TextCodec.h"
 
 class TdwFile;
 
@@ -29,6 +30,8 @@ public:
 	const QList<QStringList> &tables() const;
 	void setTables(const QList<QStringList> &tables);
 	void setChar(int tableId, int charId, const QString &c);
+	// Built on first use from the tables, shared by the FF8Text using this font
+	QSharedPointer<const FF8TextCodec> codec() const;
 	bool isValid() const;
 	bool isModified() const;
 	void setModified(bool modified);
@@ -47,6 +50,7 @@ public:
 	static void deregisterFont(const QString &name);
 	static FF8Font *font(const QString &name);
 	static FF8Font *getCurrentConfigFont();
+	static void setCurrentConfigFont(const QString &name);
 	static bool saveFonts();
 	static bool copyFont(const QString &name, const QString &from, const QString &name2);
 	static bool removeFont(const QString &name);
@@ -59,8 +63,15 @@ private:
 	QString _txtPath, _tdwPath;
 	bool modified, readOnly;
 	QList<QStringList> _tables;
+	mutable QSharedPointer<const FF8TextCodec> _codec;
+	mutable QMutex codecMutex;
 
 	static FF8Font *openFont(const QString &tdwPath, const QString &txtPath);
+	static void resetCurrentConfigFont();
 	static QString font_dirPath;
 	static QMap<QString, FF8Font *> fonts;
+	// Avoid reading the config every time a text is decoded
+	static FF8Font *currentFont;
+	static bool currentFontCached;
+	static QMutex currentFontMutex;
 };
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <QtCore>
+#include "FF8TextCodec.h"
 
 class FF8Text : public QString
 {
@@ -26,16 +27,11 @@ public:
 	FF8Text(const QString &str);
 	FF8Text(const char *str);
 	FF8Text(const QByteArray &ba);
-	FF8Text(const QByteArray &ba, const QList<QStringList> &tables);
+	FF8Text(const QByteArray &ba, const QSharedPointer<const FF8TextCodec> &codec);
 	static QByteArray toFF8(const QString &string, bool jp);
 	QByteArray toFF8() const;
 	QString caract(quint8 ord, quint8 table = 0) const;
 	static QString getCaract(quint8 ord, quint8 table = 0, bool jp = false);
-	void setTables(const QList<QStringList> &tables);
 private:
-	QString fromFF8(const QByteArray &ff8str);
-	QList<QStringList> tables;
-	static const char *names[14];
-	static const char *colors[16];
-	static const char *locations[8];
+	QSharedPointer<const FF8TextCodec> _codec;
 };
@@ -0,0 +1,462 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "FF8TextCodec.h"
+
+FF8TextCodec::FF8TextCodec(const QList<QStringList> &tables) :
+	_tables(tables)
+{
+	const int tableCount = isJp() ? 4 : qMin(int(tables.size()), 1);
+
+	_chars.resize(tables.size() * 224);
+	for(int table=0 ; table<tables.size() ; ++table) {
+		const QStringList &chars = tables.at(table);
+		for(int i=0 ; i<224 && i<chars.size() ; ++i) {
+			_chars[table * 224 + i] = chars.at(i);
+		}
+	}
+
+	// The first occurrence of a character wins, table 0 first
+	for(int table=0 ; table<tableCount ; ++table) {
+		for(int i=0x20 ; i<=0xff ; ++i) {
+			const QString &c = ff8Char(quint8(i), quint8(table));
+			if(c.size() == 1 && !_charCodes.contains(c.at(0).unicode())) {
+				QByteArray ff8;
+				if(table > 0) {
+					ff8.append(char(0x18 + table));
+				}
+				_charCodes.insert(c.at(0).unicode(), ff8.append(char(i)));
+			}
+		}
+	}
+
+	_trie.append(TrieNode{u'\0', -1, -1, QList<qint32>()});
+
+	for(quint8 i=0 ; i<11 ; ++i) {
+		addToken(names[i], QByteArray("\x03").append(char(0x30 + i)), true);
+	}
+	addToken(names[11], "\x03\x40", true);
+	addToken(names[12], "\x03\x50", true);
+	addToken(names[13], "\x03\x60", true);
+	for(quint8 i=0 ; i<16 ; ++i) {
+		addToken(colors[i], QByteArray("\x06").append(char(0x20 + i)), false);
+	}
+	for(quint8 i=0 ; i<8 ; ++i) {
+		addToken(locations[i], QByteArray("\x0e").append(char(0x20 + i)), false);
+	}
+
+	// Checked after {Var}, {Wait} and {Jp}
+	_firstCaractToken = qint32(_tokens.size());
+	if(!tables.isEmpty()) {
+		for(int i=0xe8 ; i<=0xff ; ++i) {
+			const QString &c = ff8Char(quint8(i), 0);
+			if(c.startsWith('{') && c.size() <= 4) {
+				addToken(c, QByteArray(1, char(i)), true, true);
+			}
+		}
+	}
+}
+
+void FF8TextCodec::addToken(const QString &text, const QByteArray &ff8, bool caseSensitive, bool isCaract)
+{
+	qint32 node = 0;
+
+	for(QChar c: text) {
+		const char16_t folded = c.toCaseFolded().unicode();
+		qint32 child = _trie.at(node).child, last = -1;
+
+		while(child >= 0 && _trie.at(child).c != folded) {
+			last = child;
+			child = _trie.at(child).sibling;
+		}
+
+		if(child < 0) {
+			child = qint32(_trie.size());
+			_trie.append(TrieNode{folded, -1, -1, QList<qint32>()});
+			if(last < 0) {
+				_trie[node].child = child;
+			} else {
+				_trie[last].sibling = child;
+			}
+		}
+
+		node = child;
+	}
+
+	_trie[node].tokens.append(qint32(_tokens.size()));
+	_tokens.append(Token{text, ff8, caseSensitive, isCaract});
+}
+
+qint32 FF8TextCodec::matchToken(QStringView rest) const
+{
+	const qsizetype caractSize = qMin(rest.size(), qsizetype(4));
+	qint32 node = 0, best = -1;
+
+	for(qsizetype c=0 ; c<rest.size() ; ++c) {
+		const char16_t folded = rest.at(c).toCaseFolded().unicode();
+		qint32 child = _trie.at(node).child;
+
+		while(child >= 0 && _trie.at(child).c != folded) {
+			child = _trie.at(child).sibling;
+		}
+
+		if(child < 0) {
+			break;
+		}
+
+		node = child;
+
+		for(qint32 tokenID: _trie.at(node).tokens) {
+			if(best >= 0 && best < tokenID) {
+				break;
+			}
+
+			const Token &token = _tokens.at(tokenID);
+
+			if((!token.caseSensitive || rest.startsWith(token.text))
+			        && (!token.isCaract || token.text.size() == caractSize)) {
+				best = tokenID;
+				break;
+			}
+		}
+	}
+
+	return best;
+}
+
+QString FF8TextCodec::fromFF8(const QByteArray &ff8str) const
+{
+	QString ret;
+	const uchar *data = (const uchar *)ff8str.constData();
+	quint8 index, oldIndex;
+	const bool jp = isJp();
+	const bool hasTable = !_tables.isEmpty();
+	int size = ff8str.size();
+
+	ret.reserve(size);
+
+	for(int i=0 ; i<size ; ++i) {
+		index = data[i];
+		if(index==0x00)						break;
+		else if(index==0x01)
+			ret.append(QLatin1String("\n{NewPage}\n"));
+		else if(index==0x02)
+			ret.append(QLatin1Char('\n'));
+		else if(index==0x03) {//{Name}
+			if((++i) < size) {
+				index = data[i];
+				if(index>=0x30 && index<=0x3a)
+					ret.append(QLatin1String(names[index-0x30]));
+				else if(index==0x40)
+					ret.append(QLatin1String(names[11]));
+				else if(index==0x50)
+					ret.append(QLatin1String(names[12]));
+				else if(index==0x60)
+					ret.append(QLatin1String(names[13]));
+				else {
+					ret.append(QLatin1String("{x03"));
+					appendHex(ret, index);
+					ret.append(QLatin1Char('}'));
+				}
+			}
+			else
+				ret.append(QLatin1String("{x03}"));
+		}
+		else if(index==0x04) {//{Var0}, {Var00} et {Varb0}
+			if((++i) < size) {
+				index = data[i];
+				if(index>=0x20 && index<=0x27) {
+					ret.append(QLatin1String("{Var"));
+					appendNumber(ret, index-0x20, 1);
+					ret.append(QLatin1Char('}'));
+				} else if(index>=0x30 && index<=0x37) {
+					ret.append(QLatin1String("{Var0"));
+					appendNumber(ret, index-0x30, 1);
+					ret.append(QLatin1Char('}'));
+				} else if(index>=0x40 && index<=0x47) {
+					ret.append(QLatin1String("{Varb"));
+					appendNumber(ret, index-0x40, 1);
+					ret.append(QLatin1Char('}'));
+				} else {
+					ret.append(QLatin1String("{x04"));
+					appendHex(ret, index);
+					ret.append(QLatin1Char('}'));
+				}
+			}
+			else
+				ret.append(QLatin1String("{x04}"));
+		}
+		else if(index==0x06) {//{Color}
+			if((++i) < size) {
+				index = data[i];
+				if(index>=0x20 && index<=0x2f)
+					ret.append(QLatin1String(colors[index-0x20]));
+				else {
+					ret.append(QLatin1String("{x06"));
+					appendHex(ret, index);
+					ret.append(QLatin1Char('}'));
+				}
+			}
+			else
+				ret.append(QLatin1String("{x06}"));
+		}
+		else if(index==0x09) {//{Wait000}
+			if((++i) < size) {
+				index = data[i];
+				if(index>=0x20) {
+					ret.append(QLatin1String("{Wait"));
+					appendNumber(ret, index-0x20, 3);
+					ret.append(QLatin1Char('}'));
+				} else {
+					ret.append(QLatin1String("{x09"));
+					appendHex(ret, index);
+					ret.append(QLatin1Char('}'));
+				}
+			}
+			else
+				ret.append(QLatin1String("{x09}"));
+		}
+		else if(index==0x0e) {//{Location}
+			if((++i) < size) {
+				index = data[i];
+				if(index>=0x20 && index<=0x27)
+					ret.append(QLatin1String(locations[index-0x20]));
+				else {
+					ret.append(QLatin1String("{x0e"));
+					appendHex(ret, index);
+					ret.append(QLatin1Char('}'));
+				}
+			}
+			else
+				ret.append(QLatin1String("{x0e}"));
+		}
+		else if(jp && index>=0x19 && index<=0x1b) {//jp19, jp1a, jp1b
+			if((++i) < size) {
+				oldIndex = index;
+				index = data[i];
+				if(index>=0x20 && !ff8Char(index, oldIndex-0x18).isEmpty()) {
+					ret.append(ff8Char(index, oldIndex-0x18));
+				} else {
+					ret.append(QLatin1String("{x"));
+					appendHex(ret, oldIndex);
+					appendHex(ret, index);
+					ret.append(QLatin1Char('}'));
+				}
+			} else {
+				ret.append(QLatin1String("{x"));
+				appendHex(ret, index);
+				ret.append(QLatin1Char('}'));
+			}
+		}
+		else if(index==0x1c) {//addJp
+			if((++i) < size) {
+				index = data[i];
+				if(index>=0x20) {
+					ret.append(QLatin1String("{Jp"));
+					appendNumber(ret, index-0x20, 3);
+					ret.append(QLatin1Char('}'));
+				} else {
+					ret.append(QLatin1String("{x1c"));
+					appendHex(ret, index);
+					ret.append(QLatin1Char('}'));
+				}
+			} else {
+				ret.append(QLatin1String("{x1c}"));
+			}
+		}
+		else if(index>=0x05 && index<=0x1f) {
+			ret.append(QLatin1String("{x"));
+			appendHex(ret, index);
+			if((++i) < size)
+				appendHex(ret, data[i]);
+			ret.append(QLatin1Char('}'));
+		}
+		else if(hasTable && !ff8Char(index, 0).isEmpty()) {
+			ret.append(ff8Char(index, 0));
+		}
+		else {
+			ret.append(QLatin1String("{x"));
+			appendHex(ret, index);
+			ret.append(QLatin1Char('}'));
+		}
+	}
+
+	return ret;
+}
+
+QByteArray FF8TextCodec::toFF8(QStringView string) const
+{
+	QByteArray ff8str;
+	QChar comp;
+	qsizetype stringSize = string.size();
+	bool ok, ok2;
+	ushort value, value2;
+
+	ff8str.reserve(stringSize);
+
+	for(qsizetype c = 0; c < stringSize; ++c)
+	{
+		comp = string.at(c);
+		if(comp=='\n') {//\n{NewPage}\n,\n
+			if(string.mid(c+1, 10).compare(QLatin1String("{NewPage}\n"), Qt::CaseInsensitive) == 0) {
+				ff8str.append('\x01');
+				c += 10;
+			}
+			else
+				ff8str.append('\x02');
+			continue;
+		}
+		else if(comp=='{') {
+			QStringView rest = string.mid(c);
+			// {Name}, {Color}, {Location} and the 0xe8-0xff characters
+			qint32 tokenID = matchToken(rest);
+
+			if(tokenID >= 0 && tokenID < _firstCaractToken) {
+				ff8str.append(_tokens.at(tokenID).ff8);
+				c += _tokens.at(tokenID).text.size()-1;
+				continue;
+			}
+			if(rest.size() >= 7) {
+				if(rest.startsWith(QLatin1String("{Var0"), Qt::CaseInsensitive) && rest.at(6)=='}') {//{Var00}
+					value = rest.mid(5,1).toUShort(&ok);
+					if(ok && value<8) {
+						ff8str.append('\x04');
+						ff8str.append((char)(value+0x30));
+						c += 6;
+						continue;
+					}
+				}
+				if(rest.startsWith(QLatin1String("{Varb"), Qt::CaseInsensitive) && rest.at(6)=='}') {//{Varb0}
+					value = rest.mid(5,1).toUShort(&ok);
+					if(ok && value<8) {
+						ff8str.append('\x04');
+						ff8str.append((char)(value+0x40));
+						c += 6;
+						continue;
+					}
+				}
+			}
+			if(rest.startsWith(QLatin1String("{Var"), Qt::CaseInsensitive) && rest.size() >= 6 && rest.at(5)=='}') {//{Var0}
+				value = rest.mid(4,1).toUShort(&ok);
+				if(ok && value<8) {
+					ff8str.append('\x04');
+					ff8str.append((char)(value+0x20));
+					c += 5;
+					continue;
+				}
+			}
+			if(rest.startsWith(QLatin1String("{Wait"), Qt::CaseInsensitive) && rest.size() >= 9 && rest.at(8)=='}') {//{Wait000}
+				value = rest.mid(5,3).toUShort(&ok);
+				if(ok) {
+					ff8str.append('\x09');
+					ff8str.append((char)(value+0x20));
+					c += 8;
+					continue;
+				}
+			}
+			if(rest.startsWith(QLatin1String("{Jp"), Qt::CaseInsensitive) && rest.size() >= 7 && rest.at(6)=='}') {//{Jp000}
+				value = rest.mid(3,3).toUShort(&ok);
+				if(ok) {
+					ff8str.append('\x1c');
+					ff8str.append((char)(value+0x20));
+					c += 6;
+					continue;
+				}
+			}
+			if(tokenID >= 0) {
+				ff8str.append(_tokens.at(tokenID).ff8);
+				c += 3;
+				continue;
+			}
+
+			if(rest.size() > 1 && rest.at(1)=='x') {
+				if(rest.size() >= 5 && rest.at(4)=='}') {//{xff}
+					value = rest.mid(2,2).toUShort(&ok,16);
+					if(ok) {
+						ff8str.append((char)value);
+						c += 4;
+						continue;
+					}
+				}
+				else if(rest.size() >= 7 && rest.at(6)=='}') {//{xffff}
+					value = rest.mid(2,2).toUShort(&ok,16);
+					value2 = rest.mid(4,2).toUShort(&ok2,16);
+					if(ok && ok2) {
+						ff8str.append((char)value);
+						ff8str.append((char)value2);
+						c += 6;
+						continue;
+					}
+				}
+			}
+
+			continue;// character '{' is not in ff8 table
+		}
+
+		QHash<char16_t, QByteArray>::const_iterator it = _charCodes.constFind(comp.unicode());
+		if(it != _charCodes.constEnd()) {
+			ff8str.append(*it);
+		}
+	}
+
+	return ff8str;
+}
+
+QString FF8TextCodec::caract(quint8 ord, quint8 table) const
+{
+	if(table < _tables.size() && ord >= 0x20) {
+		return ff8Char(ord, table);
+	}
+
+	return QString();
+}
+
+void FF8TextCodec::appendHex(QString &ret, quint8 value)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	ret.append(QLatin1Char(digits[value >> 4]));
+	ret.append(QLatin1Char(digits[value & 0xf]));
+}
+
+void FF8TextCodec::appendNumber(QString &ret, int value, int width)
+{
+	char digits[3];
+
+	for(int i=width-1 ; i>=0 ; --i) {
+		digits[i] = char('0' + value % 10);
+		value /= 10;
+	}
+
+	ret.append(QLatin1String(digits, width));
+}
+
+const char *FF8TextCodec::names[14] =
+{
+	"{Squall}","{Zell}","{Irvine}","{Quistis}","{Rinoa}","{Selphie}","{Seifer}","{Edea}","{Laguna}","{Kiros}","{Ward}","{Angelo}","{Griever}","{Boko}"
+};
+
+const char *FF8TextCodec::colors[16] =
+{
+	"{Darkgrey}","{Grey}","{Yellow}","{Red}","{Green}","{Blue}","{Purple}","{White}",
+	"{DarkgreyBlink}","{GreyBlink}","{YellowBlink}","{RedBlink}","{GreenBlink}","{BlueBlink}","{PurpleBlink}","{WhiteBlink}"
+};
+
+const char *FF8TextCodec::locations[8] =
+{
+	"{Galbadia}","{Esthar}","{Balamb}","{Dollet}","{Timber}","{Trabia}","{Centra}","{Horizon}"
+};
@@ -0,0 +1,68 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#pragma once
+
+#include <QtCore>
+
+/*
+ * Conversion between FF8 text and QString for one font table,
+ * built once by FF8Font and shared by every FF8Text using this font.
+ */
+class FF8TextCodec
+{
+public:
+	explicit FF8TextCodec(const QList<QStringList> &tables);
+	QString fromFF8(const QByteArray &ff8str) const;
+	QByteArray toFF8(QStringView string) const;
+	QString caract(quint8 ord, quint8 table = 0) const;
+	inline const QList<QStringList> &tables() const {
+		return _tables;
+	}
+	inline bool isJp() const {
+		return _tables.size() == 4;
+	}
+private:
+	// Tokens starting with '{', matched in this order by toFF8()
+	struct Token {
+		QString text;
+		QByteArray ff8;
+		bool caseSensitive;
+		bool isCaract; // Table entry, the 4 next characters must match exactly
+	};
+	struct TrieNode {
+		char16_t c;
+		qint32 sibling, child;
+		QList<qint32> tokens; // Ordered like _tokens
+	};
+	void addToken(const QString &text, const QByteArray &ff8, bool caseSensitive, bool isCaract = false);
+	qint32 matchToken(QStringView rest) const;
+	inline const QString &ff8Char(quint8 ord, quint8 table) const {
+		return _chars.at(table * 224 + ord - 0x20);
+	}
+	static void appendHex(QString &ret, quint8 value);
+	static void appendNumber(QString &ret, int value, int width);
+	QList<QStringList> _tables;
+	QList<QString> _chars; // 224 characters per table, empty if unknown
+	QHash<char16_t, QByteArray> _charCodes; // One character to FF8
+	QList<Token> _tokens;
+	QList<TrieNode> _trie; // Case folded tokens, the root is the first node
+	qint32 _firstCaractToken;
+	static const char *names[14];
+	static const char *colors[16];
+	static const char *locations[8];
+};
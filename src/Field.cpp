@@ -21,7 +21,7 @@
 Map *Field::worldmapFile = nullptr;
 
 Field::Field(const QString &name)
-	: _isOpen(false), _name(name)
+	: _isOpen(false), _isLazy(false), _isLoaded(1), _name(name)
 {
 	worldmapFile = nullptr;
 
@@ -49,6 +49,71 @@ void Field::setOpen(bool open)
 	_isOpen = open;
 }
 
+bool Field::isLazy() const
+{
+	return _isLazy;
+}
+
+void Field::setLazy(bool lazy)
+{
+	_isLazy = lazy;
+	_isLoaded.storeRelease(!lazy);
+}
+
+bool Field::isLoaded() const
+{
+	return _isLoaded.loadAcquire();
+}
+
+bool Field::load()
+{
+	return true;
+}
+
+bool Field::ensureLoaded() const
+{
+	if (_isLoaded.loadAcquire()) {
+		return true;
+	}
+
+	QMutexLocker locker(&_loadMutex);
+
+	if (_isLoaded.loadRelaxed()) {
+		return true;
+	}
+
+	bool ok = const_cast<Field *>(this)->load();
+	if (!ok) {
+		qWarning() << "Field::ensureLoaded error" << _name;
+	}
+	// Even on error, to not retry on every access
+	_isLoaded.storeRelease(1);
+
+	return ok;
+}
+
+bool Field::unload()
+{
+	QMutexLocker locker(&_loadMutex);
+
+	if (!_isLazy || !_isLoaded.loadRelaxed() || isModified()) {
+		return false;
+	}
+
+	for (int i = 0; i < files.size(); ++i) {
+		deleteFile(FileType(i));
+	}
+
+	_isLoaded.storeRelease(0);
+
+	return true;
+}
+
+qint64 Field::dataSize() const
+{
+	return 0;
+}
+
 bool Field::isPc() const
 {
 	return false;
@@ -61,7 +126,9 @@ bool Field::isPs() const
 
 void Field::openFile(FileType fileType, const QByteArray &data)
 {
-	PmpFile::currentFieldName = _name;
+	if (fileType == Pmp) {
+		PmpFile::currentFieldName = _name;
+	}
 	deleteFile(fileType);
 	File *f = newFile(fileType);
 
@@ -84,12 +151,11 @@ void Field::openJsmFile(const QByteArray &jsm, const QByteArray &sym, bool oldFo
 
 void Field::openBackgroundFile(const QByteArray &map, const QByteArray &mim)
 {
-	BackgroundFile *f;
+	// Do not use getFile() here, this method can be called by load()
+	BackgroundFile *f = (BackgroundFile *)files.at(Background);
 
-	if (!hasBackgroundFile()) {
+	if (f == nullptr) {
 		f = (BackgroundFile *)newFile(Background);
-	} else {
-		f = getBackgroundFile();
 	}
 
 	/* QMultiMap<quint8, quint8> params;
@@ -155,7 +221,7 @@ File *Field::newFile(FileType fileType)
 
 void Field::deleteFile(FileType fileType)
 {
-	File *f = getFile(fileType);
+	File *f = files.at(fileType);
 
 	if (f != nullptr && worldmapFile == nullptr) {
 		delete f;
@@ -263,6 +329,11 @@ bool Field::hasWorldmapFile() const
 
 bool Field::hasFiles() const
 {
+	// Lazy fields are indexed only if they have files
+	if (!isLoaded()) {
+		return true;
+	}
+
 	for (int i = 0; i < files.size(); ++i) {
 		if (hasFile(FileType(i))) {
 			return true;
@@ -283,6 +354,8 @@ File *Field::getFile(FileType fileType) const
 		return worldmapFile->textsPtr();
 	}
 
+	ensureLoaded();
+
 	return files.at(fileType);
 }
 
@@ -418,12 +491,17 @@ void Field::addAkaoListFile()
 
 void Field::setFile(FileType fileType)
 {
+	ensureLoaded();
 	deleteFile(fileType);
 	newFile(fileType);
 }
 
 bool Field::isModified() const
 {
+	if (!isLoaded()) {
+		return false;
+	}
+
 	for (File *f: files) {
 		if (f && f->isModified()) {
 			return true;
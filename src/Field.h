@@ -56,6 +56,11 @@ public:
 	virtual ~Field();
 
 	bool isOpen() const;
+	// A lazy field is indexed at open, its files are parsed on first access
+	bool isLazy() const;
+	bool isLoaded() const;
+	bool unload();
+	virtual qint64 dataSize() const;
 
 	virtual bool isPc() const;
 	virtual bool isPs() const;
@@ -123,12 +128,17 @@ protected:
 	void openBackgroundFile(const QByteArray &map, const QByteArray &mim);
 	void openCharaFile(const QByteArray &one);
 	virtual void setFile(FileType fileType);
+	void setLazy(bool lazy);
+	virtual bool load();
 private:
+	bool ensureLoaded() const;
 	File *newFile(FileType fileType);
 	void deleteFile(FileType fileType);
 	void deleteCharaFile();
 
-	bool _isOpen;
+	bool _isOpen, _isLazy;
+	mutable QAtomicInt _isLoaded;
+	mutable QMutex _loadMutex;
 	QString _name;
 	static CharaFile *charaFile;
 	static Map *worldmapFile;
@@ -18,10 +18,16 @@
 #include "FieldArchive.h"
 #include "Data.h"
 #include "Field.h"
+#include "FF8Font.h"
+#include "FieldArchiveIndex.h"
 #include "game/worldmap/Map.h"
 
+// Recently used lazy fields never evicted, even above the memory budget
+#define LAZY_KEEP_RECENT	4
+
 FieldArchive::FieldArchive()
-    : _worldMap(nullptr), readOnly(false)
+    : _worldMap(nullptr), readOnly(false), accessCounter(0), loadedSize(0), _currentField(nullptr),
+      searchCount(0), _index(nullptr), _memoryBudget(-1)
 {
 }
 
@@ -31,6 +37,9 @@ FieldArchive::~FieldArchive()
 	if (_worldMap != nullptr) {
 		delete _worldMap;
 	}
+	if (_index != nullptr) {
+		delete _index;
+	}
 }
 
 void FieldArchive::clearFields()
@@ -40,7 +49,16 @@ void FieldArchive::clearFields()
 	models.clear();
 	fieldsSortByName.clear();
 	fieldsSortByDesc.clear();
+	fieldsWithoutDesc.clear();
 	fieldsSortByMapId.clear();
+	lastAccess.clear();
+	loadedSizes.clear();
+	loadedSize = 0;
+	_currentField = nullptr;
+	if (_index != nullptr) {
+		delete _index;
+		_index = nullptr;
+	}
 	if (_worldMap != nullptr) {
 		delete _worldMap;
 		_worldMap = nullptr;
@@ -54,14 +72,81 @@ const QString &FieldArchive::errorMessage() const
 
 Field *FieldArchive::getField(int id) const
 {
-//	Field *field = fields.value(id, nullptr);
-//	if (field == nullptr)	return nullptr;
-//	if (!field->isOpen() && openField(field)) {
-//		return field;
-//	}
-//	if (!field->isOpen())	return nullptr;
+	Field *field = fields.value(id, nullptr);
+
+	if (field != nullptr && field->isLazy()) {
+		touchField(field);
+	}
+
+	return field;
+}
+
+void FieldArchive::touchField(Field *field) const
+{
+	lastAccess.insert(field, ++accessCounter);
+
+	// Fields already counted are not evicted again on every lookup
+	if (!loadedSizes.contains(field)) {
+		addLoadedField(field);
+		evictFields();
+	}
+}
+
+void FieldArchive::addLoadedField(Field *field) const
+{
+	qint64 size = field->dataSize();
+	loadedSizes.insert(field, size);
+	loadedSize += size;
+}
 
-	return fields.value(id, nullptr);
+void FieldArchive::addLoadedFields() const
+{
+	for (Field *field: fields) {
+		if (field->isLazy() && field->isLoaded() && !loadedSizes.contains(field)) {
+			addLoadedField(field);
+		}
+	}
+}
+
+void FieldArchive::setMemoryBudget(qint64 memoryBudget)
+{
+	_memoryBudget = memoryBudget;
+}
+
+void FieldArchive::setCurrentField(Field *field)
+{
+	_currentField = field;
+}
+
+void FieldArchive::evictFields() const
+{
+	if (_memoryBudget < 0 || searchCount > 0 || loadedSize <= _memoryBudget) {
+		return;
+	}
+
+	// Fields loaded by archive-wide operations were never touched and go first
+	QMultiMap<quint64, Field *> loadedFields;
+
+	QHashIterator<Field *, qint64> i(loadedSizes);
+	while (i.hasNext()) {
+		i.next();
+		loadedFields.insert(lastAccess.value(i.key(), 0), i.key());
+	}
+
+	QMultiMap<quint64, Field *>::const_iterator it = loadedFields.constBegin();
+	qsizetype evictable = loadedFields.size() - LAZY_KEEP_RECENT;
+
+	while (loadedSize > _memoryBudget && evictable > 0) {
+		Field *field = it.value();
+
+		// Counted but never loaded: nothing to free
+		if (field != _currentField && (!field->isLoaded() || field->unload())) {
+			loadedSize -= loadedSizes.take(field);
+		}
+
+		++it;
+		--evictable;
+	}
 }
 
 Field *FieldArchive::getFieldFromMapId(int mapId) const
@@ -71,6 +156,48 @@ Field *FieldArchive::getFieldFromMapId(int mapId) const
 	return getField(fieldId);
 }
 
+bool FieldArchive::openBG(Field *field) const
+{
+	BGData data;
+
+	return readBG(field, data) && openBG(field, data);
+}
+
+QList<Field *> FieldArchive::neighbourFields(Field *field) const
+{
+	QList<int> mapIds;
+
+	if (field->hasInfFile()) {
+		for (const Gateway &gateway: field->getInfFile()->getGateways()) {
+			if (gateway.fieldId != 0x7FFF && !mapIds.contains(gateway.fieldId)) {
+				mapIds.append(gateway.fieldId);
+			}
+		}
+	}
+
+	if (field->hasJsmFile()) {
+		for (int mapId: field->getJsmFile()->searchAllMapJumps()) {
+			if (!mapIds.contains(mapId)) {
+				mapIds.append(mapId);
+			}
+		}
+	}
+
+	QList<Field *> ret;
+
+	for (int mapId: mapIds) {
+		// Do not use getFieldFromMapId(), the neighbours are not accessed by the user
+		int fieldId = fieldsSortByMapId.value(QString("%1").arg(mapId, 3, 10, QChar('0')), -1);
+		Field *neighbour = fields.value(fieldId, nullptr);
+
+		if (neighbour != nullptr && neighbour != field && neighbour->isOpen() && !ret.contains(neighbour)) {
+			ret.append(neighbour);
+		}
+	}
+
+	return ret;
+}
+
 const QList<Field *> &FieldArchive::getFields() const
 {
 	return fields;
@@ -112,6 +239,26 @@ bool FieldArchive::compileScripts(int &errorFieldID, int &errorGroupID, int &err
 	return true;
 }
 
+// Not done when a field is loaded, to keep valid the iterators of a search in progress
+void FieldArchive::updateDescs() const
+{
+	QList<int>::iterator it = fieldsWithoutDesc.begin();
+
+	while (it != fieldsWithoutDesc.end()) {
+		Field *field = fields.value(*it, nullptr);
+
+		if (field == nullptr || field->isLoaded()) {
+			if (field != nullptr && field->hasJsmFile()) {
+				fieldsSortByDesc.remove(fieldsSortByDesc.key(*it), *it);
+				fieldsSortByDesc.insert(Data::location(field->getJsmFile()->mapID()), *it);
+			}
+			it = fieldsWithoutDesc.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
 bool FieldArchive::searchIterators(QMultiMap<QString, int>::const_iterator &i, QMultiMap<QString, int>::const_iterator &end, int fieldID, Sorting sorting) const
 {
 	if (fieldID >= fields.size())		return false;
@@ -125,6 +272,7 @@ bool FieldArchive::searchIterators(QMultiMap<QString, int>::const_iterator &i, Q
 		}
 		return true;
 	case SortByDesc:
+		updateDescs();
 		i = fieldsSortByDesc.constFind(fieldsSortByDesc.key(fieldID), fieldID);
 		end = fieldsSortByDesc.constEnd();
 		if (i==end) {
@@ -155,6 +303,7 @@ bool FieldArchive::searchIteratorsP(QMultiMap<QString, int>::const_iterator &i,
 		}
 		return true;
 	case SortByDesc:
+		updateDescs();
 		begin = fieldsSortByDesc.constBegin();
 		i = fieldsSortByDesc.constFind(fieldsSortByDesc.key(fieldID), fieldID);
 		if (i==fieldsSortByDesc.constEnd()) {
@@ -284,16 +433,252 @@ bool FieldArchive::searchScriptTextReverse(const QRegularExpression &text, int &
 	return false;
 }
 
+QList<int> FieldArchive::sortedFieldIDs(Sorting sorting) const
+{
+	switch (sorting) {
+	case SortByName:
+		return fieldsSortByName.values();
+	case SortByDesc:
+		updateDescs();
+		return fieldsSortByDesc.values();
+	case SortByMapId:
+		return fieldsSortByMapId.values();
+	}
+
+	return QList<int>();
+}
+
+template<typename Result, typename SearchField>
+QList<Result> FieldArchive::findAll(Sorting sorting, SearchObserver *observer, SearchField searchField,
+                                    void (SearchObserver::*addResults)(const QList<Result> &)) const
+{
+	QList<int> fieldIDs = sortedFieldIDs(sorting);
+	// Results by position in fieldIDs, each one written by only one task
+	QList<QList<Result> > resultsByField(fieldIDs.size());
+	QList<int> searchedFields;
+	QMutex searchedFieldsMutex;
+	QAtomicInt canceled = 0;
+	QThreadPool pool;
+	int searchedCount = 0;
+
+	if (observer) {
+		observer->setObserverMaximum(fieldIDs.size());
+	}
+
+	++searchCount;
+
+	for (int i = 0; i < fieldIDs.size(); ++i) {
+		int fieldID = fieldIDs.at(i);
+		Field *field = fields.value(fieldID, nullptr);
+
+		if (field == nullptr || !field->isOpen()) {
+			++searchedCount;
+			continue;
+		}
+
+		QList<Result> *results = &resultsByField[i];
+
+		pool.start([searchField, field, fieldID, i, results, &searchedFields, &searchedFieldsMutex, &canceled]() {
+			if (canceled.loadRelaxed()) {
+				return;
+			}
+
+			searchField(field, fieldID, *results);
+
+			QMutexLocker locker(&searchedFieldsMutex);
+			searchedFields.append(i);
+		});
+	}
+
+	auto flushResults = [&]() {
+		QList<int> ids;
+		{
+			QMutexLocker locker(&searchedFieldsMutex);
+			ids.swap(searchedFields);
+		}
+		searchedCount += ids.size();
+
+		if (observer) {
+			for (int i: ids) {
+				if (!resultsByField.at(i).isEmpty()) {
+					(observer->*addResults)(resultsByField.at(i));
+				}
+			}
+			observer->setObserverValue(searchedCount);
+		}
+	};
+
+	while (!pool.waitForDone(50)) {
+		QCoreApplication::processEvents();
+
+		if (observer && observer->observerWasCanceled()) {
+			canceled.storeRelaxed(1);
+		}
+
+		flushResults();
+	}
+
+	flushResults();
+
+	--searchCount;
+
+	addLoadedFields();
+	evictFields();
+
+	QList<Result> ret;
+
+	for (const QList<Result> &results: resultsByField) {
+		ret.append(results);
+	}
+
+	return ret;
+}
+
+const FieldArchiveIndex *FieldArchive::index() const
+{
+	if (_index == nullptr) {
+		_index = new FieldArchiveIndex(this);
+	}
+
+	_index->update();
+
+	// The update loads the outdated fields, the index stays valid once they are unloaded
+	addLoadedFields();
+	evictFields();
+
+	return _index;
+}
+
+void FieldArchive::sortResults(QList<ScriptSearchResult> &results, Sorting sorting, SearchObserver *observer) const
+{
+	QList<int> fieldIDs = sortedFieldIDs(sorting);
+	QList<int> rank(fields.size(), fieldIDs.size());
+
+	for (int i = 0; i < fieldIDs.size(); ++i) {
+		rank[fieldIDs.at(i)] = i;
+	}
+
+	std::stable_sort(results.begin(), results.end(), [&rank](const ScriptSearchResult &a, const ScriptSearchResult &b) {
+		return rank.at(a.fieldID) < rank.at(b.fieldID);
+	});
+
+	if (observer == nullptr) {
+		return;
+	}
+
+	observer->setObserverMaximum(results.size());
+
+	for (qsizetype i = 0; i < results.size(); ) {
+		qsizetype j = i + 1;
+		while (j < results.size() && results.at(j).fieldID == results.at(i).fieldID) {
+			++j;
+		}
+		observer->addScriptResults(results.mid(i, j - i));
+		observer->setObserverValue(int(j));
+		i = j;
+	}
+}
+
+QList<FieldArchive::TextSearchResult> FieldArchive::findAllText(const QRegularExpression &text, Sorting sorting, SearchObserver *observer) const
+{
+	// The font is read from the config, which must stay in this thread
+	QSharedPointer<const FF8TextCodec> codec = FF8Font::getCurrentConfigFont()->codec();
+	QString literal;
+	const FieldArchiveIndex *idx = FieldArchiveIndex::literalPattern(text, literal) ? index() : nullptr;
+
+	return findAll<TextSearchResult>(sorting, observer, [text, codec, literal, idx](Field *field, int fieldID, QList<TextSearchResult> &results) {
+		if (!field->hasMsdFile()) {
+			return;
+		}
+
+		MsdFile *msd = field->getMsdFile();
+		QList<int> textIDs;
+		bool filtered = idx != nullptr && idx->textCandidates(fieldID, literal, textIDs);
+		int textCount = filtered ? int(textIDs.size()) : msd->nbText();
+
+		for (int i = 0; i < textCount; ++i) {
+			int textID = filtered ? textIDs.at(i) : i;
+			FF8Text str(msd->data(textID), codec);
+			QRegularExpressionMatch match = text.match(str);
+
+			while (match.hasMatch()) {
+				TextSearchResult result;
+				result.fieldID = fieldID;
+				result.textID = textID;
+				result.from = int(match.capturedStart());
+				result.size = int(match.capturedLength());
+				results.append(result);
+
+				match = text.match(str, match.capturedStart() + 1);
+			}
+		}
+	}, &SearchObserver::addTextResults);
+}
+
+static void findAllScriptInField(JsmFile *jsm, JsmFile::SearchType type, const QList<quint64> &values,
+                                 int fieldID, QList<FieldArchive::ScriptSearchResult> &results)
+{
+	int groupID = 0, methodID = 0, opcodeID = 0;
+
+	while (jsm->search(type, values, groupID, methodID, opcodeID)) {
+		FieldArchive::ScriptSearchResult result;
+		result.fieldID = fieldID;
+		result.groupID = groupID;
+		result.methodID = methodID;
+		result.opcodeID = opcodeID;
+		results.append(result);
+
+		++opcodeID;
+	}
+}
+
+QList<FieldArchive::ScriptSearchResult> FieldArchive::findAllScript(JsmFile::SearchType type, quint64 value, Sorting sorting, SearchObserver *observer) const
+{
+	QList<ScriptSearchResult> results = index()->findScript(type, value);
+
+	sortResults(results, sorting, observer);
+
+	return results;
+}
+
+QList<FieldArchive::ScriptSearchResult> FieldArchive::findAllScriptText(const QRegularExpression &text, Sorting sorting, SearchObserver *observer) const
+{
+	QSharedPointer<const FF8TextCodec> codec = FF8Font::getCurrentConfigFont()->codec();
+	QString literal;
+	const FieldArchiveIndex *idx = FieldArchiveIndex::literalPattern(text, literal) ? index() : nullptr;
+
+	return findAll<ScriptSearchResult>(sorting, observer, [text, codec, literal, idx](Field *field, int fieldID, QList<ScriptSearchResult> &results) {
+		if (!field->hasMsdFile() || !field->hasJsmFile()) {
+			return;
+		}
+
+		MsdFile *msd = field->getMsdFile();
+		QList<int> candidates;
+		bool filtered = idx != nullptr && idx->textCandidates(fieldID, literal, candidates);
+		int textCount = filtered ? int(candidates.size()) : msd->nbText();
+		QList<quint64> textIDs;
+
+		for (int i = 0; i < textCount; ++i) {
+			int textID = filtered ? candidates.at(i) : i;
+			if (text.match(FF8Text(msd->data(textID), codec)).hasMatch()) {
+				textIDs.append(quint64(textID));
+			}
+		}
+
+		if (!textIDs.isEmpty()) {
+			findAllScriptInField(field->getJsmFile(), JsmFile::SearchText, textIDs, fieldID, results);
+		}
+	}, &SearchObserver::addScriptResults);
+}
+
 QMultiMap<int, QString> FieldArchive::searchAllVars() const
 {
 	QMultiMap<int, QString> vars;
+	const FieldArchiveIndex *idx = index();
 
-	for (Field *field: fields) {
-		if (field->hasJsmFile()) {
-			QList<int> v = field->getJsmFile()->searchAllVars();
-			for (int var: v)
-				vars.insert(var, field->name());
-		}
+	for (int fieldID = 0; fieldID < fields.size(); ++fieldID) {
+		for (int var: idx->vars(fieldID))
+			vars.insert(var, fields.at(fieldID)->name());
 	}
 
 	return vars;
@@ -335,10 +720,12 @@ QList<int> FieldArchive::searchAllCardPlayers(int fieldID) const
 QMap<Field *, QList<int> > FieldArchive::searchAllBattles() const
 {
 	QMap<Field *, QList<int> > battles;
+	const FieldArchiveIndex *idx = index();
 
-	for (Field *field: fields) {
-		if (field->hasMrtFile()) {
-			battles.insert(field, field->getMrtFile()->searchAllBattles());
+	for (int fieldID = 0; fieldID < fields.size(); ++fieldID) {
+		QList<int> fieldBattles;
+		if (idx->battles(fieldID, fieldBattles)) {
+			battles.insert(fields.at(fieldID), fieldBattles);
 		}
 	}
 
@@ -359,16 +746,21 @@ QMultiMap<int, Field *> FieldArchive::searchAllMoments() const
 		}
 	}
 
+	addLoadedFields();
+	evictFields();
+
 	return moments;
 }
 
 QMap<int, int> FieldArchive::searchAllOpcodeTypes() const
 {
 	QMap<int, int> ret;
+	const FieldArchiveIndex *idx = index();
 
-	for (Field *field: fields) {
-		if (field->hasJsmFile()) {
-			field->getJsmFile()->searchAllOpcodeTypes(ret);
+	for (int fieldID = 0; fieldID < fields.size(); ++fieldID) {
+		const QMap<int, int> &types = idx->opcodeTypes(fieldID);
+		for (auto it = types.constBegin(); it != types.constEnd(); ++it) {
+			ret.insert(it.key(), it.value());
 		}
 	}
 
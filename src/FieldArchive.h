@@ -19,10 +19,11 @@
 
 #include <QtCore>
 #include "files/JsmFile.h"
+#include "ArchiveObserver.h"
 #include "Vertex.h"
 
 class Field;
-struct ArchiveObserver;
+class FieldArchiveIndex;
 class CharaModel;
 class Map;
 
@@ -34,6 +35,17 @@ public:
 	enum Sorting{
 		SortByName, SortByDesc, SortByMapId
 	};
+	struct TextSearchResult {
+		int fieldID, textID, from, size;
+	};
+	struct ScriptSearchResult {
+		int fieldID, groupID, methodID, opcodeID;
+	};
+	// Receives the results of a field as soon as it is searched, in the thread of the caller
+	struct SearchObserver : public ArchiveObserver {
+		virtual void addTextResults(const QList<TextSearchResult> &results) { Q_UNUSED(results) }
+		virtual void addScriptResults(const QList<ScriptSearchResult> &results) { Q_UNUSED(results) }
+	};
 
 	FieldArchive();
 	virtual ~FieldArchive();
@@ -50,9 +62,21 @@ public:
 	CharaModel getModel(int id) const;
 	QHash<int, CharaModel> *getModels();
 	bool isReadOnly() const;
+	void setMemoryBudget(qint64 memoryBudget);
+	// The current field is displayed, it is never evicted
+	void setCurrentField(Field *field);
+	// Count the lazy fields loaded outside getField(), by archive-wide operations
+	void addLoadedFields() const;
+	void evictFields() const;
 	virtual int open(const QString &, ArchiveObserver *progress)=0;
 	virtual bool openModels()=0;
-	virtual bool openBG(Field *field) const=0;
+	// Second-stage files of a field: read by readBG() from any thread, parsed by openBG() in the field thread
+	typedef QMap<int, QByteArray> BGData;
+	bool openBG(Field *field) const;
+	virtual bool readBG(Field *field, BGData &data) const=0;
+	virtual bool openBG(Field *field, const BGData &data) const=0;
+	// Fields reachable from this one through its gateways and its map jumps
+	QList<Field *> neighbourFields(Field *field) const;
 	bool compileScripts(int &errorFieldID, int &errorGroupID, int &errorMethodID, int &errorLine, QString &errorStr);
 	bool searchText(const QRegularExpression &text, int &fieldID, int &textID, int &from, int &size, Sorting=SortByMapId) const;
 	bool searchTextReverse(const QRegularExpression &text, int &fieldID, int &textID, int &from, int &size, Sorting=SortByMapId) const;
@@ -60,6 +84,12 @@ public:
 	bool searchScriptText(const QRegularExpression &text, int &fieldID, int &groupID, int &methodID, int &opcodeID, Sorting=SortByMapId) const;
 	bool searchScriptReverse(JsmFile::SearchType type, quint64 value, int &fieldID, int &groupID, int &methodID, int &opcodeID, Sorting=SortByMapId) const;
 	bool searchScriptTextReverse(const QRegularExpression &text, int &fieldID, int &groupID, int &methodID, int &opcodeID, Sorting=SortByMapId) const;
+	// Search every field at once, results are sorted like the fields and the matches in a field
+	QList<TextSearchResult> findAllText(const QRegularExpression &text, Sorting sorting=SortByMapId, SearchObserver *observer=nullptr) const;
+	QList<ScriptSearchResult> findAllScript(JsmFile::SearchType type, quint64 value, Sorting sorting=SortByMapId, SearchObserver *observer=nullptr) const;
+	QList<ScriptSearchResult> findAllScriptText(const QRegularExpression &text, Sorting sorting=SortByMapId, SearchObserver *observer=nullptr) const;
+	// Built on first use, then updated with the fields modified since the last call
+	const FieldArchiveIndex *index() const;
 	QMultiMap<int, QString> searchAllVars() const;
 	QList<int> searchAllSpells(int fieldID) const;
 	QList<int> searchAllCards(int fieldID) const;
@@ -81,11 +111,32 @@ protected:
 	QHash<int, CharaModel> models;
 	QStringList _mapList;
 	QMultiMap<QString, int> fieldsSortByName;
-	QMultiMap<QString, int> fieldsSortByDesc;
+	// Lazy fields are sorted by location once their script is loaded, see updateDescs()
+	mutable QMultiMap<QString, int> fieldsSortByDesc;
+	mutable QList<int> fieldsWithoutDesc;
 	QMultiMap<QString, int> fieldsSortByMapId;
 	Map *_worldMap;
 	bool readOnly;
 private:
+	template<typename Result, typename SearchField>
+	QList<Result> findAll(Sorting sorting, SearchObserver *observer, SearchField searchField,
+	                      void (SearchObserver::*addResults)(const QList<Result> &)) const;
+	QList<int> sortedFieldIDs(Sorting sorting) const;
+	void sortResults(QList<ScriptSearchResult> &results, Sorting sorting, SearchObserver *observer) const;
+	void updateDescs() const;
+	void touchField(Field *field) const;
+	void addLoadedField(Field *field) const;
+	// Access order of lazy fields, to evict the least recently used first
+	mutable QHash<Field *, quint64> lastAccess;
+	mutable quint64 accessCounter;
+	// Size of the lazy fields counted as loaded, computed once per load
+	mutable QHash<Field *, qint64> loadedSizes;
+	mutable qint64 loadedSize;
+	Field *_currentField;
+	// Fields cannot be evicted while a search is in progress
+	mutable int searchCount;
+	mutable FieldArchiveIndex *_index;
+	qint64 _memoryBudget;
 	bool searchIterators(QMultiMap<QString, int>::const_iterator &i, QMultiMap<QString, int>::const_iterator &end, int fieldID, Sorting sorting) const;
 	bool searchIteratorsP(QMultiMap<QString, int>::const_iterator &i, QMultiMap<QString, int>::const_iterator &begin, int fieldID, Sorting sorting) const;
 };
@@ -0,0 +1,317 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "FieldArchiveCache.h"
+#include "FsArchive.h"
+
+#define FIELD_CACHE_MAGIC		"DLFC"
+#define FIELD_CACHE_VERSION		1
+#define FIELD_CACHE_KEY_SIZE	20
+#define FIELD_CACHE_NO_BLOB		0xFFFFFFFF
+
+/*
+ * Format (little endian):
+ * char magic[4] | quint32 version | char key[20] | quint32 entryCount
+ * Blob mapList | Blob entries[entryCount][5 + cachedExts().size()]
+ * Blob data...
+ * With Blob = quint32 offset | quint32 size (size = 0xFFFFFFFF: no data)
+ * Entry blobs: name, path, flPath, fl, fi, then one per cached extension
+ */
+
+namespace {
+
+struct Blob {
+	quint32 offset, size;
+};
+
+const int headerSize = 4 + 4 + FIELD_CACHE_KEY_SIZE + 4;
+
+void appendBlob(QByteArray &table, QByteArray &data, quint32 dataStart, const QByteArray &blob, bool exists = true)
+{
+	Blob b;
+	b.offset = dataStart + quint32(data.size());
+	b.size = exists ? quint32(blob.size()) : FIELD_CACHE_NO_BLOB;
+	table.append((const char *)&b, sizeof(Blob));
+	data.append(blob);
+}
+
+}
+
+FieldArchiveCache::FieldArchiveCache(const QString &archivePath, const QString &gameLang) :
+    _archivePath(archivePath), _gameLang(gameLang), _map(nullptr)
+{
+}
+
+FieldArchiveCache::~FieldArchiveCache()
+{
+	close();
+}
+
+QString FieldArchiveCache::cacheDirectory()
+{
+	return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) % "/fieldcache";
+}
+
+QString FieldArchiveCache::cachePath() const
+{
+	QByteArray pathHash = QCryptographicHash::hash(QFileInfo(FsArchive::fsPath(_archivePath)).absoluteFilePath().toUtf8(),
+	                                               QCryptographicHash::Sha1);
+
+	return cacheDirectory() % "/" % QString::fromLatin1(pathHash.toHex()) % ".cache";
+}
+
+QByteArray FieldArchiveCache::key() const
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	quint32 version = FIELD_CACHE_VERSION;
+
+	hash.addData(QByteArray((const char *)&version, 4));
+	hash.addData(QFileInfo(FsArchive::fsPath(_archivePath)).absoluteFilePath().toUtf8());
+	hash.addData(_gameLang.toUtf8());
+
+	for (const QString &path: QStringList() << FsArchive::fsPath(_archivePath)
+	     << FsArchive::flPath(_archivePath) << FsArchive::fiPath(_archivePath)) {
+		QFileInfo info(path);
+		qint64 size = info.size(), mtime = info.lastModified().toMSecsSinceEpoch();
+
+		if (!info.exists()) {
+			return QByteArray();
+		}
+
+		hash.addData(QByteArray((const char *)&size, 8));
+		hash.addData(QByteArray((const char *)&mtime, 8));
+	}
+
+	// The content of field.fs is too big to be hashed, only its TOC is
+	for (const QString &path: QStringList() << FsArchive::flPath(_archivePath) << FsArchive::fiPath(_archivePath)) {
+		QFile f(path);
+
+		if (!f.open(QIODevice::ReadOnly) || !hash.addData(&f)) {
+			return QByteArray();
+		}
+	}
+
+	return hash.result();
+}
+
+bool FieldArchiveCache::open()
+{
+	return open(key());
+}
+
+bool FieldArchiveCache::open(const QByteArray &expectedKey)
+{
+	close();
+
+	if (expectedKey.isEmpty()) {
+		return false;
+	}
+
+	_file.setFileName(cachePath());
+
+	if (!_file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	qint64 size = _file.size();
+
+	if (size < headerSize || size > qint64(FIELD_CACHE_NO_BLOB)) {
+		close();
+		return false;
+	}
+
+	_map = _file.map(0, size);
+
+	if (_map == nullptr) {
+		qWarning() << "FieldArchiveCache::open cannot map" << _file.fileName() << _file.errorString();
+		close();
+		return false;
+	}
+
+	const char *data = (const char *)_map;
+	quint32 version, entryCount;
+
+	memcpy(&version, data + 4, 4);
+	memcpy(&entryCount, data + 4 + 4 + FIELD_CACHE_KEY_SIZE, 4);
+
+	if (memcmp(data, FIELD_CACHE_MAGIC, 4) != 0 || version != FIELD_CACHE_VERSION
+	        || memcmp(data + 8, expectedKey.constData(), FIELD_CACHE_KEY_SIZE) != 0) {
+		qDebug() << "FieldArchiveCache::open outdated cache" << _file.fileName();
+		close();
+		return false;
+	}
+
+	const int blobCount = 5 + cachedExts().size();
+
+	if (qint64(headerSize) + (1 + qint64(entryCount) * blobCount) * qint64(sizeof(Blob)) > size) {
+		qWarning() << "FieldArchiveCache::open invalid entry count" << entryCount;
+		close();
+		return false;
+	}
+
+	const char *table = data + headerSize;
+	bool ok = true;
+
+	auto readBlob = [&](bool *exists = nullptr) {
+		Blob b;
+		memcpy(&b, table, sizeof(Blob));
+		table += sizeof(Blob);
+
+		if (exists) {
+			*exists = b.size != FIELD_CACHE_NO_BLOB;
+		}
+
+		if (b.size == FIELD_CACHE_NO_BLOB) {
+			return QByteArray();
+		}
+
+		if (qint64(b.offset) + b.size > size) {
+			ok = false;
+			return QByteArray();
+		}
+
+		return QByteArray::fromRawData(data + b.offset, b.size);
+	};
+
+	_mapList = QString::fromUtf8(readBlob()).split('\n');
+
+	for (quint32 i = 0; i < entryCount && ok; ++i) {
+		Entry entry;
+		entry.name = QString::fromUtf8(readBlob());
+		entry.path = QString::fromUtf8(readBlob());
+		entry.openData.flPath = QString::fromUtf8(readBlob());
+		entry.openData.fl = readBlob();
+		entry.openData.fi = readBlob();
+
+		for (FieldPC::FileExt ext: cachedExts()) {
+			bool exists;
+			QByteArray blob = readBlob(&exists);
+
+			if (exists) {
+				entry.openData.files.insert(ext, blob);
+			}
+		}
+
+		_entries.append(entry);
+	}
+
+	if (!ok) {
+		qWarning() << "FieldArchiveCache::open corrupted cache" << _file.fileName();
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void FieldArchiveCache::close()
+{
+	_entries.clear();
+	_mapList.clear();
+
+	if (_map != nullptr) {
+		_file.unmap(_map);
+		_map = nullptr;
+	}
+
+	_file.close();
+}
+
+bool FieldArchiveCache::save(const QStringList &mapList, const QList<Entry> &entries)
+{
+	QElapsedTimer t;t.start();
+
+	QByteArray cacheKey = key();
+
+	if (cacheKey.isEmpty() || !QDir().mkpath(cacheDirectory())) {
+		return false;
+	}
+
+	const int blobCount = 5 + cachedExts().size();
+	const quint32 dataStart = headerSize + (1 + entries.size() * blobCount) * sizeof(Blob);
+	quint32 version = FIELD_CACHE_VERSION, entryCount = entries.size();
+	QByteArray header, table, data;
+
+	header.append(FIELD_CACHE_MAGIC, 4);
+	header.append((const char *)&version, 4);
+	header.append(cacheKey);
+	header.append((const char *)&entryCount, 4);
+
+	appendBlob(table, data, dataStart, mapList.join('\n').toUtf8());
+
+	for (const Entry &entry: entries) {
+		appendBlob(table, data, dataStart, entry.name.toUtf8());
+		appendBlob(table, data, dataStart, entry.path.toUtf8());
+		appendBlob(table, data, dataStart, entry.openData.flPath.toUtf8());
+		appendBlob(table, data, dataStart, entry.openData.fl);
+		appendBlob(table, data, dataStart, entry.openData.fi);
+
+		for (FieldPC::FileExt ext: cachedExts()) {
+			appendBlob(table, data, dataStart, entry.openData.files.value(ext), entry.openData.files.contains(ext));
+		}
+	}
+
+	if (qint64(dataStart) + data.size() >= qint64(FIELD_CACHE_NO_BLOB)) {
+		qWarning() << "FieldArchiveCache::save cache too big";
+		return false;
+	}
+
+	// Do not write over a mapped cache
+	close();
+
+	QSaveFile f(cachePath());
+
+	if (!f.open(QIODevice::WriteOnly)
+	        || f.write(header) != header.size()
+	        || f.write(table) != table.size()
+	        || f.write(data) != data.size()
+	        || !f.commit()) {
+		qWarning() << "FieldArchiveCache::save error" << f.fileName() << f.errorString();
+		return false;
+	}
+
+	qDebug() << "save field cache time" << t.elapsed();
+
+	return true;
+}
+
+bool FieldArchiveCache::invalidate(const QByteArray &previousKey, const QStringList &names)
+{
+	// The other entries are up to date only if the cache matched the archive before the save
+	if (!open(previousKey)) {
+		QFile::remove(cachePath());
+		return false;
+	}
+
+	QStringList mapList = _mapList;
+	QList<Entry> entries;
+
+	for (const Entry &entry: std::as_const(_entries)) {
+		if (!names.contains(entry.name)) {
+			entries.append(entry);
+		}
+	}
+
+	// The entries are views on the mapped file, save() copies them before closing it
+	if (!save(mapList, entries)) {
+		close();
+		QFile::remove(cachePath());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,73 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#pragma once
+
+#include <QtCore>
+#include "FieldPC.h"
+
+/*
+ * On-disk cache of the data read by FieldPC::open(FsArchive *)
+ * for every field of a field.fs archive: inner fl/fi and
+ * decompressed inf/msd/jsm/mrt/sym.
+ * The cache is invalidated when the archive path, the size or the date
+ * of field.fs/fl/fi, the content of field.fl/fi or the game language change.
+ * When Deling saves the archive itself, only the entries of the saved
+ * fields are removed, see invalidate().
+ */
+class FieldArchiveCache
+{
+public:
+	struct Entry {
+		QString name, path;
+		FieldPC::OpenData openData;
+	};
+
+	// archivePath is the path without the last letter of the extension
+	FieldArchiveCache(const QString &archivePath, const QString &gameLang);
+	virtual ~FieldArchiveCache();
+
+	// Entries are views on the mapped cache file, valid until close()
+	bool open();
+	void close();
+	bool save(const QStringList &mapList, const QList<Entry> &entries);
+	// After a save of the archive, previousKey is the key before the save:
+	// the entries of the fields not in names are kept with the new key
+	bool invalidate(const QByteArray &previousKey, const QStringList &names);
+	// Identifies the archive state, empty if the archive does not exist
+	QByteArray key() const;
+	inline const QStringList &mapList() const {
+		return _mapList;
+	}
+	inline const QList<Entry> &entries() const {
+		return _entries;
+	}
+
+	QString cachePath() const;
+	static QString cacheDirectory();
+private:
+	bool open(const QByteArray &expectedKey);
+	inline static QList<FieldPC::FileExt> cachedExts() {
+		return QList<FieldPC::FileExt>() << FieldPC::Inf << FieldPC::Msd
+		                                 << FieldPC::Jsm << FieldPC::Mrt << FieldPC::Sym;
+	}
+	QString _archivePath, _gameLang;
+	QFile _file;
+	uchar *_map;
+	QStringList _mapList;
+	QList<Entry> _entries;
+};
@@ -0,0 +1,238 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "FieldArchiveIndex.h"
+#include "Field.h"
+#include "FF8Font.h"
+
+FieldArchiveIndex::FieldIndex::FieldIndex() :
+    jsm(nullptr), msd(nullptr), mrt(nullptr),
+    jsmRevision(0), msdRevision(0), mrtRevision(0), indexed(false)
+{
+}
+
+FieldArchiveIndex::FieldArchiveIndex(const FieldArchive *archive) :
+    _archive(archive)
+{
+}
+
+bool FieldArchiveIndex::isOutdated(Field *field, const FieldIndex &index)
+{
+	if (!index.indexed) {
+		return true;
+	}
+
+	// Only unmodified fields are unloaded, the index is still right
+	if (!field->isLoaded()) {
+		return false;
+	}
+
+	const File *jsm = field->hasJsmFile() ? field->getJsmFile() : nullptr,
+	        *msd = field->hasMsdFile() ? field->getMsdFile() : nullptr,
+	        *mrt = field->hasMrtFile() ? field->getMrtFile() : nullptr;
+
+	return jsm != index.jsm || (jsm && jsm->revision() != index.jsmRevision)
+	        || msd != index.msd || (msd && msd->revision() != index.msdRevision)
+	        || mrt != index.mrt || (mrt && mrt->revision() != index.mrtRevision);
+}
+
+void FieldArchiveIndex::update()
+{
+	QElapsedTimer t;t.start();
+
+	const QList<Field *> &fields = _archive->getFields();
+	QSharedPointer<const FF8TextCodec> codec = FF8Font::getCurrentConfigFont()->codec();
+
+	// Texts are indexed decoded
+	if (codec != _codec) {
+		_fields.clear();
+		_codec = codec;
+	}
+
+	_fields.resize(fields.size());
+
+	QThreadPool pool;
+	int count = 0;
+
+	for (int fieldID = 0; fieldID < fields.size(); ++fieldID) {
+		Field *field = fields.at(fieldID);
+
+		if (!field->isOpen() || !isOutdated(field, _fields.at(fieldID))) {
+			continue;
+		}
+
+		FieldIndex *index = &_fields[fieldID];
+
+		pool.start([field, index, codec]() {
+			indexField(field, *index, codec);
+		});
+		++count;
+	}
+
+	pool.waitForDone();
+
+	if (count > 0) {
+		qDebug() << "index time" << t.elapsed() << "ms" << count << "fields";
+	}
+}
+
+void FieldArchiveIndex::indexField(Field *field, FieldIndex &index, const QSharedPointer<const FF8TextCodec> &codec)
+{
+	index = FieldIndex();
+
+	if (field->hasJsmFile()) {
+		JsmFile *jsm = field->getJsmFile();
+		index.jsm = jsm;
+		index.jsmRevision = jsm->revision();
+		jsm->indexKeys(index.scriptKeys);
+		index.vars = jsm->searchAllVars();
+		jsm->searchAllOpcodeTypes(index.opcodeTypes);
+	}
+
+	if (field->hasMsdFile()) {
+		MsdFile *msd = field->getMsdFile();
+		index.msd = msd;
+		index.msdRevision = msd->revision();
+
+		for (int textID = 0; textID < msd->nbText(); ++textID) {
+			QString text = FF8Text(msd->data(textID), codec).toLower();
+			const QChar *c = text.constData();
+
+			for (qsizetype i = 0; i + 3 <= text.size(); ++i) {
+				QList<int> &textIDs = index.trigrams[trigram(c + i)];
+
+				if (textIDs.isEmpty() || textIDs.last() != textID) {
+					textIDs.append(textID);
+				}
+			}
+		}
+	}
+
+	if (field->hasMrtFile()) {
+		MrtFile *mrt = field->getMrtFile();
+		index.mrt = mrt;
+		index.mrtRevision = mrt->revision();
+		index.battles = mrt->searchAllBattles();
+	}
+
+	index.indexed = true;
+}
+
+QList<FieldArchive::ScriptSearchResult> FieldArchiveIndex::findScript(JsmFile::SearchType type, quint64 value) const
+{
+	QList<FieldArchive::ScriptSearchResult> ret;
+	const QList<quint64> keys = JsmFile::indexKeys(type, value);
+
+	for (int fieldID = 0; fieldID < _fields.size(); ++fieldID) {
+		const FieldIndex &index = _fields.at(fieldID);
+		QList<quint64> locations;
+
+		for (quint64 key: keys) {
+			locations.append(index.scriptKeys.value(key));
+		}
+
+		if (keys.size() > 1) {
+			std::sort(locations.begin(), locations.end());
+		}
+
+		for (quint64 location: locations) {
+			FieldArchive::ScriptSearchResult result;
+			result.fieldID = fieldID;
+			result.groupID = int(location >> 48);
+			result.methodID = int((location >> 32) & 0xFFFF);
+			result.opcodeID = int(location & 0xFFFFFFFF);
+			ret.append(result);
+		}
+	}
+
+	return ret;
+}
+
+bool FieldArchiveIndex::textCandidates(int fieldID, const QString &literal, QList<int> &textIDs) const
+{
+	if (fieldID < 0 || fieldID >= _fields.size() || !_fields.at(fieldID).indexed || literal.size() < 3) {
+		return false;
+	}
+
+	const FieldIndex &index = _fields.at(fieldID);
+	QString lowerLiteral = literal.toLower();
+	const QChar *c = lowerLiteral.constData();
+
+	textIDs = index.trigrams.value(trigram(c));
+
+	for (qsizetype i = 1; i + 3 <= lowerLiteral.size() && !textIDs.isEmpty(); ++i) {
+		const QList<int> other = index.trigrams.value(trigram(c + i));
+		QList<int> intersection;
+
+		std::set_intersection(textIDs.constBegin(), textIDs.constEnd(),
+		                      other.constBegin(), other.constEnd(),
+		                      std::back_inserter(intersection));
+		textIDs = intersection;
+	}
+
+	return true;
+}
+
+QList<int> FieldArchiveIndex::vars(int fieldID) const
+{
+	return _fields.value(fieldID).vars;
+}
+
+bool FieldArchiveIndex::battles(int fieldID, QList<int> &battles) const
+{
+	const FieldIndex &index = _fields.at(fieldID);
+	battles = index.battles;
+
+	return index.mrt != nullptr;
+}
+
+const QMap<int, int> &FieldArchiveIndex::opcodeTypes(int fieldID) const
+{
+	return _fields.at(fieldID).opcodeTypes;
+}
+
+bool FieldArchiveIndex::literalPattern(const QRegularExpression &regExp, QString &literal)
+{
+	if (regExp.patternOptions() & ~QRegularExpression::CaseInsensitiveOption) {
+		return false;
+	}
+
+	const QString pattern = regExp.pattern();
+	literal.clear();
+
+	// As produced by QRegularExpression::escape(), limited to ASCII where lowercase is simple
+	for (qsizetype i = 0; i < pattern.size(); ++i) {
+		QChar c = pattern.at(i);
+
+		if (c == '\\') {
+			if (++i >= pattern.size() || pattern.at(i).isLetterOrNumber()) {
+				return false;
+			}
+			c = pattern.at(i);
+		} else if (QString(".^$|?*+()[]{}").contains(c)) {
+			return false;
+		}
+
+		if (c.unicode() >= 0x80) {
+			return false;
+		}
+
+		literal.append(c);
+	}
+
+	return true;
+}
@@ -0,0 +1,63 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#pragma once
+
+#include <QtCore>
+#include "FieldArchive.h"
+#include "FF8TextCodec.h"
+
+class File;
+
+/*
+ * In-memory index of the scripts and texts of every field of an archive.
+ * Each field is indexed separately, and indexed again by update()
+ * when its files are reopened or modified.
+ */
+class FieldArchiveIndex
+{
+public:
+	explicit FieldArchiveIndex(const FieldArchive *archive);
+	void update();
+	// Same results as JsmFile::search() on every field, unsorted between fields
+	QList<FieldArchive::ScriptSearchResult> findScript(JsmFile::SearchType type, quint64 value) const;
+	// Texts of the field that may contain literal, false if the index cannot tell
+	bool textCandidates(int fieldID, const QString &literal, QList<int> &textIDs) const;
+	QList<int> vars(int fieldID) const;
+	bool battles(int fieldID, QList<int> &battles) const;
+	const QMap<int, int> &opcodeTypes(int fieldID) const;
+	static bool literalPattern(const QRegularExpression &regExp, QString &literal);
+private:
+	struct FieldIndex {
+		FieldIndex();
+		const File *jsm, *msd, *mrt;
+		quint32 jsmRevision, msdRevision, mrtRevision;
+		bool indexed;
+		QHash<quint64, QList<quint64> > scriptKeys;
+		QHash<quint64, QList<int> > trigrams;
+		QList<int> vars, battles;
+		QMap<int, int> opcodeTypes;
+	};
+	static bool isOutdated(Field *field, const FieldIndex &index);
+	static void indexField(Field *field, FieldIndex &index, const QSharedPointer<const FF8TextCodec> &codec);
+	inline static quint64 trigram(const QChar *c) {
+		return (quint64(c[0].unicode()) << 32) | (quint64(c[1].unicode()) << 16) | c[2].unicode();
+	}
+	const FieldArchive *_archive;
+	QList<FieldIndex> _fields;
+	QSharedPointer<const FF8TextCodec> _codec;
+};
@@ -16,9 +16,11 @@
  ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ****************************************************************************/
 #include "FieldArchivePC.h"
+#include "FieldArchiveCache.h"
 #include "ArchiveObserver.h"
 #include "files/MchFile.h"
 #include "Config.h"
+#include "FF8Font.h"
 #include "Data.h"
 #include "game/worldmap/Map.h"
 #include "game/worldmap/WmArchive.h"
@@ -69,16 +71,38 @@ int FieldArchivePC::open(const QString &path, ArchiveObserver *progress)
 
 	clearFields();
 
-	// Ouverture de la liste des écrans (facultatif)
-	FsArchive mapData(archive->fileData("*field\\mapdata.fl"), archive->fileData("*field\\mapdata.fi"));
-	if (mapData.isOpen()) {
-		QByteArray mapdata_fs = archive->fileData("*field\\mapdata.fs");
-		setMapList(QString(mapData.fileData(QString("*field\\mapdata\\maplist"), mapdata_fs)).split('\n'));
+	QList<FieldPC *> fieldsToOpen;
+	QString gameLang = Config::value("gameLang", "en").toString();
+	bool lazy = Config::value("lazyOpen", false).toBool();
+	bool useCache = Config::value("fieldCache", false).toBool();
+	FieldArchiveCache cache(archivePath, gameLang);
+	QList<FieldPC::OpenData> openData;
+	QList<OpenMode> modes;
+	bool fromCache = useCache && cache.open();
+	// Fields missing in the cache (saved since) are read from the archive
+	OpenMode mode = lazy ? IndexOnly : OpenFromArchive;
+	// Lazy fields are not read entirely, so they are not added to the cache
+	bool saveCache = useCache && mode != IndexOnly;
+
+	_cacheKey.clear();
+	_cacheGameLang = gameLang;
+
+	setMemoryBudget(lazy ? Config::value("lazyOpenMemoryBudget", 64).toLongLong() * 1024 * 1024 : -1);
+
+	if (fromCache) {
+		qDebug() << "open from cache" << cache.cachePath();
+		setMapList(cache.mapList());
 	} else {
-		setMapList(QStringList());
+		// Ouverture de la liste des écrans (facultatif)
+		FsArchive mapData(archive->fileData("*field\\mapdata.fl"), archive->fileData("*field\\mapdata.fi"));
+		if (mapData.isOpen()) {
+			QByteArray mapdata_fs = archive->fileData("*field\\mapdata.fs");
+			setMapList(QString(mapData.fileData(QString("*field\\mapdata\\maplist"), mapdata_fs)).split('\n'));
+		} else {
+			setMapList(QStringList());
+		}
 	}
 
-	int currentMap=0;
 	// Ajout des écrans non-listés
 	QStringList toc = archive->toc();
 	for (const QString &entry: toc) {
@@ -91,54 +115,89 @@ int FieldArchivePC::open(const QString &path, ArchiveObserver *progress)
 		}
 	}
 
-	quint32 freq = fsList.size()>100 ? fsList.size()/100 : 1;
-
-	progress->setObserverMaximum(fsList.size());
+	QHash<QString, const FieldArchiveCache::Entry *> cachedEntries;
+	for (const FieldArchiveCache::Entry &entry: cache.entries()) {
+		cachedEntries.insert(entry.path, &entry);
+	}
 
-	// Ouverture des écrans listés
 	for (const QString &entry: fsList) {
-		QCoreApplication::processEvents();
-
-		if (progress->observerWasCanceled()) {
-			clearFields();
-			errorMsg = QObject::tr("Opening canceled.");
-			return 2;
-		}
-
-		if (currentMap%freq == 0) {
-			progress->setObserverValue(currentMap);
-		}
-		currentMap++;
-
 		map = entry;
 		map.chop(3);
 		if ((index = map.lastIndexOf('\\')) != -1)
 			map = map.mid(index+1);
 
-		if (!map.isEmpty())
-		{
-			FieldPC *field = new FieldPC(map, entry, archive, Config::value("gameLang", "en").toString());
-			if (field->isOpen() && field->hasFiles()) {
-				if (field->hasJsmFile())
-					desc = Data::location(field->getJsmFile()->mapID());
-				else
-					desc = QString();
-
-				index = mapList().indexOf(map);
-				QString mapId = index==-1 ? "~" : QString("%1").arg(index, 3, 10, QChar('0'));
-
-				fields.append(field);
-				fieldsSortByName.insert(map, fieldID);
-				fieldsSortByDesc.insert(desc, fieldID);
-				fieldsSortByMapId.insert(mapId, fieldID);
-				++fieldID;
+		if (!map.isEmpty()) {
+			const FieldArchiveCache::Entry *cachedEntry = cachedEntries.value(entry, nullptr);
+			fieldsToOpen.append(new FieldPC(map, entry, nullptr, gameLang));
+			modes.append(cachedEntry != nullptr ? OpenFromCache : mode);
+			if (fromCache || saveCache) {
+				openData.append(cachedEntry != nullptr ? cachedEntry->openData : FieldPC::OpenData());
+			}
+		}
+	}
+
+	// Ouverture des écrans listés
+	if (!openFields(fieldsToOpen, progress, openData, modes)) {
+		qDeleteAll(fieldsToOpen);
+		clearFields();
+		errorMsg = QObject::tr("Opening canceled.");
+		return 2;
+	}
+
+	QList<FieldArchiveCache::Entry> cacheEntries;
+	bool cacheChanged = !fromCache;
+
+	// Merged in the original order, whatever the opening order was
+	for (int i = 0; i < fieldsToOpen.size(); ++i) {
+		FieldPC *field = fieldsToOpen.at(i);
+
+		if (field->isOpen() && field->hasFiles()) {
+			if (saveCache) {
+				FieldArchiveCache::Entry entry;
+				entry.name = field->name();
+				entry.path = field->path();
+				entry.openData = openData.at(i);
+				cacheEntries.append(entry);
+				cacheChanged = cacheChanged || modes.at(i) != OpenFromCache;
+			}
+
+			map = field->name();
+
+			// The location is unknown until the script of a lazy field is opened
+			if (field->isLoaded()) {
+				desc = field->hasJsmFile() ? Data::location(field->getJsmFile()->mapID()) : QString();
 			} else {
-				qWarning() << "field pas ouvert" << map;
-				delete field;
+				desc = QString();
+				fieldsWithoutDesc.append(fieldID);
 			}
-//			break;
+
+			index = mapList().indexOf(map);
+			QString mapId = index==-1 ? "~" : QString("%1").arg(index, 3, 10, QChar('0'));
+
+			fields.append(field);
+			fieldsSortByName.insert(map, fieldID);
+			fieldsSortByDesc.insert(desc, fieldID);
+			fieldsSortByMapId.insert(mapId, fieldID);
+			++fieldID;
+		} else {
+			qWarning() << "field pas ouvert" << field->name();
+			delete field;
 		}
 	}
+
+	// The cached entries are views on the cache, saved before closing it
+	if (saveCache && cacheChanged && !cacheEntries.isEmpty()) {
+		if (cache.save(mapList(), cacheEntries)) {
+			_cacheKey = cache.key();
+		}
+	} else if (fromCache) {
+		_cacheKey = cache.key();
+	}
+
+	// Fields have their own copy of the data now
+	cacheEntries.clear();
+	openData.clear();
+	cache.close();
 	
 	if (fields.isEmpty()) {
 		return openWorld();
@@ -147,12 +206,81 @@ int FieldArchivePC::open(const QString &path, ArchiveObserver *progress)
 	openModels();
 
 	if (Config::value("encoding", "00").toString() == "01") {
-		Config::setValue("encoding", "00");
+		FF8Font::setCurrentConfigFont("00");
 	}
 
 	return 0;
 }
 
+bool FieldArchivePC::openFields(const QList<FieldPC *> &fieldsToOpen, ArchiveObserver *progress,
+                                QList<FieldPC::OpenData> &openData, const QList<OpenMode> &modes)
+{
+	progress->setObserverMaximum(fieldsToOpen.size());
+
+	// Taken before starting threads, to never detach the list concurrently
+	FieldPC::OpenData *data = openData.isEmpty() ? nullptr : openData.data();
+	auto openField = [this, &modes, data](FieldPC *field, int i) {
+		switch (modes.at(i)) {
+		case OpenFromArchive:
+			field->open(archive, data ? data + i : nullptr);
+			break;
+		case OpenFromCache:
+			field->open(data[i]);
+			break;
+		case IndexOnly:
+			field->index(archive);
+			break;
+		}
+	};
+
+	if (!Config::value("parallelOpen", true).toBool() || QThread::idealThreadCount() <= 1) {
+		int currentMap=0;
+		quint32 freq = fieldsToOpen.size()>100 ? fieldsToOpen.size()/100 : 1;
+
+		for (FieldPC *field: fieldsToOpen) {
+			QCoreApplication::processEvents();
+
+			if (progress->observerWasCanceled()) {
+				return false;
+			}
+
+			if (currentMap%freq == 0) {
+				progress->setObserverValue(currentMap);
+			}
+			openField(field, currentMap);
+			currentMap++;
+		}
+
+		return true;
+	}
+
+	// FieldPC::open(FsArchive *) only shares the archive, which serializes its reads
+	QThreadPool pool;
+	QAtomicInt openedCount = 0, canceled = 0;
+
+	for (int i = 0; i < fieldsToOpen.size(); ++i) {
+		FieldPC *field = fieldsToOpen.at(i);
+		pool.start([field, i, &openField, &openedCount, &canceled]() {
+			if (!canceled.loadRelaxed()) {
+				openField(field, i);
+			}
+			openedCount.fetchAndAddRelaxed(1);
+		});
+	}
+
+	while (!pool.waitForDone(50)) {
+		QCoreApplication::processEvents();
+
+		if (progress->observerWasCanceled()) {
+			canceled.storeRelaxed(1);
+		}
+
+		progress->setObserverValue(openedCount.loadRelaxed());
+	}
+
+	return !canceled.loadRelaxed() && !progress->observerWasCanceled();
+}
+
 int FieldArchivePC::openWorld()
 {
 	Map *map = new Map();
@@ -215,11 +343,39 @@ bool FieldArchivePC::openModels()
 	return !models.isEmpty();
 }
 
-bool FieldArchivePC::openBG(Field *field) const
+bool FieldArchivePC::readBG(Field *field, BGData &data) const
 {
-	if (!archive)	return false;
+	if (!archive || !field->isPc())	return false;
 
-	return field->isPc() && ((FieldPC *)field)->open2(archive);
+	QMap<FieldPC::FileExt, QByteArray> files;
+
+	if (!((FieldPC *)field)->read2(archive, files)) {
+		return false;
+	}
+
+	QMapIterator<FieldPC::FileExt, QByteArray> it(files);
+	while (it.hasNext()) {
+		it.next();
+		data.insert(it.key(), it.value());
+	}
+
+	return true;
+}
+
+bool FieldArchivePC::openBG(Field *field, const BGData &data) const
+{
+	if (!field->isPc())	return false;
+
+	QMap<FieldPC::FileExt, QByteArray> files;
+	QMapIterator<int, QByteArray> it(data);
+	while (it.hasNext()) {
+		it.next();
+		files.insert(FieldPC::FileExt(it.key()), it.value());
+	}
+
+	((FieldPC *)field)->open2(files);
+
+	return true;
 }
 
 void FieldArchivePC::restoreFieldHeaders(const QMap<Field *, QMap<QString, FsHeader> > &oldFields) const
@@ -250,6 +406,9 @@ bool FieldArchivePC::save(ArchiveObserver *progress, QString save_path)
 	path.chop(1);// remove s, i or l in extension
 
 	if (save_path.isEmpty() || save_path.compare(path, Qt::CaseInsensitive)==0) {
+		if (Config::value("incrementalSave", false).toBool()) {
+			return saveIncremental(progress);
+		}
 		save_path = path;
 		temp_path = save_path.left(save_path.lastIndexOf("/")+1) + "delingtemp.f";
 	}
@@ -431,8 +590,13 @@ bool FieldArchivePC::save(ArchiveObserver *progress, QString save_path)
 	}
 	else if (!archive->setPath(save_path)) {
 		return false;
+	} else {
+		// No cache for this path yet
+		_cacheKey.clear();
 	}
 
+	updateCache();
+
 	for (Field *field: fields) {
 		field->setModified(false);
 	}
@@ -444,6 +608,87 @@ bool FieldArchivePC::save(ArchiveObserver *progress, QString save_path)
 	return true;
 }
 
+bool FieldArchivePC::saveIncremental(ArchiveObserver *progress)
+{
+	QElapsedTimer t;t.start();
+	QMap<QString, QByteArray> files;
+	QString file;
+	int i = 0;
+
+	progress->setObserverMaximum(fields.size());
+
+	QMap<QString, FsHeader> oldValues = archive->getHeader();
+	QMap<Field *, QMap<QString, FsHeader> > oldFields;
+
+	for (Field *field: fields) {
+		if (progress->observerWasCanceled()) {
+			restoreFieldHeaders(oldFields);
+			return false;
+		}
+
+		if (field->isModified() && field->isPc()) {
+			QCoreApplication::processEvents();
+
+			FsArchive *fieldHeader = ((FieldPC *)field)->getArchiveHeader();
+			if (fieldHeader != nullptr) {
+				oldFields.insert(field, fieldHeader->getHeader());
+			}
+
+			file = ((FieldPC *)field)->path();
+			QByteArray fs_data = archive->fileData(file), fl_data, fi_data;
+			((FieldPC *)field)->save(fs_data, fl_data, fi_data);
+
+			files.insert(file, fs_data);
+			file.chop(1);
+			files.insert(FsArchive::flPath(file), fl_data);
+			files.insert(FsArchive::fiPath(file), fi_data);
+		} else if (field->isModified() && field->hasWorldmapFile()) {
+			QCoreApplication::processEvents();
+
+			QByteArray wmsetData;
+			WmArchive wmArchive;
+
+			if (!wmArchive.save(archive, *_worldMap, wmsetData)) {
+				errorMsg = wmArchive.errorString();
+
+				qWarning() << errorMsg;
+			} else {
+				files.insert(archive->filePath("*world\\dat\\wmset??.obj"), wmsetData);
+			}
+		}
+
+		progress->setObserverValue(++i);
+	}
+
+	progress->setObserverCanCancel(false);
+
+	FsArchive::Error error = archive->writeEntries(files);
+
+	if (error != FsArchive::Ok) {
+		errorMsg = FsArchive::errorString(error, archive->path());
+		qWarning() << errorMsg;
+		restoreFieldHeaders(oldFields);
+		archive->setHeader(oldValues);
+		return false;
+	}
+
+	updateCache();
+
+	for (Field *field: fields) {
+		field->setModified(false);
+	}
+
+	quint64 freeSize = 0;
+	for (quint32 size: archive->freeSpace()) {
+		freeSize += size;
+	}
+
+	// Reclaimed by optimiseArchive()
+	qDebug() << "save time" << t.elapsed() << files.size() << "entries written" << freeSize << "bytes unused";
+
+	return true;
+}
+
 bool FieldArchivePC::optimiseArchive(ArchiveObserver *progress)
 {
 	if (!archive)	return false;
@@ -575,11 +820,34 @@ bool FieldArchivePC::optimiseArchive(ArchiveObserver *progress)
 
 	archive->rebuildInfos();
 
+	// Every field was rewritten
+	_cacheKey.clear();
+
 	qDebug() << "save time" << t.elapsed();
 
 	return true;
 }
 
+void FieldArchivePC::updateCache()
+{
+	if (_cacheKey.isEmpty()) {
+		return;
+	}
+
+	QStringList savedFields;
+	for (Field *field: fields) {
+		if (field->isModified() && field->isPc()) {
+			savedFields.append(field->name());
+		}
+	}
+
+	QString path = archivePath();
+	path.chop(1);
+	FieldArchiveCache cache(path, _cacheGameLang);
+	// The entries of the other fields are still up to date
+	_cacheKey = cache.invalidate(_cacheKey, savedFields) ? cache.key() : QByteArray();
+}
+
 QStringList FieldArchivePC::languages() const
 {
 	QStringList langs;
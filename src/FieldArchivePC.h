@@ -35,12 +35,24 @@ public:
 	int open(const QString &path, ArchiveObserver *progress);
 	bool save(ArchiveObserver *progress, QString save_path=QString());
 	bool openModels();
-	bool openBG(Field *field) const;
+	using FieldArchive::openBG;
+	bool readBG(Field *field, BGData &data) const;
+	bool openBG(Field *field, const BGData &data) const;
 	void restoreFieldHeaders(const QMap<Field *, QMap<QString, FsHeader> > &oldFields) const;
 	bool optimiseArchive(ArchiveObserver *progress);
 	QStringList languages() const;
 protected:
 	int openWorld();
 private:
+	enum OpenMode {
+		OpenFromArchive, OpenFromCache, IndexOnly
+	};
+	bool openFields(const QList<FieldPC *> &fieldsToOpen, ArchiveObserver *progress,
+	                QList<FieldPC::OpenData> &openData, const QList<OpenMode> &modes);
+	bool saveIncremental(ArchiveObserver *progress);
+	void updateCache();
 	FsArchive *archive;
+	// Key of the field cache when it matches the archive, empty otherwise
+	QByteArray _cacheKey;
+	QString _cacheGameLang;
 };
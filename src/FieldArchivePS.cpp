@@ -34,7 +34,7 @@ FieldArchivePS::~FieldArchivePS()
 	if (iso) {
 		if (iso->isDemo()) {
 			FF8Font::deregisterFont("demo");
-			Config::setValue("encoding", "00");
+			FF8Font::setCurrentConfigFont("00");
 		}
 
 		delete iso;
@@ -147,12 +147,12 @@ int FieldArchivePS::open(const QString &path, ArchiveObserver *progress)
 		TdwFile *tdw = new TdwFile();
 		tdw->open(sysFntTdw);
 		FF8Font::registerFont("demo", new FF8Font(tdw, QByteArray()));
-		Config::setValue("encoding", "demo");
+		FF8Font::setCurrentConfigFont("demo");
 	} else {
 		if (iso->isJp() && Config::value("encoding", "00").toString() == "00") {
-			Config::setValue("encoding", "01");
+			FF8Font::setCurrentConfigFont("01");
 		} else if (!iso->isJp() && Config::value("encoding", "00").toString() == "01") {
-			Config::setValue("encoding", "00");
+			FF8Font::setCurrentConfigFont("00");
 		}
 	}
 
@@ -180,17 +180,19 @@ bool FieldArchivePS::openModels()
 	return !models.isEmpty();
 }
 
-bool FieldArchivePS::openBG(Field *field) const
+bool FieldArchivePS::readBG(Field *field, BGData &data) const
 {
 	if (!iso)	return false;
 
+	QMutexLocker locker(&isoMutex);
+
 	FieldPS *fieldPS = (FieldPS *)field;
 	quint32 isoFieldID = fieldPS->isoFieldID();
 	QByteArray dat, mim, lzk;
 
 	if (iso->isDemo()) {
 		if ((int)isoFieldID+2 >= iso->fieldCount()) {
-			qWarning() << "FieldArchivePS::openBG field ID out of range" << isoFieldID << iso->fieldCount();
+			qWarning() << "FieldArchivePS::readBG field ID out of range" << isoFieldID << iso->fieldCount();
 			return false;
 		}
 
@@ -199,7 +201,7 @@ bool FieldArchivePS::openBG(Field *field) const
 		lzk = iso->fileLZS(iso->fieldFile(isoFieldID+2));
 	} else {
 		if (isoFieldID < 1 || (int)isoFieldID+1 >= iso->fieldCount()) {
-			qWarning() << "FieldArchivePS::openBG field ID out of range" << isoFieldID << iso->fieldCount();
+			qWarning() << "FieldArchivePS::readBG field ID out of range" << isoFieldID << iso->fieldCount();
 			return false;
 		}
 
@@ -208,5 +210,14 @@ bool FieldArchivePS::openBG(Field *field) const
 		lzk = iso->file(iso->fieldFile(isoFieldID+1));
 	}
 
-	return fieldPS->open2(dat, mim, lzk);
+	data.insert(Dat, dat);
+	data.insert(Mim, mim);
+	data.insert(Lzk, lzk);
+
+	return true;
+}
+
+bool FieldArchivePS::openBG(Field *field, const BGData &data) const
+{
+	return ((FieldPS *)field)->open2(data.value(Dat), data.value(Mim), data.value(Lzk));
 }
@@ -33,7 +33,13 @@ public:
 	FF8DiscArchive *getFF8DiscArchive() const;
 	int open(const QString &, ArchiveObserver *progress);
 	bool openModels();
-	bool openBG(Field *field) const;
+	using FieldArchive::openBG;
+	bool readBG(Field *field, BGData &data) const;
+	bool openBG(Field *field, const BGData &data) const;
 private:
+	enum BGFiles {
+		Dat, Mim, Lzk
+	};
 	FF8DiscArchive *iso;
+	mutable QMutex isoMutex; // Serialize reads in iso, readBG() can be called from several threads
 };
@@ -0,0 +1,132 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "FieldLoader.h"
+
+// Maximum number of fields read and not opened yet
+#define FIELD_LOADER_CACHE_SIZE	8
+
+FieldLoader::FieldLoader(QObject *parent) :
+    QObject(parent), _requested(nullptr)
+{
+	// Archive reads are serialized, the second thread decompresses in the meantime
+	_pool.setMaxThreadCount(2);
+}
+
+FieldLoader::~FieldLoader()
+{
+	clear();
+}
+
+void FieldLoader::load(FieldArchive *fieldArchive, Field *field, const QList<Field *> &prefetch)
+{
+	// Stale requests are canceled, the running ones are kept in cache
+	_pool.clear();
+
+	{
+		QMutexLocker locker(&_mutex);
+		_requested = field;
+	}
+
+	if (field != nullptr) {
+		_pool.start([this, fieldArchive, field]() {
+			read(fieldArchive, field);
+		});
+	}
+
+	for (Field *neighbour: prefetch.mid(0, FIELD_LOADER_CACHE_SIZE - 1)) {
+		_pool.start([this, fieldArchive, neighbour]() {
+			read(fieldArchive, neighbour);
+		});
+	}
+}
+
+bool FieldLoader::take(Field *field, FieldArchive::BGData &data)
+{
+	QMutexLocker locker(&_mutex);
+
+	if (!_cache.contains(field)) {
+		return false;
+	}
+
+	data = _cache.take(field);
+	_cacheOrder.removeOne(field);
+
+	return true;
+}
+
+void FieldLoader::clear()
+{
+	_pool.clear();
+	_pool.waitForDone();
+
+	QMutexLocker locker(&_mutex);
+	_cache.clear();
+	_cacheOrder.clear();
+	_requested = nullptr;
+}
+
+void FieldLoader::read(FieldArchive *fieldArchive, Field *field)
+{
+	{
+		QMutexLocker locker(&_mutex);
+
+		if (_reading.contains(field)) {
+			// The running read will notify
+			return;
+		}
+
+		if (_cache.contains(field)) {
+			bool notify = field == _requested;
+			locker.unlock();
+
+			if (notify) {
+				emit loaded(field);
+			}
+			return;
+		}
+
+		_reading.insert(field);
+	}
+
+	FieldArchive::BGData data;
+	bool ok = fieldArchive->readBG(field, data);
+
+	QMutexLocker locker(&_mutex);
+	_reading.remove(field);
+
+	if (ok) {
+		_cache.insert(field, data);
+		_cacheOrder.append(field);
+
+		for (qsizetype i = 0; _cacheOrder.size() > FIELD_LOADER_CACHE_SIZE && i < _cacheOrder.size(); ) {
+			if (_cacheOrder.at(i) == _requested) {
+				++i;
+			} else {
+				_cache.remove(_cacheOrder.takeAt(i));
+			}
+		}
+	}
+
+	bool notify = field == _requested;
+	locker.unlock();
+
+	// Even on error, to not wait forever
+	if (notify) {
+		emit loaded(field);
+	}
+}
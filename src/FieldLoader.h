@@ -0,0 +1,52 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#pragma once
+
+#include <QtCore>
+#include "FieldArchive.h"
+#include "Field.h"
+
+/*
+ * Reads the second-stage files of fields in a thread pool.
+ * The files are parsed later with FieldArchive::openBG(),
+ * in the thread that owns the fields.
+ */
+class FieldLoader : public QObject
+{
+	Q_OBJECT
+public:
+	explicit FieldLoader(QObject *parent = nullptr);
+	virtual ~FieldLoader();
+	// Cancel the requests not started yet, read field in background
+	// (loaded() is emitted when done), then read the fields in prefetch
+	void load(FieldArchive *fieldArchive, Field *field, const QList<Field *> &prefetch = QList<Field *>());
+	// Returns the data read for field if any, and removes it from the cache
+	bool take(Field *field, FieldArchive::BGData &data);
+	// Cancel the pending requests, wait for the running ones and forget every data read
+	void clear();
+signals:
+	void loaded(Field *field);
+private:
+	void read(FieldArchive *fieldArchive, Field *field);
+	QThreadPool _pool;
+	QMutex _mutex;
+	QHash<Field *, FieldArchive::BGData> _cache;
+	QList<Field *> _cacheOrder; // Least recently read first
+	QSet<Field *> _reading;
+	Field *_requested;
+};
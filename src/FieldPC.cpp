@@ -19,13 +19,15 @@
 #include "FsArchive.h"
 
 FieldPC::FieldPC(const QString &name, const QString &path, FsArchive *archive, const QString &gameLang)
-    : Field(name), _path(path), _gameLang(gameLang), header(nullptr)
+    : Field(name), _path(path), _gameLang(gameLang), header(nullptr), _archive(nullptr)
 {
-	open(archive);
+	if (archive != nullptr) {
+		open(archive);
+	}
 }
 
 FieldPC::FieldPC(const QString &path, const QString &gameLang)
-    : Field(QString()), _path(path), _gameLang(gameLang), header(nullptr)
+    : Field(QString()), _path(path), _gameLang(gameLang), header(nullptr), _archive(nullptr)
 {
 	open(path);
 }
@@ -112,53 +114,47 @@ bool FieldPC::open(const QString &path)
 
 bool FieldPC::openOptimized(const QList<FileExt> &selectedExts)
 {
-	QMap<FileExt, QString> files;
-
-	for (FileExt ext: selectedExts) {
-		QString path = filePath(ext);
-
-		if (header->fileExists(path)) {
-			files[ext] = path;
-		}
-	}
+	QMap<FileExt, QByteArray> files;
 
-	QMapIterator<FileExt, QString> it(files);
+	readFiles(selectedExts, nullptr, files);
+	openFiles(files);
 
-	while (it.hasNext()) {
-		it.next();
+	return true;
+}
 
-		FileExt ext = it.key();
-		FileType type = Field::Msd;
+bool FieldPC::openOptimized(const QList<FileExt> &selectedExts, FsArchive *archive, QMap<FileExt, QByteArray> *openedFiles)
+{
+	if (!archive) {
+		return openOptimized(selectedExts);
+	}
 
-		if (ext != CharaOne) {
-			bool ok;
-			type = extToType(ext, &ok);
+	QMap<FileExt, QByteArray> data;
 
-			if (!ok) {
-				continue;
-			}
-		}
+	if (!readFiles(selectedExts, archive, data)) {
+		return false;
+	}
 
-		const QString &path = it.value();
+	openFiles(data);
 
-		if (ext == Jsm && files.contains(Sym)) {
-			openJsmFile(header->fileData(path), header->fileData(files[Sym]));
-		} else if (ext == Map && files.contains(Mim)) {
-			openBackgroundFile(header->fileData(path), header->fileData(files[Mim]));
-		} else if (ext == CharaOne) {
-			openCharaFile(header->fileData(path));
-		} else {
-			openFile(type, header->fileData(path));
-		}
+	if (openedFiles) {
+		*openedFiles = data;
 	}
 
 	return true;
 }
 
-bool FieldPC::openOptimized(const QList<FileExt> &selectedExts, FsArchive *archive)
+bool FieldPC::readFiles(const QList<FileExt> &selectedExts, FsArchive *archive, QMap<FileExt, QByteArray> &data) const
 {
 	if (!archive) {
-		return openOptimized(selectedExts);
+		for (FileExt ext: selectedExts) {
+			QString path = filePath(ext);
+
+			if (header->fileExists(path)) {
+				data[ext] = header->fileData(path);
+			}
+		}
+
+		return true;
 	}
 
 	QMap<FileExt, FsHeader *> files;
@@ -179,7 +175,7 @@ bool FieldPC::openOptimized(const QList<FileExt> &selectedExts, FsArchive *archi
 		return false;
 	}
 
-	// Get data and open files
+	// Get data
 	QByteArray fs_data = archive->fileData("*"%name()%".fs", true, int(maxSize));
 
 	if (fs_data.isEmpty()) {
@@ -189,6 +185,18 @@ bool FieldPC::openOptimized(const QList<FileExt> &selectedExts, FsArchive *archi
 
 	QMapIterator<FileExt, FsHeader *> it(files);
 
+	while (it.hasNext()) {
+		it.next();
+		data.insert(it.key(), it.value()->data(fs_data));
+	}
+
+	return true;
+}
+
+void FieldPC::openFiles(const QMap<FileExt, QByteArray> &files)
+{
+	QMapIterator<FileExt, QByteArray> it(files);
+
 	while (it.hasNext()) {
 		it.next();
 
@@ -204,43 +212,52 @@ bool FieldPC::openOptimized(const QList<FileExt> &selectedExts, FsArchive *archi
 			}
 		}
 
-		FsHeader *infos = it.value();
-
 		if (ext == Jsm && files.contains(Sym)) {
-			openJsmFile(infos->data(fs_data), files[Sym]->data(fs_data));
+			openJsmFile(it.value(), files.value(Sym));
 		} else if (ext == Map && files.contains(Mim)) {
-			openBackgroundFile(infos->data(fs_data), files[Mim]->data(fs_data));
+			openBackgroundFile(it.value(), files.value(Mim));
 		} else if (ext == CharaOne) {
-			openCharaFile(infos->data(fs_data));
+			openCharaFile(it.value());
 		} else {
-			openFile(type, infos->data(fs_data));
+			openFile(type, it.value());
 		}
 	}
+}
+
+bool FieldPC::setPathInfos(const QString &flPath)
+{
+	QRegularExpression pathReg("^" + QRegularExpression::escape("C:\\ff8\\Data\\") + "(\\w+)" + QRegularExpression::escape("\\FIELD\\mapdata\\") + "(\\w+)" + QRegularExpression::escape("\\"), QRegularExpression::CaseInsensitiveOption);
+	QRegularExpressionMatch match = pathReg.match(flPath);
+	if (!match.hasMatch()) {
+		qWarning() << "fieldData not opened" << name() << "wrong path" << flPath;
+		return false;
+	}
+	_lang = match.captured(1);
+	_subDir = match.captured(2);
 
 	return true;
 }
 
-bool FieldPC::open(FsArchive *archive)
+bool FieldPC::openHeader(FsArchive *archive, OpenData *openData)
 {
 	setOpen(false);
 
 	if (header)	delete header;
+	header = nullptr;
 
-	QRegularExpression pathReg("^" + QRegularExpression::escape("C:\\ff8\\Data\\") + "(\\w+)" + QRegularExpression::escape("\\FIELD\\mapdata\\") + "(\\w+)" + QRegularExpression::escape("\\"), QRegularExpression::CaseInsensitiveOption);
 	FsHeader *flInfos = archive->getFile("*"%name()%".fl");
 	if (!flInfos) {
 		qWarning() << "fieldData not opened" << name() << archive->path();
 		return false;
 	}
-	QRegularExpressionMatch match = pathReg.match(flInfos->path());
-	if (!match.hasMatch()) {
-		qWarning() << "fieldData not opened" << name() << "wrong path" << flInfos->path();
+	if (!setPathInfos(flInfos->path())) {
 		return false;
 	}
-	_lang = match.captured(1);
-	_subDir = match.captured(2);
 
-	header = new FsArchive(archive->fileData(flInfos->path()), archive->fileData("*"%name()%".fi"));
+	QByteArray fl = archive->fileData(flInfos->path()),
+	        fi = archive->fileData("*"%name()%".fi");
+
+	header = new FsArchive(fl, fi);
 	if (!header->isOpen()) {
 		qWarning() << "fieldData not opened" << name();
 		delete header;
@@ -248,12 +265,94 @@ bool FieldPC::open(FsArchive *archive)
 		return false;
 	}
 
-	if (!openOptimized(openExts(), archive)) {
+	if (openData) {
+		openData->flPath = flInfos->path();
+		openData->fl = fl;
+		openData->fi = fi;
+	}
+
+	return true;
+}
+
+bool FieldPC::open(FsArchive *archive, OpenData *openData)
+{
+	if (!openHeader(archive, openData)) {
+		return false;
+	}
+
+	if (!openOptimized(openExts(), archive, openData ? &openData->files : nullptr)) {
+		delete header;
+		header = nullptr;
+		return false;
+	}
+
+	setOpen(true);
+	return true;
+}
+
+bool FieldPC::index(FsArchive *archive)
+{
+	if (!openHeader(archive, nullptr)) {
+		return false;
+	}
+
+	if (dataSize() == 0) {
+		qWarning() << "No files!" << name();
+		delete header;
+		header = nullptr;
+		return false;
+	}
+
+	_archive = archive;
+	setLazy(true);
+	setOpen(true);
+	return true;
+}
+
+bool FieldPC::load()
+{
+	return _archive != nullptr && header != nullptr
+	        && openOptimized(openExts(), _archive);
+}
+
+qint64 FieldPC::dataSize() const
+{
+	qint64 size = 0;
+
+	if (header) {
+		for (FileExt ext: openExts()) {
+			FsHeader *infos = header->getFile(filePath(ext));
+
+			if (infos != nullptr) {
+				size += infos->uncompressedSize();
+			}
+		}
+	}
+
+	return size;
+}
+
+bool FieldPC::open(const OpenData &openData)
+{
+	setOpen(false);
+
+	if (header)	delete header;
+	header = nullptr;
+
+	if (openData.files.isEmpty() || !setPathInfos(openData.flPath)) {
+		return false;
+	}
+
+	header = new FsArchive(openData.fl, openData.fi);
+	if (!header->isOpen()) {
+		qWarning() << "fieldData not opened" << name();
 		delete header;
 		header = nullptr;
 		return false;
 	}
 
+	openFiles(openData.files);
+
 	setOpen(true);
 	return true;
 }
@@ -263,6 +362,21 @@ bool FieldPC::open2(FsArchive *archive)
 	return header && openOptimized(open2Exts(), archive);
 }
 
+bool FieldPC::read2(FsArchive *archive, QMap<FileExt, QByteArray> &files) const
+{
+	return header && readFiles(open2Exts(), archive, files);
+}
+
+void FieldPC::open2(const QMap<FileExt, QByteArray> &files)
+{
+	openFiles(files);
+}
+
+bool FieldPC::openBackground(FsArchive *archive)
+{
+	return header && openOptimized(QList<FileExt>() << Map << Mim, archive);
+}
+
 bool FieldPC::save(const QString &path)
 {
 	QString oldArchivePath = _path;
@@ -466,6 +580,12 @@ bool FieldPC::changeGameLang(const QString &gameLang, FsArchive *archive)
 	if (_gameLang == gameLang) {
 		return true;
 	}
+
+	// Files will be opened in the right language
+	if (!isLoaded()) {
+		_gameLang = gameLang;
+		return true;
+	}
 	
 	QList<FileExt> selectedExts;
 
@@ -490,6 +610,56 @@ bool FieldPC::changeGameLang(const QString &gameLang, FsArchive *archive)
 	return true;
 }
 
+bool FieldPC::readMsdLangs(const QStringList &langs, FsArchive *archive, QList<QByteArray> &msdList) const
+{
+	if (!header || !archive) {
+		return false;
+	}
+
+	// Files without language are shared by every language
+	FsHeader *commonInfos = header->getFile(filePath(Msd, false));
+	QList<FsHeader *> infosList;
+	quint32 maxSize = 0;
+
+	for (const QString &lang: langs) {
+		FsHeader *infos = commonInfos != nullptr
+		        ? commonInfos
+		        : header->getFile(filePath(name() % "_" % lang % ".msd"));
+
+		if (infos != nullptr) {
+			maxSize = qMax(maxSize, infos->position() + infos->uncompressedSize());
+		}
+		infosList.append(infos);
+	}
+
+	if (maxSize == 0) {
+		qWarning() << "No files!" << name();
+		return false;
+	}
+
+	QByteArray fs_data = archive->fileData("*"%name()%".fs", true, int(maxSize));
+
+	if (fs_data.isEmpty()) {
+		qWarning() << "No data!" << name() << maxSize;
+		return false;
+	}
+
+	msdList.clear();
+
+	for (FsHeader *infos: infosList) {
+		msdList.append(infos != nullptr ? infos->data(fs_data) : QByteArray());
+	}
+
+	return true;
+}
+
+bool FieldPC::isCurrentMsdLang(const QString &lang) const
+{
+	return header != nullptr && hasMsdFile()
+	        && (header->fileExists(filePath(Msd, false))
+	            || lang.compare(_gameLang, Qt::CaseInsensitive) == 0);
+}
+
 QString FieldPC::fileName(FileExt fileExt, bool useGameLang) const
 {
 	QString lang;
@@ -29,6 +29,14 @@ public:
 		Msd, Jsm, Id, Ca, Rat, Mrt, Inf, Pmp, Pmd, Pvp, Map, Tdw, Msk, Sfx, CharaOne, Mim, Sym
 	};
 
+	// Everything read by open(FsArchive *), enough to reopen the field without the archive
+	struct OpenData {
+		QString flPath;
+		QByteArray fl, fi;
+		QMap<FileExt, QByteArray> files;
+	};
+
+	// If archive is null, the field is opened later with open(FsArchive *)
 	FieldPC(const QString &name, const QString &path, FsArchive *archive, const QString &gameLang);
 	explicit FieldPC(const QString &path, const QString &gameLang);
 	virtual ~FieldPC();
@@ -40,19 +48,37 @@ public:
 	FsArchive *getArchiveHeader() const;
 	const QString &path() const;
 	bool open(const QString &path);
-	bool open(FsArchive *archive);
+	bool open(FsArchive *archive, OpenData *openData = nullptr);
+	bool open(const OpenData &openData);
+	// Only reads the TOC of the field, files are opened on first access
+	bool index(FsArchive *archive);
 	bool open2(FsArchive *archive = nullptr);
+	// open2() in two steps: read2() only reads the archive and can be called from any thread
+	bool read2(FsArchive *archive, QMap<FileExt, QByteArray> &files) const;
+	void open2(const QMap<FileExt, QByteArray> &files);
+	// Only opens the map and the mim files, can be called for several fields at once
+	bool openBackground(FsArchive *archive = nullptr);
 	bool save(const QString &path);
 	void save(QByteArray &fs_data, QByteArray &fl_data, QByteArray &fi_data);
 	void optimize(QByteArray &fs_data, QByteArray &fl_data, QByteArray &fi_data);
 	bool isMultiLanguage() const;
 	QStringList languages() const;
 	bool changeGameLang(const QString &gameLang, FsArchive *archive = nullptr);
+	// Msd file of every language, from one decompression of the fs file, can be called from any thread
+	bool readMsdLangs(const QStringList &langs, FsArchive *archive, QList<QByteArray> &msdList) const;
+	// The msd file opened in memory is the one of this language
+	bool isCurrentMsdLang(const QString &lang) const;
+	qint64 dataSize() const;
 protected:
 	virtual void setFile(FileType fileType);
+	bool load();
 private:
+	bool openHeader(FsArchive *archive, OpenData *openData);
 	bool openOptimized(const QList<FileExt> &selectedExts);
-	bool openOptimized(const QList<FileExt> &selectedExts, FsArchive *archive);
+	bool openOptimized(const QList<FileExt> &selectedExts, FsArchive *archive, QMap<FileExt, QByteArray> *openedFiles = nullptr);
+	bool readFiles(const QList<FileExt> &selectedExts, FsArchive *archive, QMap<FileExt, QByteArray> &files) const;
+	void openFiles(const QMap<FileExt, QByteArray> &files);
+	bool setPathInfos(const QString &flPath);
 	QString fileName(FileExt fileExt, bool useGameLang) const;
 	QString filePath(FileExt fileExt) const;
 	QString filePath(FileExt fileType, bool useGameLang) const;
@@ -69,4 +95,5 @@ private:
 	QString _path;
 	QString _lang, _subDir, _gameLang;
 	FsArchive *header;
+	FsArchive *_archive;
 };
@@ -20,6 +20,13 @@
 #include "LZS.h"
 #include "ArchiveObserver.h"
 #include "QRegularExpressionWildcardCompat.h"
+#ifdef Q_OS_WIN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 FsHeader::FsHeader()
     : _uncompressedSize(0), _position(quint32(-1)), _compression(quint32(CompressionNone))
@@ -103,14 +110,14 @@ bool FsHeader::compressedSize(QFile *fs, quint32 *lzsSize) const
 	        && fs->read((char *)lzsSize, sizeof(quint32)) == sizeof(quint32);
 }
 
-bool FsHeader::compressedSize(const char *fs_data, int size, quint32 *lzsSize) const
+bool FsHeader::compressedSize(const char *fs_data, qint64 size, quint32 *lzsSize) const
 {
 	if (isCompressed()) {
-		if (size <= int(sizeof(quint32))) {
+		if (qint64(_position) + qint64(sizeof(quint32)) > size) {
 			return false;
 		}
 
-		memcpy(&lzsSize, fs_data + _position, sizeof(quint32));
+		memcpy(lzsSize, fs_data + _position, sizeof(quint32));
 
 		return true;
 	}
@@ -144,17 +151,22 @@ bool FsHeader::physicalSize(const QByteArray &fs_data, quint32 *size) const
 		*size += sizeof(quint32);
 		return true;
 	}
-	return _uncompressedSize;
+	*size = _uncompressedSize;
+	return true;
 }
 
-const QByteArray &FsHeader::decompress(const char *data, int size, int max) const
+QByteArray FsHeader::decompress(const char *data, int size, int max) const
 {
 	if (compression() == CompressionLz4)
 	{
 		return QLZ4::decompress(data, size, max);
 	}
 
-	return LZS::decompress(data, size, max);
+	QByteArray ret;
+	LzsDecoder decoder;
+	decoder.decompress(data, size, ret, max);
+
+	return ret;
 }
 
 QByteArray FsHeader::compress(const QByteArray &data) const
@@ -164,7 +176,11 @@ QByteArray FsHeader::compress(const QByteArray &data) const
 		return QLZ4::compress(data);
 	}
 
-	return LZS::compress(data);
+	QByteArray ret;
+	LzsEncoder encoder;
+	encoder.compress(data.constData(), data.size(), ret, FsArchive::lzsLevel());
+
+	return ret;
 }
 
 QByteArray FsHeader::data(const QByteArray &fs_data, bool uncompress, int maxUncompress) const
@@ -219,7 +235,7 @@ QByteArray FsHeader::data(QFile *fs, bool uncompress, int maxUncompress) const
 			return QByteArray();
 		}
 
-		const QByteArray &decData = decompress(buff, size, maxUncompress<=0 ? _uncompressedSize : maxUncompress);
+		QByteArray decData = decompress(buff, size, maxUncompress<=0 ? _uncompressedSize : maxUncompress);
 		delete[] buff;
 
 		return decData;
@@ -228,6 +244,45 @@ QByteArray FsHeader::data(QFile *fs, bool uncompress, int maxUncompress) const
 	return fs->read(_uncompressedSize);
 }
 
+QByteArray FsHeader::mappedData(const char *fs_data, qint64 fs_size, bool uncompress, int maxUncompress) const
+{
+	if (isCompressed())
+	{
+		quint32 size;
+
+		if (!compressedSize(fs_data, fs_size, &size))
+			return QByteArray();
+
+		// fucking size
+		if (size > _uncompressedSize*2 || qint64(_position) + 4 + size > fs_size)
+			return QByteArray();
+
+		if (!uncompress)
+			return QByteArray::fromRawData(fs_data + _position, size+4);
+
+		// Decompressed directly from the mapped pages
+		return decompress(fs_data + _position + 4, size, maxUncompress<=0 ? _uncompressedSize : maxUncompress);
+	}
+
+	if (qint64(_position) + _uncompressedSize > fs_size)
+		return QByteArray();
+
+	return QByteArray::fromRawData(fs_data + _position, _uncompressedSize);
+}
+
+QByteArray FsHeader::uncompressedData(const QByteArray &physicalData, int maxUncompress) const
+{
+	if (!isCompressed()) {
+		return physicalData;
+	}
+
+	if (physicalData.size() < 4) {
+		return QByteArray();
+	}
+
+	return decompress(physicalData.constData() + 4, physicalData.size() - 4, maxUncompress<=0 ? _uncompressedSize : maxUncompress);
+}
+
 int FsHeader::setData(QByteArray &fs_data, const QByteArray &new_data)
 {
 	int diff, real_size;
@@ -286,19 +341,21 @@ int FsHeader::setData(QFile *fs, QByteArray &new_data)
 	return diff;
 }
 
+LzsEncoder::Level FsArchive::_lzsLevel = LzsEncoder::Fast;
+
 //FsArchive::FsArchive()
 //	: fromFile(false), _isOpen(false)
 //{
 //}
 
 FsArchive::FsArchive(const QByteArray &fl_data, const QByteArray &fi_data)
-    : fromFile(false), _isOpen(false)
+    : fsMap(nullptr), fsMapSize(0), fromFile(false), memoryMapped(false), _isOpen(false)
 {
 	load(fl_data, fi_data);
 }
 
 FsArchive::FsArchive(const QString &path)
-    : fromFile(false), _isOpen(false)
+    : fsMap(nullptr), fsMapSize(0), fromFile(false), memoryMapped(false), _isOpen(false)
 {
 	if (!path.isEmpty()) {
 		open(path);
@@ -308,6 +365,7 @@ FsArchive::FsArchive(const QString &path)
 FsArchive::~FsArchive()
 {
 	if (fromFile) {
+		unmapFs();
 		fs.close();
 		fl.close();
 		fi.close();
@@ -325,6 +383,7 @@ void FsArchive::addFile(const QString &path, quint32 uncompressedSize, quint32 p
 	FsHeader *header = new FsHeader(path, uncompressedSize, position, compression);
 	sortedByPosition.insert(position, header);
 	toc_access.insert(path.toLower(), header);
+	toc_suffix.insert(reversedPath(path.toLower()), header);
 }
 
 void FsArchive::addFile(const QString &path, FiCompression compression)
@@ -336,6 +395,7 @@ void FsArchive::addFile(const QString &path, FiCompression compression)
 	FsHeader *header = new FsHeader(path, 0, 0, compression);
 	sortedByPosition.insert(0, header);
 	toc_access.insert(path.toLower(), header);
+	toc_suffix.insert(reversedPath(path.toLower()), header);
 }
 
 bool FsArchive::removeFile(QString path)
@@ -343,6 +403,7 @@ bool FsArchive::removeFile(QString path)
 	path = path.toLower();
 	FsHeader *header = toc_access.take(path);
 	if (header != 0) {
+		toc_suffix.remove(reversedPath(path));
 		bool ok = sortedByPosition.remove(header->position(), header)==1;
 		if (!ok) {
 			qWarning() << "FsArchive::removeFile impossible" << path;
@@ -359,36 +420,40 @@ FsHeader *FsArchive::getFile(const QString &path) const
 
 	if (path.startsWith('*'))
 	{
-		QString path2 = path.sliced(1);
-		QMapIterator<QString, FsHeader *> i(toc_access);
+		QString path2 = path.sliced(1).toLower();
+		qsizetype wildcard = qMax(path2.lastIndexOf('*'), path2.lastIndexOf('?'));
+		QRegularExpression expr;
 
-		if (path2.contains('*') || path2.contains('?'))
+		if (wildcard >= 0)
 		{
-			QRegularExpression expr = fromWildcard(path2, Qt::CaseInsensitive, WildcardConversionOptions(QRegularExpression::UnanchoredWildcardConversion | NonPathWildcardConversion));
+			expr = fromWildcard(path2, Qt::CaseInsensitive, WildcardConversionOptions(QRegularExpression::UnanchoredWildcardConversion | NonPathWildcardConversion));
 			expr.setPattern(expr.pattern().append("$"));
-			
-			while (i.hasNext())
-			{
-				i.next();
-				if (i.key().contains(expr))
-				{
-					return i.value();
-				}
-			}
-			
-			return nullptr;
 		}
 
-		while (i.hasNext())
+		// Paths ending with the text after the last wildcard are contiguous in toc_suffix
+		const QString suffix = reversedPath(path2.sliced(wildcard + 1));
+		FsHeader *found = nullptr;
+		QString foundKey;
+
+		for (QMap<QString, FsHeader *>::const_iterator it = toc_suffix.lowerBound(suffix);
+		     it != toc_suffix.constEnd() && it.key().startsWith(suffix); ++it)
 		{
-			i.next();
-			if (i.key().endsWith(path2, Qt::CaseInsensitive))
+			QString key = reversedPath(it.key());
+
+			if (wildcard >= 0 && !key.contains(expr))
 			{
-				return i.value();
+				continue;
+			}
+
+			// The first match in path order, like a scan of toc_access
+			if (found == nullptr || key < foundKey)
+			{
+				found = it.value();
+				foundKey = key;
 			}
 		}
 		
-		return nullptr;
+		return found;
 	}
 	
 	return toc_access.value(path.toLower(), nullptr);
@@ -406,13 +471,10 @@ bool FsArchive::dirExists(QString dir) const
 	if (dir.isEmpty())
 		return true;
 
-	for (FsHeader *info: toc_access) {
-		if (info->path().startsWith(dir, Qt::CaseInsensitive)) {
-			return true;
-		}
-	}
+	dir = dir.toLower();
+	QMap<QString, FsHeader *>::const_iterator it = toc_access.lowerBound(dir);
 
-	return false;
+	return it != toc_access.constEnd() && it.key().startsWith(dir);
 }
 
 QString FsArchive::filePath(const QString &path) const
@@ -431,6 +493,8 @@ bool FsArchive::setFilePath(QString path, const QString &newPath)
 		header->setPath(newPath);
 		toc_access.remove(path);
 		toc_access.insert(newPath.toLower(), header);
+		toc_suffix.remove(reversedPath(path));
+		toc_suffix.insert(reversedPath(newPath.toLower()), header);
 
 		return true;
 	}
@@ -475,7 +539,22 @@ QByteArray FsArchive::fileData(const QString &path, bool uncompress, int uncompr
 {
 	FsHeader *header = getFile(path);
 	//	qDebug() << "fileData2" << path << uncompressedSize << fromFile << _isOpen;
-	return header!=nullptr && fromFile && _isOpen ? header->data(&fs, uncompress, uncompressedSize) : QByteArray();
+	if (header==nullptr || !fromFile || !_isOpen) {
+		return QByteArray();
+	}
+
+	if (fsMap != nullptr) {
+		return header->mappedData((const char *)fsMap, fsMapSize, uncompress, uncompressedSize);
+	}
+
+	QByteArray data;
+	{
+		// Only the read is serialized, the decompression can run concurrently
+		QMutexLocker locker(&fsMutex);
+		data = header->data(&fs, false);
+	}
+
+	return uncompress ? header->uncompressedData(data, uncompressedSize) : data;
 }
 
 void FsArchive::setFileData(const QString &path, QByteArray &fs_data, const QByteArray &new_data)
@@ -607,6 +686,8 @@ FsArchive::Error FsArchive::extractFiles(const QStringList &fileNames, const QSt
 {
 	if (!fromFile || !_isOpen)	return SourceCantBeOpened;
 
+	QElapsedTimer t;t.start();
+
 	// qDebug() << "extractFiles" << fileNames << fileDir << uncompress;
 
 	if (progress != nullptr) {
@@ -642,6 +723,8 @@ FsArchive::Error FsArchive::extractFiles(const QStringList &fileNames, const QSt
 		}
 	}
 
+	qDebug() << "extract time" << t.elapsed() << (isMemoryMapped() ? "(mapped)" : "");
+
 	return Ok;
 }
 
@@ -762,6 +845,8 @@ QList<FsArchive::Error> FsArchive::appendFiles(const QStringList &sources, const
 		return errors;
 	}
 
+	// The mapping would not cover the new files
+	unmapFs();
 	fs.seek(fs.size());
 
 	progress->setObserverMaximum(nbFiles);
@@ -793,7 +878,7 @@ QList<FsArchive::Error> FsArchive::appendFiles(const QStringList &sources, const
 		addFile(destinations.at(i), (quint32)data.size(), (quint32)fs.pos(), compression);
 
 		if (compression == FiCompression::CompressionLzs) {
-			data = LZS::compress(data);
+			data = LZS::compress(data, _lzsLevel);
 			int size = data.size();
 			data.prepend((char *)&size, 4);
 		} else if (compression == FiCompression::CompressionLz4) {
@@ -807,6 +892,10 @@ QList<FsArchive::Error> FsArchive::appendFiles(const QStringList &sources, const
 		errors.append(Ok);
 	}
 
+	if (memoryMapped) {
+		mapFs();
+	}
+
 	save(fl_data, fi_data);
 
 	fi.resize(0);
@@ -1044,6 +1133,7 @@ int FsArchive::replaceArchive(QFile *newFile)
 
 	_isOpen = false;
 
+	unmapFs();
 	fs.close();
 
 	if (!fs.remove()) {
@@ -1072,9 +1162,243 @@ int FsArchive::replaceArchive(QFile *newFile)
 
 	_isOpen = true;
 
+	if (memoryMapped) {
+		mapFs();
+	}
+
 	return 0;
 }
 
+QMap<quint32, quint32> FsArchive::freeSpace()
+{
+	QMap<quint32, quint32> ret;
+
+	if (!fromFile || !_isOpen) {
+		return ret;
+	}
+
+	// Positions may have changed since the last rebuildInfos()
+	QMultiMap<quint32, FsHeader *> headers;
+	for (FsHeader *header: sortedByPosition) {
+		headers.insert(header->position(), header);
+	}
+
+	QMutexLocker locker(&fsMutex);
+	qint64 end = 0;
+
+	for (FsHeader *header: headers) {
+		quint32 size;
+
+		if (!header->physicalSize(&fs, &size)) {
+			qWarning() << "FsArchive::freeSpace cannot read the size of" << header->path();
+			return QMap<quint32, quint32>();
+		}
+
+		if (header->position() > end) {
+			ret.insert(quint32(end), quint32(header->position() - end));
+		}
+
+		end = qMax(end, qint64(header->position()) + size);
+	}
+
+	return ret;
+}
+
+bool FsArchive::takeFreeSpace(QMap<quint32, quint32> &freeList, quint32 size, quint32 &pos)
+{
+	// Best fit
+	QMap<quint32, quint32>::iterator best = freeList.end();
+
+	for (QMap<quint32, quint32>::iterator it = freeList.begin(); it != freeList.end(); ++it) {
+		if (it.value() >= size && (best == freeList.end() || it.value() < best.value())) {
+			best = it;
+		}
+	}
+
+	if (best == freeList.end()) {
+		return false;
+	}
+
+	pos = best.key();
+	quint32 remaining = best.value() - size;
+	freeList.erase(best);
+
+	if (remaining > 0) {
+		freeList.insert(pos + size, remaining);
+	}
+
+	return true;
+}
+
+// Flush the OS cache to the disk, QFile::flush() only writes its own buffer
+static bool syncFile(QFile &f)
+{
+	if (!f.flush()) {
+		return false;
+	}
+#ifdef Q_OS_WIN
+	return FlushFileBuffers(HANDLE(_get_osfhandle(f.handle()))) != 0;
+#else
+	return fsync(f.handle()) == 0;
+#endif
+}
+
+FsArchive::Error FsArchive::writeEntries(const QMap<QString, QByteArray> &files)
+{
+	QElapsedTimer t;t.start();
+
+	if (!isWritable())	return NonWritable;
+
+	// The current slots of the entries are not reused: until the fi file
+	// is replaced, the archive on disk must stay as it was
+	QMap<quint32, quint32> freeList = freeSpace();
+	QList<FsHeader *> headers;
+	// Sizes are applied to the headers only when the new fi file is written
+	QList<FsHeader> newHeaders;
+	QList<QByteArray> physicalData;
+
+	QMapIterator<QString, QByteArray> i(files);
+	while (i.hasNext()) {
+		i.next();
+		FsHeader *header = getFile(i.key());
+		if (header == nullptr) {
+			return FileDontExists;
+		}
+
+		// Deep copy, the data can be a view of the mapping
+		QByteArray data(i.value().constData(), i.value().size());
+		FsHeader newHeader = *header;
+		{
+			QMutexLocker locker(&fsMutex);
+			newHeader.setData(&fs, data);
+		}
+		headers.append(header);
+		newHeaders.append(newHeader);
+		physicalData.append(data);
+	}
+
+	if (!fl.seek(0) || !fi.seek(0)) {
+		return SaveHeaderError;
+	}
+
+	// Records are patched in the order of the fl file on disk
+	QStringList flLines = QString(fl.readAll()).split("\r\n", Qt::SkipEmptyParts);
+	QByteArray fiData = fi.readAll();
+
+	if (fiData.size() != flLines.size() * 12) {
+		qWarning() << "FsArchive::writeEntries invalid fl or fi" << fiData.size() << flLines.size();
+		return SaveHeaderError;
+	}
+
+	QMutexLocker locker(&fsMutex);
+	unmapFs();
+
+	const qint64 oldSize = fs.size();
+	qint64 end = oldSize;
+	QHash<FsHeader *, int> positions; // Index in headers
+
+	for (int j = 0; j < headers.size(); ++j) {
+		const QByteArray &data = physicalData.at(j);
+		quint32 pos;
+
+		if (!takeFreeSpace(freeList, quint32(data.size()), pos)) {
+			if (end + data.size() > qint64(0xFFFFFFFF)) {
+				qWarning() << "FsArchive::writeEntries archive too big";
+				fs.resize(oldSize);
+				if (memoryMapped)	mapFs();
+				return ReplaceArchiveError;
+			}
+			pos = quint32(end);
+			end += data.size();
+		}
+
+		if (!fs.seek(pos) || fs.write(data) != data.size()) {
+			qWarning() << "FsArchive::writeEntries" << fs.errorString();
+			fs.resize(oldSize);
+			if (memoryMapped)	mapFs();
+			return ReplaceArchiveError;
+		}
+
+		newHeaders[j].setPosition(pos);
+		positions.insert(headers.at(j), j);
+	}
+
+	// The data must be on the disk before the fi file refers to it
+	if (!syncFile(fs)) {
+		qWarning() << "FsArchive::writeEntries" << fs.errorString();
+		fs.resize(oldSize);
+		if (memoryMapped)	mapFs();
+		return ReplaceArchiveError;
+	}
+
+	int patched = 0;
+
+	for (int j = 0; j < flLines.size(); ++j) {
+		QHash<FsHeader *, int>::const_iterator it = positions.constFind(getFile(flLines.at(j)));
+		if (it == positions.constEnd()) {
+			continue;
+		}
+
+		const FsHeader &newHeader = newHeaders.at(it.value());
+		Fi_infos infos;
+		infos.size = newHeader.uncompressedSize();
+		infos.pos = newHeader.position();
+		infos.compression = newHeader.compression();
+		memcpy(fiData.data() + j * 12, &infos, 12);
+		++patched;
+	}
+
+	if (patched != positions.size()) {
+		qWarning() << "FsArchive::writeEntries entries missing in the fl file";
+		fs.resize(oldSize);
+		if (memoryMapped)	mapFs();
+		return SaveHeaderError;
+	}
+
+	QSaveFile newFi(fi.fileName());
+	bool ok = newFi.open(QIODevice::WriteOnly) && newFi.write(fiData) == fiData.size();
+
+	if (ok) {
+		// Replacing an opened file fails on Windows
+		fi.close();
+		ok = newFi.commit();
+		if (!fi.open(QIODevice::ReadWrite)) {
+			fi.open(QIODevice::ReadOnly);
+		}
+	}
+
+	if (!ok) {
+		qWarning() << "FsArchive::writeEntries" << newFi.errorString();
+		fs.resize(oldSize);
+		if (memoryMapped)	mapFs();
+		return SaveHeaderError;
+	}
+
+	for (int j = 0; j < headers.size(); ++j) {
+		*headers.at(j) = newHeaders.at(j);
+	}
+
+	rebuildInfos();
+
+	if (memoryMapped) {
+		mapFs();
+	}
+
+	qDebug() << "writeEntries time" << t.elapsed() << "ms" << positions.size() << "entries" << (end - oldSize) << "bytes appended";
+
+	return Ok;
+}
+
+void FsArchive::setLzsLevel(LzsEncoder::Level level)
+{
+	_lzsLevel = level;
+}
+
+LzsEncoder::Level FsArchive::lzsLevel()
+{
+	return _lzsLevel;
+}
+
 QString FsArchive::fsPath(const QString &path)
 {
 	if (path.endsWith('F')) {
@@ -1109,6 +1433,7 @@ QString FsArchive::path() const
 
 bool FsArchive::setPath(const QString &path)
 {
+	unmapFs();
 	fl.close();
 	fi.close();
 	fs.close();
@@ -1119,7 +1444,8 @@ bool FsArchive::setPath(const QString &path)
 	qDebug() << "reopen fs in new path" << path;
 	return fl.open(QIODevice::ReadWrite)
 	        && fi.open(QIODevice::ReadWrite)
-	        && fs.open(QIODevice::ReadWrite);
+	        && fs.open(QIODevice::ReadWrite)
+	        && (!memoryMapped || mapFs());
 }
 
 qint64 FsArchive::size() const
@@ -1132,6 +1458,46 @@ bool FsArchive::isOpen() const
 	return _isOpen;
 }
 
+bool FsArchive::setMemoryMapped(bool memoryMapped)
+{
+	this->memoryMapped = memoryMapped;
+
+	if (!memoryMapped) {
+		unmapFs();
+		return true;
+	}
+
+	return fsMap != nullptr || mapFs();
+}
+
+bool FsArchive::mapFs()
+{
+	unmapFs();
+
+	if (!fromFile || !_isOpen || fs.size() <= 0) {
+		return false;
+	}
+
+	fsMap = fs.map(0, fs.size());
+	if (fsMap == nullptr) {
+		qWarning() << "FsArchive::mapFs" << fs.errorString();
+		return false;
+	}
+
+	fsMapSize = fs.size();
+
+	return true;
+}
+
+void FsArchive::unmapFs()
+{
+	if (fsMap != nullptr) {
+		fs.unmap(fsMap);
+		fsMap = nullptr;
+		fsMapSize = 0;
+	}
+}
+
 bool FsArchive::isWritable() const
 {
 	return fromFile && _isOpen && fs.isWritable() && fl.isWritable() && fi.isWritable()
@@ -1166,14 +1532,39 @@ void FsArchive::rebuildInfos()
 {
 	// Rebuild structure and order indication
 	QMultiMap<quint32, FsHeader *> newInfos;
-	QMap<QString, FsHeader *> newToc;
+	QMap<QString, FsHeader *> newToc, newSuffixes;
 	for (FsHeader *info: sortedByPosition) {
 		newInfos.insert(info->position(), info);
 		newToc.insert(info->path().toLower(), info);
+		newSuffixes.insert(reversedPath(info->path().toLower()), info);
 	}
 
 	sortedByPosition = std::move(newInfos);
 	toc_access = std::move(newToc);
+	toc_suffix = std::move(newSuffixes);
+}
+
+QString FsArchive::reversedPath(const QString &path)
+{
+	QString ret = path;
+	std::reverse(ret.begin(), ret.end());
+	return ret;
+}
+
+QList<FsHeader *> FsArchive::filesInDirectory(const QString &dir) const
+{
+	QList<FsHeader *> list;
+	const QString key = dir.toLower();
+
+	// Paths starting with dir are contiguous in toc_access
+	for (QMap<QString, FsHeader *>::const_iterator it = toc_access.lowerBound(key);
+	     it != toc_access.constEnd() && it.key().startsWith(key); ++it) {
+		if (it.key() != key) {
+			list.append(it.value());
+		}
+	}
+
+	return list;
 }
 
 QMap<QString, FsHeader *> FsArchive::fileList(QString dir) const
@@ -1185,20 +1576,17 @@ QMap<QString, FsHeader *> FsArchive::fileList(QString dir) const
 
 	// qDebug() << "FsArchive::fileList(QString dir)" << dir;
 
-	for (FsHeader *info: sortedByPosition) {
+	for (FsHeader *info: filesInDirectory(dir)) {
 		filePath = info->path();
 
-		if (filePath.compare(dir, Qt::CaseInsensitive)!=0
-		        && (dir.isEmpty() || filePath.startsWith(dir, Qt::CaseInsensitive))) {
-			if (!dir.isEmpty())
-				filePath.remove(0, dir.size());
+		if (!dir.isEmpty())
+			filePath.remove(0, dir.size());
 
-			if (filePath.count('\\')<=0) {
-				list.insert(filePath.toLower(), info);
-			}
-			else {
-				list.insert(filePath.toLower().section('\\', 0, 0), nullptr);
-			}
+		if (filePath.count('\\')<=0) {
+			list.insert(filePath.toLower(), info);
+		}
+		else {
+			list.insert(filePath.toLower().section('\\', 0, 0), nullptr);
 		}
 	}
 
@@ -1212,12 +1600,25 @@ QStringList FsArchive::tocInDirectory(QString dir) const
 
 	dir = cleanPath(dir);
 
-	for (FsHeader *info: sortedByPosition) {
-		filePath = info->path();
-		if (filePath.compare(dir, Qt::CaseInsensitive)!=0
-		        && (dir.isEmpty() || filePath.startsWith(dir, Qt::CaseInsensitive))) {
-			list.append(filePath);
+	if (dir.isEmpty()) {
+		for (FsHeader *info: sortedByPosition) {
+			filePath = info->path();
+			if (!filePath.isEmpty()) {
+				list.append(filePath);
+			}
 		}
+
+		return list;
+	}
+
+	// Files sorted by positions
+	QList<FsHeader *> headers = filesInDirectory(dir);
+	std::stable_sort(headers.begin(), headers.end(), [](const FsHeader *a, const FsHeader *b) {
+		return a->position() < b->position();
+	});
+
+	for (FsHeader *info: headers) {
+		list.append(info->path());
 	}
 
 	return list;
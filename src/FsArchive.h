@@ -18,6 +18,7 @@
 #pragma once
 
 #include <QtCore>
+#include "LZS.h"
 
 struct FsDiff {};
 
@@ -48,7 +49,7 @@ public:
 	quint32 uncompressedSize() const;
 	void setUncompressedSize(quint32);
 	bool compressedSize(QFile *fs, quint32 *lzsSize) const;
-	bool compressedSize(const char *fs_data, int size, quint32 *lzsSize) const;
+	bool compressedSize(const char *fs_data, qint64 size, quint32 *lzsSize) const;
 	bool compressedSize(const QByteArray &fs_data, quint32 *lzsSize) const;
 	bool physicalSize(QFile *fs, quint32 *size) const;
 	bool physicalSize(const QByteArray &fs_data, quint32 *size) const;
@@ -61,10 +62,13 @@ public:
 	}
 	QByteArray data(const QByteArray &, bool uncompress=true, int maxUncompress=0) const;
 	QByteArray data(QFile *, bool uncompress=true, int maxUncompress=0) const;
+	// Entries stored without compression are returned without copy, they point to fs_data
+	QByteArray mappedData(const char *fs_data, qint64 size, bool uncompress=true, int maxUncompress=0) const;
+	QByteArray uncompressedData(const QByteArray &physicalData, int maxUncompress=0) const;
 	int setData(QByteArray &, const QByteArray &);
 	int setData(QFile *, QByteArray &);
 private:
-	const QByteArray &decompress(const char *data, int size, int max) const;
+	QByteArray decompress(const char *data, int size, int max) const;
 	QByteArray compress(const QByteArray &data) const;
 	QString _path;
 	quint32 _uncompressedSize;
@@ -118,6 +122,14 @@ public:
 	void save(QByteArray &fl_data, QByteArray &fi_data) const;
 	bool saveAs(const QString &path) const;
 	int replaceArchive(QFile *newFile);
+	// Gaps in the fs file not used by any entry <position, size>
+	QMap<quint32, quint32> freeSpace();
+	// Store new data for existing entries in the free space of the fs file (or at its end)
+	// without moving the other entries. The fi file is replaced afterwards, in one step
+	Error writeEntries(const QMap<QString, QByteArray> &files);
+	// LZS effort used to compress the entries of every archive (Fast by default, for interactive saves)
+	static void setLzsLevel(LzsEncoder::Level level);
+	static LzsEncoder::Level lzsLevel();
 	static QString fsPath(const QString &path);
 	static QString flPath(const QString &path);
 	static QString fiPath(const QString &path);
@@ -126,6 +138,12 @@ public:
 	qint64 size() const;
 	bool isOpen() const;
 	bool isWritable() const;
+	// Read the fs file from a memory mapping, fileData() can return views of this mapping:
+	// they are valid until the archive is unmapped, modified or destroyed
+	bool setMemoryMapped(bool memoryMapped);
+	inline bool isMemoryMapped() const {
+		return fsMap != nullptr;
+	}
 	//	QString toString();
 	// Check integrity of fi files according to LZS headers, output to qWarning
 	bool verify();
@@ -143,8 +161,13 @@ private:
 	quint32 filePosition(const QString &path) const;
 	void changePositions(FsHeader *start, int diff);
 	static QStringList listDirsRec(QDir *sourceDir);
+	static QString reversedPath(const QString &path);
+	QList<FsHeader *> filesInDirectory(const QString &dir) const;
+	static bool takeFreeSpace(QMap<quint32, quint32> &freeList, quint32 size, quint32 &pos);
 
 	bool load(const QByteArray &fl_data, const QByteArray &fi_data);
+	bool mapFs();
+	void unmapFs();
 
 	static bool searchData(const QMultiMap<quint32, FsHeader *> &headers,
 	                       QFile *fs, const QByteArray &data, quint32 &pos);
@@ -152,9 +175,15 @@ private:
 		return searchData(sortedByPosition, &fs, data, pos);
 	}
 
+	static LzsEncoder::Level _lzsLevel;
+
 	QMultiMap<quint32, FsHeader *> sortedByPosition;// <order, headerData>
 	QMap<QString, FsHeader *> toc_access;// <path, headerData>
+	QMap<QString, FsHeader *> toc_suffix;// <reversed path, headerData>, for "*suffix" lookups
 	QFile fs, fl, fi;
-	bool fromFile;
+	QMutex fsMutex; // Serialize reads in fs, to use fileData() from several threads
+	uchar *fsMap;
+	qint64 fsMapSize;
+	bool fromFile, memoryMapped;
 	bool _isOpen;
 };
@@ -19,47 +19,96 @@
 #include <zlib.h>
 #undef compress // conflict with GZIP::compress
 
-QByteArray GZIP::decompress(const QByteArray &data)
+QByteArray GZIP::decompress(const QByteArray &data, int decSize)
 {
-	QByteArray ungzip;
+	const uchar *input = (const uchar *)data.constData();
+	qsizetype inputSize = data.size();
+
+	// Not gzipped: read as is, like gzread does
+	if (inputSize < 2 || input[0] != 0x1f || input[1] != 0x8b) {
+		return data;
+	}
 
-	QTemporaryFile temp;
-	if (!temp.open()) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+
+	// 16 + MAX_WBITS: gzip header and trailer
+	if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
 		return QByteArray();
 	}
-	temp.write(data);
-	temp.close();
-	gzFile file = gzopen(temp.fileName().toLatin1(), "rb");
-	if (!file) {
+
+	QByteArray ungzip;
+	qsizetype outSize = 0;
+
+	try {
+		// One more byte than the expected size: inflate can reach the end of
+		// the stream without filling the buffer, so it is never grown
+		ungzip.resize(decSize > 0 ? qsizetype(decSize) + 1 : qMax(inputSize * 4, qsizetype(4096)));
+	} catch (const std::bad_alloc &) {
+		inflateEnd(&stream);
 		return QByteArray();
 	}
-	char buffer[10000];
-	int r;
-	while ((r = gzread(file, buffer, 10000)) > 0) {
-		ungzip.append(buffer, r);
+
+	stream.next_in = (Bytef *)input;
+	stream.avail_in = uInt(inputSize);
+
+	forever {
+		if (outSize == ungzip.size()) {
+			ungzip.resize(ungzip.size() * 2);
+		}
+
+		stream.next_out = (Bytef *)ungzip.data() + outSize;
+		stream.avail_out = uInt(ungzip.size() - outSize);
+
+		int ret = inflate(&stream, Z_NO_FLUSH);
+		outSize = ungzip.size() - stream.avail_out;
+
+		if (ret == Z_STREAM_END) {
+			// Concatenated members are decompressed too, trailing garbage is ignored
+			if (stream.avail_in < 2 || stream.next_in[0] != 0x1f || stream.next_in[1] != 0x8b
+			        || inflateReset(&stream) != Z_OK) {
+				break;
+			}
+		} else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			qWarning() << "GZIP::decompress error" << ret << (stream.msg ? stream.msg : "");
+			break;
+		} else if (ret == Z_BUF_ERROR && stream.avail_out != 0) {
+			break; // Truncated input
+		}
 	}
-	gzclose(file);
+
+	inflateEnd(&stream);
+	ungzip.resize(outSize);
 
 	return ungzip;
 }
 
 QByteArray GZIP::compress(const QByteArray &ungzip)
 {
-	QString tempPath = QDir::tempPath()+"/qt_temp.gz";
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
 
-	gzFile file2 = gzopen(tempPath.toLatin1(), "wb9");
-	if (!file2) {
+	// Same parameters than gzopen(path, "wb9")
+	if (deflateInit2(&stream, 9, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
 		return QByteArray();
 	}
-	gzwrite(file2, ungzip.constData(), ungzip.size());
-	gzclose(file2);
-	QFile finalFile(tempPath);
-	if (!finalFile.open(QIODevice::ReadOnly)) {
+
+	QByteArray data;
+	data.resize(qsizetype(deflateBound(&stream, uLong(ungzip.size()))));
+
+	stream.next_in = (Bytef *)ungzip.constData();
+	stream.avail_in = uInt(ungzip.size());
+	stream.next_out = (Bytef *)data.data();
+	stream.avail_out = uInt(data.size());
+
+	int ret = deflate(&stream, Z_FINISH);
+	data.resize(data.size() - stream.avail_out);
+	deflateEnd(&stream);
+
+	if (ret != Z_STREAM_END) {
+		qWarning() << "GZIP::compress error" << ret;
 		return QByteArray();
 	}
 
-	QByteArray data = finalFile.readAll();
-	finalFile.remove();
-
 	return data;
 }
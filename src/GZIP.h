@@ -19,9 +19,13 @@
 
 #include <QtCore>
 
+/*
+ * In-memory gzip codec (no temporary file), safe to use from several threads.
+ */
 class GZIP
 {
 public:
-	static QByteArray decompress(const QByteArray &data/*, int decSize*/);
+	// decSize is a hint for the uncompressed size, the output grows if needed
+	static QByteArray decompress(const QByteArray &data, int decSize = 0);
 	static QByteArray compress(const QByteArray &ungzip);
 };
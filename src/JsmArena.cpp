@@ -0,0 +1,64 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "JsmArena.h"
+
+// Enough for most methods in one block
+constexpr size_t BLOCK_SIZE = 16384;
+
+JsmArena::JsmArena() :
+    _current(nullptr), _end(nullptr)
+{
+}
+
+JsmArena::~JsmArena()
+{
+	clear();
+}
+
+void JsmArena::clear()
+{
+	for (qsizetype i = _destructors.size() - 1; i >= 0; --i) {
+		const Destructor &d = _destructors.at(i);
+		d.destroy(d.object);
+	}
+	_destructors.clear();
+
+	for (char *block: std::as_const(_blocks)) {
+		delete[] block;
+	}
+	_blocks.clear();
+	_current = _end = nullptr;
+}
+
+void *JsmArena::allocate(size_t size, size_t alignment)
+{
+	uintptr_t pos = (uintptr_t(_current) + alignment - 1) & ~uintptr_t(alignment - 1);
+
+	if (_current == nullptr || pos + size > uintptr_t(_end)) {
+		size_t blockSize = qMax(BLOCK_SIZE, size + alignment);
+		char *block = new char[blockSize];
+		_blocks.append(block);
+		_current = block;
+		_end = block + blockSize;
+		pos = (uintptr_t(_current) + alignment - 1) & ~uintptr_t(alignment - 1);
+	}
+
+	_current = (char *)(pos + size);
+
+	return (void *)pos;
+}
@@ -0,0 +1,56 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#pragma once
+
+#include <QtCore>
+
+/*
+ * Bump allocator owning the decompiled tree of one method: opcodes,
+ * expressions, controls and applications. Objects are not freed one by one,
+ * they are all destroyed when the arena is cleared or destroyed.
+ * An arena is not shared between threads.
+ */
+class JsmArena
+{
+public:
+	JsmArena();
+	~JsmArena();
+	template<typename T, typename... Args>
+	T *create(Args &&...args) {
+		T *ret = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		if constexpr (!std::is_trivially_destructible_v<T>) {
+			_destructors.append(Destructor{&destroy<T>, ret});
+		}
+		return ret;
+	}
+	void clear();
+private:
+	Q_DISABLE_COPY(JsmArena)
+	struct Destructor {
+		void (*destroy)(void *);
+		void *object;
+	};
+	template<typename T>
+	static void destroy(void *object) {
+		static_cast<T *>(object)->~T();
+	}
+	void *allocate(size_t size, size_t alignment);
+	QList<char *> _blocks;
+	QList<Destructor> _destructors;
+	char *_current, *_end;
+};
@@ -29,6 +29,41 @@ JsmData::JsmData(const QByteArray &scriptData, bool demo) :
 		qWarning() << "JsmData::JsmData : Incorrect size" << this->scriptData.size();
 		this->scriptData.resize(this->scriptData.size() - (this->scriptData.size() % 4));
 	}
+
+	decodeOpcodes(0, 0, nbOpcode());
+}
+
+void JsmData::decodeOpcodes(int opcodeID, int removedCount, int insertedCount)
+{
+	// Like QByteArray::remove(), tolerate a count past the end
+	removedCount = qMin(removedCount, int(_keys.size()) - opcodeID);
+	_keys.remove(opcodeID, removedCount);
+	_params.remove(opcodeID, removedCount);
+	_keys.insert(opcodeID, insertedCount, 0);
+	_params.insert(opcodeID, insertedCount, 0);
+
+	for (int i = opcodeID; i < opcodeID + insertedCount; ++i) {
+		JsmOpcode op = opcode(i);
+		_keys[i] = op.key();
+		_params[i] = op.param();
+	}
+}
+
+QList<int> JsmData::jumpTargets(int opcodeID, int nbOpcode) const
+{
+	QList<int> labels;
+
+	for (int i = opcodeID; i < opcodeID + nbOpcode; ++i) {
+		int jumpTo = jumpTarget(i) - opcodeID;
+		if (jumpTo >= 0 && jumpTo < nbOpcode) {
+			labels.append(jumpTo);
+		}
+	}
+
+	std::sort(labels.begin(), labels.end());
+	labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+
+	return labels;
 }
 
 int JsmData::nbOpcode() const
@@ -40,12 +75,15 @@ JsmData &JsmData::append(const JsmOpcode &opcode)
 {
 	quint32 op = opcode.opcode();
 	scriptData.append((char *)&op, 4);
+	decodeOpcodes(nbOpcode() - 1, 0, 1);
 	return *this;
 }
 
 JsmData &JsmData::append(const JsmData &jsmData)
 {
+	int opcodeID = nbOpcode();
 	scriptData.append(jsmData.constData());
+	decodeOpcodes(opcodeID, 0, jsmData.nbOpcode());
 	return *this;
 }
 
@@ -66,13 +104,19 @@ JsmOpcode JsmData::opcode(int opcodeID) const
 	return ret;
 }
 
-JsmOpcode *JsmData::opcodep(int opcodeID) const
+template<typename T>
+static inline T *newOpcode(const JsmOpcode &op, JsmArena *arena)
+{
+	return arena != nullptr ? arena->create<T>(op) : new T(op);
+}
+
+JsmOpcode *JsmData::opcodep(int opcodeID, JsmArena *arena) const
 {
 	JsmOpcode op = opcode(opcodeID);
 
 	switch (op.key()) {
 	case JsmOpcode::CAL:
-		return new JsmOpcodeCal(op);
+		return newOpcode<JsmOpcodeCal>(op, arena);
 	case JsmOpcode::PSHN_L:
 	case JsmOpcode::PSHI_L:
 	case JsmOpcode::PSHM_B:
@@ -82,18 +126,18 @@ JsmOpcode *JsmData::opcodep(int opcodeID) const
 	case JsmOpcode::PSHSM_W:
 	case JsmOpcode::PSHSM_L:
 	case JsmOpcode::PSHAC:
-		return new JsmOpcodePsh(op);
+		return newOpcode<JsmOpcodePsh>(op, arena);
 	case JsmOpcode::POPI_L:
 	case JsmOpcode::POPM_B:
 	case JsmOpcode::POPM_W:
 	case JsmOpcode::POPM_L:
-		return new JsmOpcodePop(op);
+		return newOpcode<JsmOpcodePop>(op, arena);
 	default:
-		return new JsmOpcode(op);
+		return newOpcode<JsmOpcode>(op, arena);
 	}
 }
 
-QList<JsmOpcode *> JsmData::opcodesp(int opcodeID, int nbOpcode) const
+QList<JsmOpcode *> JsmData::opcodesp(JsmArena &arena, int opcodeID, int nbOpcode) const
 {
 	QList<JsmOpcode *> ret;
 	int count;
@@ -102,8 +146,9 @@ QList<JsmOpcode *> JsmData::opcodesp(int opcodeID, int nbOpcode) const
 	} else {
 		count = this->nbOpcode() - opcodeID;
 	}
+	ret.reserve(count);
 	for (int i = 0; i < count; ++i) {
-		ret.append(opcodep(opcodeID + i));
+		ret.append(opcodep(opcodeID + i, &arena));
 	}
 	return ret;
 }
@@ -112,6 +157,7 @@ JsmData &JsmData::setOpcode(int opcodeID, const JsmOpcode &opcode)
 {
 	quint32 op = opcode.opcode();
 	scriptData.replace(opcodeID*4, 4, (char *)&op, 4);
+	decodeOpcodes(opcodeID, 1, 1);
 	return *this;
 }
 
@@ -119,24 +165,28 @@ JsmData &JsmData::insertOpcode(int opcodeID, const JsmOpcode &opcode)
 {
 	quint32 op = opcode.opcode();
 	scriptData.insert(opcodeID*4, (char *)&op, 4);
+	decodeOpcodes(opcodeID, 0, 1);
 	return *this;
 }
 
 JsmData &JsmData::insert(int opcodeID, const JsmData &data)
 {
 	scriptData.insert(opcodeID*4, data.constData());
+	decodeOpcodes(opcodeID, 0, data.nbOpcode());
 	return *this;
 }
 
 JsmData &JsmData::remove(int opcodeID, int nbOpcode)
 {
 	scriptData.remove(opcodeID*4, nbOpcode*4);
+	decodeOpcodes(opcodeID, nbOpcode, 0);
 	return *this;
 }
 
 JsmData &JsmData::replace(int opcodeID, int nbOpcode, const JsmData &after)
 {
 	scriptData.replace(opcodeID*4, nbOpcode*4, after.constData());
+	decodeOpcodes(opcodeID, nbOpcode, after.nbOpcode());
 	return *this;
 }
 
@@ -19,6 +19,7 @@
 
 #include <QtCore>
 #include "JsmOpcode.h"
+#include "JsmArena.h"
 
 class JsmData
 {
@@ -29,8 +30,9 @@ public:
 	JsmData &append(const JsmOpcode &opcode);
 	JsmData &append(const JsmData &jsmData);
 	JsmOpcode opcode(int opcodeID) const;
-	JsmOpcode *opcodep(int opcodeID) const;
-	QList<JsmOpcode *> opcodesp(int opcodeID=0, int nbOpcode=-1) const;
+	// Allocated with new, or in arena if not null
+	JsmOpcode *opcodep(int opcodeID, JsmArena *arena=nullptr) const;
+	QList<JsmOpcode *> opcodesp(JsmArena &arena, int opcodeID=0, int nbOpcode=-1) const;
 	JsmData &setOpcode(int opcodeID, const JsmOpcode &opcode);
 	JsmData &insertOpcode(int opcodeID, const JsmOpcode &opcode);
 	JsmData &insert(int opcodeID, const JsmData &data);
@@ -43,7 +45,28 @@ public:
 	bool operator==(const JsmData &data) const;
 	bool operator!=(const JsmData &data) const;
 	JsmOpcode operator[](int opcodeID) const;
+	// Keys and params are decoded once and kept in sync with the data,
+	// so scans can read them without building JsmOpcode objects
+	inline unsigned int key(int opcodeID) const {
+		return _keys.at(opcodeID);
+	}
+	inline int param(int opcodeID) const {
+		return _params.at(opcodeID);
+	}
+	inline bool hasParam(int opcodeID) const {
+		return scriptData.at(opcodeID * 4 + 3) != '\0';
+	}
+	// Absolute position of the opcode targeted by JMP, JPF or GJMP, -1 otherwise
+	inline int jumpTarget(int opcodeID) const {
+		const quint32 key = _keys.at(opcodeID);
+		return key >= JsmOpcode::JMP && key <= JsmOpcode::GJMP ? opcodeID + _params.at(opcodeID) : -1;
+	}
+	// Sorted positions targeted by a jump inside [opcodeID, opcodeID + nbOpcode[, relative to opcodeID
+	QList<int> jumpTargets(int opcodeID, int nbOpcode) const;
 private:
+	void decodeOpcodes(int opcodeID, int removedCount, int insertedCount);
 	QByteArray scriptData;
+	QList<quint32> _keys;
+	QList<qint32> _params;
 	bool _demo;
 };
@@ -17,6 +17,7 @@
  ****************************************************************************/
 #include "JsmExpression.h"
 #include "JsmOpcode.h"
+#include "JsmArena.h"
 #include "Field.h"
 #include "Config.h"
 #include "Data.h"
@@ -115,7 +116,8 @@ QString JsmExpression::stripParenthesis(const QString &exprStr)
 }
 
 JsmExpression *JsmExpression::factory(const JsmOpcode *op,
-                                      QStack<JsmExpression *> &stack)
+                                      QStack<JsmExpression *> &stack,
+                                      JsmArena &arena)
 {
 	JsmExpression *ret = 0;
 
@@ -124,13 +126,13 @@ JsmExpression *JsmExpression::factory(const JsmOpcode *op,
 		if (op->param() == JsmExpressionUnary::Min
 		        || op->param() == JsmExpressionUnary::Not) {
 			if (!stack.isEmpty()) {
-				ret = new JsmExpressionUnary(
+				ret = arena.create<JsmExpressionUnary>(
 				            JsmExpressionUnary::Operation(op->param()),
 				            stack.pop());
 			}
 		} else if (op->param() <= JsmExpressionBinary::Lsh) {
 			if (stack.size() >= 2) {
-				ret = new JsmExpressionBinary(
+				ret = arena.create<JsmExpressionBinary>(
 				            JsmExpressionBinary::Operation(op->param()),
 				            stack.pop(),
 				            stack.pop());
@@ -138,31 +140,31 @@ JsmExpression *JsmExpression::factory(const JsmOpcode *op,
 		}
 		break;
 	case JsmOpcode::PSHN_L:
-		ret = new JsmExpressionVal(op->param());
+		ret = arena.create<JsmExpressionVal>(op->param());
 		break;
 	case JsmOpcode::PSHI_L:
-		ret = new JsmExpressionTemp(op->param());
+		ret = arena.create<JsmExpressionTemp>(op->param());
 		break;
 	case JsmOpcode::PSHM_B:
-		ret = new JsmExpressionVarUByte(op->param());
+		ret = arena.create<JsmExpressionVarUByte>(op->param());
 		break;
 	case JsmOpcode::PSHM_W:
-		ret = new JsmExpressionVarUWord(op->param());
+		ret = arena.create<JsmExpressionVarUWord>(op->param());
 		break;
 	case JsmOpcode::PSHM_L:
-		ret = new JsmExpressionVarULong(op->param());
+		ret = arena.create<JsmExpressionVarULong>(op->param());
 		break;
 	case JsmOpcode::PSHSM_B:
-		ret = new JsmExpressionVarSByte(op->param());
+		ret = arena.create<JsmExpressionVarSByte>(op->param());
 		break;
 	case JsmOpcode::PSHSM_W:
-		ret = new JsmExpressionVarSWord(op->param());
+		ret = arena.create<JsmExpressionVarSWord>(op->param());
 		break;
 	case JsmOpcode::PSHSM_L:
-		ret = new JsmExpressionVarSLong(op->param());
+		ret = arena.create<JsmExpressionVarSLong>(op->param());
 		break;
 	case JsmOpcode::PSHAC:
-		ret = new JsmExpressionChar(op->param());
+		ret = arena.create<JsmExpressionChar>(op->param());
 		break;
 	default:
 		break;
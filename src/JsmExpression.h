@@ -24,6 +24,7 @@ class JsmControl;
 class JsmExpression;
 class JsmApplication;
 class Field;
+class JsmArena;
 
 class JsmInstruction
 {
@@ -116,8 +117,10 @@ public:
 	virtual int eval(bool *ok) const;
 	virtual ExpressionType type() const=0;
 	static QString stripParenthesis(const QString &exprStr);
+	// The expression is allocated in arena
 	static JsmExpression *factory(const JsmOpcode *op,
-	                              QStack<JsmExpression *> &stack);
+	                              QStack<JsmExpression *> &stack,
+	                              JsmArena &arena);
 };
 
 class JsmExpressionVal : public JsmExpression
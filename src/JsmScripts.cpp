@@ -310,38 +310,25 @@ int JsmScripts::posOpcode(int groupID, int methodID, int opcodeID) const
 	return posScript(groupID, methodID) + opcodeID;
 }
 
-QList<int> JsmScripts::searchJumps(const QList<JsmOpcode *> &opcodes) const
+QList<int> JsmScripts::searchJumps(int groupID, int methodID) const
 {
-	QMap<int, bool> labels;
-	int i = 0, nbOpcode = opcodes.size();
-
-	for (JsmOpcode *op: opcodes) {
-		quint32 key = op->key();
-
-		if (key >= JsmOpcode::JMP && key <= JsmOpcode::GJMP) {
-			int jumpTo = i + op->param();
-			if (jumpTo >= 0 && jumpTo < nbOpcode) {
-				labels.insert(jumpTo, true);
-			}
-		}
-		++i;
-	}
+	int nbOpcode, position = posScript(groupID, methodID, &nbOpcode);
 
-	// Sort labels by jumpTo
-	return labels.keys();
+	// Sorted by jumpTo
+	return scriptData.jumpTargets(position, nbOpcode);
 }
 
 QList<JsmOpcode *> JsmScripts::opcodesp(int groupID, int methodID,
-                                        bool withLabels) const
+                                        bool withLabels, JsmArena &arena) const
 {
 	int nbOpcode, position;
 
 	position = posScript(groupID, methodID, &nbOpcode);
 
-	QList<JsmOpcode *> opcodes = scriptData.opcodesp(position, nbOpcode);
+	QList<JsmOpcode *> opcodes = scriptData.opcodesp(arena, position, nbOpcode);
 
 	if (withLabels) {
-		QList<int> labels = searchJumps(opcodes);
+		QList<int> labels = scriptData.jumpTargets(position, nbOpcode);
 		QMutableListIterator<JsmOpcode *> it(opcodes);
 		int i = 0;
 		while (it.hasNext()) {
@@ -350,7 +337,7 @@ QList<JsmOpcode *> JsmScripts::opcodesp(int groupID, int methodID,
 			if (lbl != -1) {
 				// Add label lbl
 				it.previous();
-				it.insert(new JsmOpcodeLabel(lbl));
+				it.insert(arena.create<JsmOpcodeLabel>(lbl));
 				it.next();
 			}
 
@@ -359,8 +346,7 @@ QList<JsmOpcode *> JsmScripts::opcodesp(int groupID, int methodID,
 				int param = op->param(),
 				    lbl = labels.indexOf(i + param);
 				if (lbl != -1) {
-					it.setValue(new JsmOpcodeGoto(*op, lbl));
-					delete op;
+					it.setValue(arena.create<JsmOpcodeGoto>(*op, lbl));
 				}
 			}
 
@@ -372,7 +358,7 @@ QList<JsmOpcode *> JsmScripts::opcodesp(int groupID, int methodID,
 }
 
 void JsmScripts::mergeAndConditions(JsmControl *control, int pos, int posEnd,
-                                    QSet<void *> &collectPointers,
+                                    JsmArena &arena,
                                     QSet<int> &usedLabels)
 {
 	JsmProgram programCopy = control->block();
@@ -393,13 +379,12 @@ void JsmScripts::mergeAndConditions(JsmControl *control, int pos, int posEnd,
 						pos += 1;
 						// This goto will be converted to and condition
 						JsmExpression *newCondition =
-						        new JsmExpressionBinary(
+						        arena.create<JsmExpressionBinary>(
 						            JsmExpressionBinary::LogAnd,
 						            control->condition(),
 						            subControl->condition());
 						control->block().removeFirst();
 						control->setCondition(newCondition);
-						collectPointers.insert(newCondition);
 						usedLabels.remove(((JsmOpcodeGoto *)opcode)->label());
 						continue;
 					}
@@ -414,7 +399,7 @@ JsmProgram JsmScripts::program(const QList<JsmOpcode *>::const_iterator &constBe
                                QList<JsmOpcode *>::const_iterator it,
                                const QList<JsmOpcode *>::const_iterator &end,
                                const QList<int> &labels,
-                               QSet<void *> &collectPointers,
+                               JsmArena &arena,
                                QSet<int> &usedLabels)
 {
 	JsmProgram ret;
@@ -426,19 +411,17 @@ JsmProgram JsmScripts::program(const QList<JsmOpcode *>::const_iterator &constBe
 		int lbl = labels.indexOf(pos);
 		if (lbl != -1) {
 			// Add label lbl
-			JsmOpcode *opLabel = new JsmOpcodeLabel(lbl);
+			JsmOpcode *opLabel = arena.create<JsmOpcodeLabel>(lbl);
 			ret.append(JsmInstruction(opLabel));
-			collectPointers.insert(opLabel);
 		}
 
 		++it;
 
 		// Compute expressions from PUSH and CAL, will modify the stack
-		JsmExpression *expression = JsmExpression::factory(op, stack);
+		JsmExpression *expression = JsmExpression::factory(op, stack, arena);
 
 		if (expression) {
-			collectPointers.insert(expression);
-			delete op; // Delete push/cal
+			// Push/cal are part of the expression now
 		} else {
 			bool instructionAppended = false;
 			// Use the stack
@@ -466,20 +449,20 @@ JsmProgram JsmScripts::program(const QList<JsmOpcode *>::const_iterator &constBe
 								if (lastOpOfBlock->param() > 0
 										&& ifElseEnd - 1 + lastOpOfBlock->param() <= end) {
 									// If Else
-									toAppend = new JsmControlIfElse(
+									toAppend = arena.create<JsmControlIfElse>(
 									               condition,
 									               // Block If
 									               program(constBegin, ifElsePos,
 									                       // Remove JMP
 									                       ifElseEnd - 1, labels,
-									                       collectPointers,
+									                       arena,
 									                       usedLabels),
 									               // Block Else
 									               program(constBegin, ifElseEnd,
 									                       ifElseEnd +
 									                       lastOpOfBlock->param() -
 									                       1, labels,
-									                       collectPointers,
+									                       arena,
 									                       usedLabels));
 
 									ifElseEnd += lastOpOfBlock->param() - 1;
@@ -487,39 +470,39 @@ JsmProgram JsmScripts::program(const QList<JsmOpcode *>::const_iterator &constBe
 										  && ifElseEnd + lastOpOfBlock->param() ==
 										  ifElsePos - condition->opcodeCount()) {
 									// While
-									toAppend = new JsmControlWhile(
+									toAppend = arena.create<JsmControlWhile>(
 									               condition,
 									               // Block loop
 									               program(constBegin, ifElsePos,
 									                       // Remove JMP
 									                       ifElseEnd - 1, labels,
-									                       collectPointers,
+									                       arena,
 									                       usedLabels));
 								}
 							}
 							if (!toAppend) {
 								// If
-								toAppend = new JsmControlIfElse(
+								toAppend = arena.create<JsmControlIfElse>(
 								               condition,
 								               // Block If
 								               program(constBegin, ifElsePos,
 								                       ifElseEnd, labels,
-								                       collectPointers,
+								                       arena,
 								                       usedLabels));
 							}
 
 							mergeAndConditions(toAppend, ifElsePos - constBegin,
 							                   (it - constBegin) + op->param() - 1,
-							                   collectPointers, usedLabels);
+							                   arena, usedLabels);
 
 							it = ifElseEnd;
 						} // else if (op->param() <= 0 0 && it - 1 + op->param() >= 0) {
 							// TODO: repeatUntil: remove appended opcodes from ret
-							// toAppend = new JsmControlRepeatUntil(
+							// toAppend = arena.create<JsmControlRepeatUntil>(
 							//							stack.pop(),
 							//							program(constBegin, it - 1 + op->param(),
 							//									it - 1, labels,
-							//									collectPointers));
+							//									arena));
 						// }
 						if (!toAppend) { // JPF
 							int lbl = labels.indexOf(pos + op->param());
@@ -527,50 +510,42 @@ JsmProgram JsmScripts::program(const QList<JsmOpcode *>::const_iterator &constBe
 								qDebug() << labels << op->toString();
 								qFatal("%s", qUtf8Printable(QString("JsmScripts::program 1 label for pos %1 + %2 not found").arg(pos).arg(op->param())));
 							}
-							JsmOpcodeGoto *jmp = new JsmOpcodeGoto(*op, lbl);
+							JsmOpcodeGoto *jmp = arena.create<JsmOpcodeGoto>(*op, lbl);
 							jmp->setKey(JsmOpcode::JMP);
-							collectPointers.insert(jmp);
-							toAppend = new JsmControlIfElse(condition, JsmProgram(),
+							toAppend = arena.create<JsmControlIfElse>(condition, JsmProgram(),
 							                                JsmProgram()
 							                                << JsmInstruction(jmp));
 							usedLabels.insert(lbl);
 						}
 						ret.append(JsmInstruction(toAppend));
-						collectPointers.insert(toAppend);
 					} else { // JMP/GJMP
 						int lbl = labels.indexOf(pos + op->param());
 						if (lbl == -1) {
 							qDebug() << labels << op->toString();
 							qFatal("%s", qUtf8Printable(QString("JsmScripts::program 3 label for pos %1 + %2 not found").arg(pos).arg(op->param())));
 						}
-						JsmOpcode *toAppendOp = new JsmOpcodeGoto(*op, lbl);
+						JsmOpcode *toAppendOp = arena.create<JsmOpcodeGoto>(*op, lbl);
 						ret.append(JsmInstruction(toAppendOp));
-						collectPointers.insert(toAppendOp);
 						usedLabels.insert(lbl);
 					}
-					delete op; // Remove JPF/JMP/GJMP
 					instructionAppended = true;
 				} else if (op->key() == JsmOpcode::POPI_L
 				          || op->key() == JsmOpcode::POPM_B
 				          || op->key() == JsmOpcode::POPM_W
 				          || op->key() == JsmOpcode::POPM_L) {
-					JsmApplication *application = new JsmApplicationAssignment(
+					JsmApplication *application = arena.create<JsmApplicationAssignment>(
 					                                  stack.pop(), op);
 					ret.append(JsmInstruction(application));
 					instructionAppended = true;
-					collectPointers.insert(application);
-					collectPointers.insert(op);
 				} else if (stack.size() >= 2
 				          && op->key() >= JsmOpcode::REQ
 				          && op->key() <= JsmOpcode::REQEW) {
-					JsmApplication *exec = new JsmApplicationExec(
+					JsmApplication *exec = arena.create<JsmApplicationExec>(
 					                           stack.pop(),
 					                           stack.pop(),
 					                           op);
 					ret.append(JsmInstruction(exec));
 					instructionAppended = true;
-					collectPointers.insert(exec);
-					collectPointers.insert(op);
 				}
 			}
 
@@ -581,13 +556,11 @@ JsmProgram JsmScripts::program(const QList<JsmOpcode *>::const_iterator &constBe
 						// FIXME: only pop what will be used by the game for this application
 						invertedStack.push(stack.pop());
 					}
-					JsmApplication *application = new JsmApplication(invertedStack, op);
+					JsmApplication *application = arena.create<JsmApplication>(invertedStack, op);
 					ret.append(JsmInstruction(application));
-					collectPointers.insert(application);
 				} else {
 					ret.append(JsmInstruction(op));
 				}
-				collectPointers.insert(op);
 			}
 		}
 	}
@@ -598,16 +571,15 @@ JsmProgram JsmScripts::program(const QList<JsmOpcode *>::const_iterator &constBe
 			// FIXME: only pop what will be used by the game for this application
 			invertedStack.push(stack.pop());
 		}
-		JsmApplication *application = new JsmApplication(invertedStack, nullptr);
+		JsmApplication *application = arena.create<JsmApplication>(invertedStack, nullptr);
 		ret.append(JsmInstruction(application));
-		collectPointers.insert(application);
 	}
 
 	return ret;
 }
 
 JsmProgram &JsmScripts::program2ndPass(JsmProgram &program,
-                                       QSet<void *> &collectPointers,
+                                       JsmArena &arena,
                                        const QSet<int> &usedLabels)
 {
 	QMutableListIterator<JsmInstruction> it(program);
@@ -616,11 +588,11 @@ JsmProgram &JsmScripts::program2ndPass(JsmProgram &program,
 
 		if (instr.type() == JsmInstruction::Control) {
 			JsmControl *control = instr.control();
-			program2ndPass(control->block(), collectPointers, usedLabels);
+			program2ndPass(control->block(), arena, usedLabels);
 			if (control->type() == JsmControl::IfElse) {
 				JsmControlIfElse *ifElse =
 				        static_cast<JsmControlIfElse *>(control);
-				program2ndPass(ifElse->blockElse(), collectPointers,
+				program2ndPass(ifElse->blockElse(), arena,
 				               usedLabels);
 				if (ifElse->block().isEmpty()) {
 					if (ifElse->blockElse().isEmpty()) { // Useless if/Else
@@ -632,11 +604,10 @@ JsmProgram &JsmScripts::program2ndPass(JsmProgram &program,
 						        logicalNot()) {
 							// Explicit Not
 							JsmExpression *newCondition =
-							        new JsmExpressionUnary(
+							        arena.create<JsmExpressionUnary>(
 							            JsmExpressionUnary::LogNot,
 							            cond);
 							// It is unecessary to delete old pointers here
-							collectPointers.insert(newCondition);
 							ifElse->setCondition(newCondition);
 						}
 						// Else invert binary expression
@@ -656,12 +627,11 @@ JsmProgram &JsmScripts::program2ndPass(JsmProgram &program,
 							// If block without else
 							if (subIfElse->blockElse().isEmpty()) { // And
 								JsmExpression *newCondition =
-								        new JsmExpressionBinary(
+								        arena.create<JsmExpressionBinary>(
 								            JsmExpressionBinary::LogAnd,
 								            ifElse->condition(),
 								            subIfElse->condition());
 								// It is unecessary to delete old pointers here
-								collectPointers.insert(newCondition);
 								ifElse->setCondition(newCondition);
 								ifElse->setBlock(subIfElse->block());
 							}
@@ -673,7 +643,7 @@ JsmProgram &JsmScripts::program2ndPass(JsmProgram &program,
 			// Removing unused labels
 			JsmOpcode *opcode = instr.opcode();
 			if (opcode->isLabel() && !usedLabels.contains(opcode->param())) {
-				it.remove(); // FIXME: we can also delete the pointer and clean collectPointers
+				it.remove(); // The pointer is owned by the arena
 			}
 		}
 	}
@@ -682,25 +652,24 @@ JsmProgram &JsmScripts::program2ndPass(JsmProgram &program,
 }
 
 JsmProgram JsmScripts::program(int groupID, int methodID,
-                               QSet<void *> &collectPointers) const
+                               JsmArena &arena) const
 {
-	QList<JsmOpcode *> opcodes = opcodesp(groupID, methodID, false);
+	QList<JsmOpcode *> opcodes = opcodesp(groupID, methodID, false, arena);
 	if (opcodes.isEmpty()) {
 		return JsmProgram();
 	}
 	JsmOpcode *firstOp = opcodes.first();
-	QList<int> labels = searchJumps(opcodes);
+	QList<int> labels = searchJumps(groupID, methodID);
 	QList<JsmOpcode *>::const_iterator begin = opcodes.constBegin();
 	// Ignore label if correct at the beginning
 	if (firstOp->key() == JsmOpcode::LBL
 	        && firstOp->param() == absoluteMethodID(groupID, methodID)) {
 		begin += 1;
-		delete firstOp;
 	}
 	QSet<int> usedLabels; // Filled by program()
 	JsmProgram p = program(opcodes.constBegin(), begin, opcodes.constEnd(),
-	                       labels, collectPointers, usedLabels);
-	return program2ndPass(p, collectPointers, usedLabels);
+	                       labels, arena, usedLabels);
+	return program2ndPass(p, arena, usedLabels);
 }
 
 unsigned int JsmScripts::key(int groupID, int methodID, int opcodeID) const
@@ -710,7 +679,7 @@ unsigned int JsmScripts::key(int groupID, int methodID, int opcodeID) const
 
 unsigned int JsmScripts::key(int opcodeID) const
 {
-	return opcode(opcodeID).key();
+	return scriptData.key(opcodeID);
 }
 
 //void JsmScripts::setKey(int groupID, int methodID, int opcodeID, unsigned int key)
@@ -732,7 +701,7 @@ int JsmScripts::param(int groupID, int methodID, int opcodeID) const
 
 int JsmScripts::param(int opcodeID) const
 {
-	return opcode(opcodeID).param();
+	return scriptData.param(opcodeID);
 }
 
 void JsmScripts::setParam(int groupID, int methodID, int opcodeID, int param)
@@ -110,11 +110,12 @@ public:
 	int posScript(int groupID, int methodID) const;
 	int posScript(int groupID, int methodID, int *nbOpcode) const;
 	int posOpcode(int groupID, int methodID, int opcodeID) const;
-	QList<int> searchJumps(const QList<JsmOpcode *> &opcodes) const;
+	QList<int> searchJumps(int groupID, int methodID) const;
+	// Opcodes and the decompiled program are owned by arena
 	QList<JsmOpcode *> opcodesp(int groupID, int methodID,
-	                            bool withLabels) const;
+	                            bool withLabels, JsmArena &arena) const;
 	JsmProgram program(int groupID, int methodID,
-	                   QSet<void *> &collectPointers) const;
+	                   JsmArena &arena) const;
 	// Data
 	const JsmData &data() const;
 	unsigned int key(int groupID, int methodID, int opcodeID) const;
@@ -146,16 +147,16 @@ private:
 	void shiftGroupsAfter(int groupID, int methodID, int shiftGroup, int shiftScript);
 	void shiftScriptsAfter(int groupID, int methodID, int shift);
 	static void mergeAndConditions(JsmControl *control, int pos, int posEnd,
-	                               QSet<void *> &collectPointers,
+	                               JsmArena &arena,
 	                               QSet<int> &usedLabels);
 	static JsmProgram program(const QList<JsmOpcode *>::const_iterator &constBegin, 
 	                          QList<JsmOpcode *>::const_iterator it,
 	                          const QList<JsmOpcode *>::const_iterator &end,
 	                          const QList<int> &labels,
-	                          QSet<void *> &collectPointers,
+	                          JsmArena &arena,
 	                          QSet<int> &usedLabels);
 	static JsmProgram &program2ndPass(JsmProgram &program,
-	                                  QSet<void *> &collectPointers,
+	                                  JsmArena &arena,
 	                                  const QSet<int> &usedLabels);
 
 	QList<JsmGroup> groupList;
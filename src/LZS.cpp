@@ -25,72 +25,330 @@
 **************************************************************/
 #include "LZS.h"
 
-qint32 LZS::match_length=0;//of longest match. These are set by the InsertNode() procedure.
-qint32 LZS::match_position=0;
-qint32 LZS::lson[4097];//left & right children & parents -- These constitute binary search trees.
-qint32 LZS::rson[4353];
-qint32 LZS::dad[4097];
-unsigned char LZS::text_buf[4113];//ring buffer of size 4096, with extra 17 bytes to facilitate string comparison
-QByteArray LZS::result;
+thread_local QByteArray LZS::result;
 
-const QByteArray &LZS::decompress(const QByteArray &data, int max)
+namespace {
+
+// A token is one literal byte or a reference of 3 to 18 bytes
+constexpr int LZS_MAX_TOKEN_SIZE = 18;
+
+struct LzsStream
 {
-	return decompress(data.constData(), data.size(), max);
+	const quint8 *data, *end;
+	quint16 flags;
+	int pos;
+};
+
+/*
+ * The 4 KB window is not copied into a ring buffer: the output is the window.
+ * Before the start of the output, the window is filled with zeros.
+ */
+inline int lzsReference(const quint8 *data, const quint8 *end, int pos, int &src)
+{
+	int offset = data[0], length = data + 1 < end ? data[1] : 0;
+	offset |= (length & 0xF0) << 4;
+
+	int distance = (4078 + pos - offset) & 4095;
+	src = pos - (distance == 0 ? 4096 : distance);
+
+	return (length & 0xF) + 3;
 }
 
-const QByteArray &LZS::decompress(const char *data, int fileSize, int max)
+/*
+ * Decode whole tokens into out, without any bound check inside a token.
+ * Stops at the end of data or when pos >= stopAt between two tokens (returns true),
+ * or when the next token may not fit in capacity (returns false, s can be resumed).
+ */
+bool lzsDecodeTokens(LzsStream &s, char *out, int capacity, int stopAt)
 {
-	int sizeAlloc=qMin(max, fileSize * 5);
-	quint16 curBuff=4078, offset, premOctet=0, i, length;
-	const quint8 *fileData = (const quint8 *)data;
-	const quint8 *endFileData = fileData + fileSize;
+	const quint8 *data = s.data, *end = s.end;
+	quint16 flags = s.flags;
+	int pos = s.pos;
+	bool done = true;
 
-	// Internal buffer is still allocated using this method instead of clear
-	result.resize(0);
+	forever
+	{
+		const quint8 *tokenData = data;
+		const quint16 tokenFlags = flags;
 
-	if (result.capacity() < sizeAlloc) {
-		try {
-			result.reserve(sizeAlloc);
-		} catch (std::bad_alloc) {
-			result.clear();
-			return result;
+		if (((flags >>= 1) & 256) == 0) {
+			if (data >= end) {
+				break;
+			}
+			flags = *data++ | 0xff00;
+		}
+
+		if (data >= end || pos >= stopAt) {
+			break;
+		}
+
+		if (pos + LZS_MAX_TOKEN_SIZE > capacity) {
+			data = tokenData;
+			flags = tokenFlags;
+			done = false;
+			break;
+		}
+
+		if (flags & 1) {
+			out[pos++] = char(*data++);
+			continue;
+		}
+
+		int src, length = lzsReference(data, end, pos, src);
+		data += 2;
+
+		if (src >= 0 && pos - src >= 16) {
+			// No overlap on the first 16 bytes: one vector move
+			memcpy(out + pos, out + src, 16);
+			if (length > 16) {
+				out[pos + 16] = out[src + 16];
+				out[pos + 17] = out[src + 17];
+			}
+		} else if (src >= 0) {
+			// Overlap: repeat the last pos - src bytes
+			for (int i = 0; i < length; ++i) {
+				out[pos + i] = out[src + i];
+			}
+		} else {
+			for (int i = 0; i < length; ++i) {
+				out[pos + i] = src + i >= 0 ? out[src + i] : '\0';
+			}
 		}
+
+		pos += length;
 	}
 
-	memset(text_buf, 0, 4078);//Le buffer de 4096 octets est initialisé à 0
+	s.data = data;
+	s.flags = flags;
+	s.pos = pos;
+
+	return done;
+}
+
+/*
+ * Decode the last tokens one byte at a time, until outSize bytes are written,
+ * even in the middle of a reference.
+ */
+void lzsDecodeTail(LzsStream &s, char *out, int outSize)
+{
+	const quint8 *data = s.data, *end = s.end;
+	quint16 flags = s.flags;
+	int pos = s.pos;
 
 	forever
 	{
-		if (((premOctet >>= 1) & 256) == 0) {
-			premOctet = *fileData++ | 0xff00;//On récupère le premier octet puis on avance d'un octet
+		if (((flags >>= 1) & 256) == 0) {
+			if (data >= end) {
+				break;
+			}
+			flags = *data++ | 0xff00;
 		}
 
-		if (fileData >= endFileData || result.size() >= max) {
-			return result; // Done
+		if (data >= end || pos >= outSize) {
+			break;
 		}
 
-		if (premOctet & 1)
-		{
-			result.append(text_buf[curBuff] = *fileData++);//On récupère l'octet (qui n'est pas compressé) et on le sauvegarde dans la chaine finale (result) et dans le buffer. Et bien sûr on fait avancer les curseurs d'un octet.
-			curBuff = (curBuff + 1) & 4095;//Le curseur du buffer doit toujours être entre 0 et 4095
+		if (flags & 1) {
+			out[pos++] = char(*data++);
+			continue;
 		}
-		else
-		{
-			offset = *fileData++;
-			length = *fileData++;
-			offset |= (length & 0xF0) << 4;//on récupère l'offset dans les deux octets (qui sont "compressés")
-			length = (length & 0xF) + 2 + offset;
 
-			for (i = offset; i <= length; ++i)
-			{
-				result.append(text_buf[curBuff] = text_buf[i & 4095]);//On va chercher l'octet (qui est décompressé) dans le buffer à l'adresse indiquée puis on le sauvegarde dans la chaine finale et le buffer.
-				curBuff = (curBuff + 1) & 4095;
+		int src, length = lzsReference(data, end, pos, src);
+		data += 2;
+
+		for (int i = 0; i < length && pos < outSize; ++i, ++pos) {
+			out[pos] = src + i >= 0 ? out[src + i] : '\0';
+		}
+	}
+
+	s.data = data;
+	s.flags = flags;
+	s.pos = pos;
+}
+
+// Farthest reference produced by the original encoder (window minus lookahead)
+constexpr int LZS_MAX_DISTANCE = 4096 - LZS_MAX_TOKEN_SIZE;
+constexpr int LZS_MIN_MATCH = 3;
+constexpr int LZS_HASH_BITS = 13;
+// Candidates tested per position, Best visits the whole window
+constexpr int LZS_FAST_DEPTH = 8;
+constexpr int LZS_BEST_DEPTH = 4096;
+
+/*
+ * Positions are indexes in a buffer starting with LZS_MAX_TOKEN_SIZE zeros,
+ * standing for the initial window, followed by the data.
+ * prev is a ring of 4096 entries: an entry is only read while it is in the window.
+ */
+struct LzsHashChain
+{
+	const quint8 *buf;
+	qint32 *head, *prev;
+
+	static inline quint32 hash(const quint8 *p) {
+		return ((quint32(p[0]) << 16 | quint32(p[1]) << 8 | p[2]) * 2654435761u) >> (32 - LZS_HASH_BITS);
+	}
+
+	inline void insert(int pos) {
+		qint32 &h = head[hash(buf + pos)];
+		prev[pos & 4095] = h;
+		h = pos;
+	}
+
+	int longestMatch(int pos, int maxLength, int depth, int &matchPos) const
+	{
+		int bestLength = 0;
+
+		for (qint32 cand = head[hash(buf + pos)];
+		     cand >= 0 && pos - cand <= LZS_MAX_DISTANCE && depth-- > 0;
+		     cand = prev[cand & 4095]) {
+			// Quick reject: a longer match must differ from the best one at this byte
+			if (buf[cand + bestLength] != buf[pos + bestLength]) {
+				continue;
+			}
+
+			int length = 0;
+			while (length < maxLength && buf[cand + length] == buf[pos + length]) {
+				++length;
 			}
+
+			if (length > bestLength) {
+				bestLength = length;
+				matchPos = cand;
+				if (length >= maxLength) {
+					break;
+				}
+			}
+		}
+
+		return bestLength;
+	}
+};
+
+/*
+ * Groups tokens by eight behind a flag byte, like the original encoder.
+ */
+class LzsTokenWriter
+{
+public:
+	explicit LzsTokenWriter(QByteArray &out) : _out(out), _ptr(1), _mask(1) {
+		_code[0] = 0;
+	}
+
+	inline void literal(quint8 c) {
+		_code[0] |= _mask;
+		_code[_ptr++] = c;
+		next();
+	}
+
+	// src is the position in the output of the first byte to repeat
+	inline void reference(int src, int length) {
+		int offset = (4078 + src) & 4095;
+		_code[_ptr++] = quint8(offset);
+		_code[_ptr++] = quint8(((offset >> 4) & 0xF0) | (length - LZS_MIN_MATCH));
+		next();
+	}
+
+	void flush() {
+		if (_ptr > 1) {
+			_out.append((char *)_code, _ptr);
+		}
+	}
+private:
+	inline void next() {
+		if ((_mask <<= 1) == 0) {
+			_out.append((char *)_code, _ptr);
+			_code[0] = 0;
+			_ptr = 1;
+			_mask = 1;
+		}
+	}
+
+	QByteArray &_out;
+	quint8 _code[17];
+	int _ptr;
+	quint8 _mask;
+};
+
+}
+
+bool LzsDecoder::decompress(const char *data, int fileSize, QByteArray &out, int max)
+{
+	qint64 capacity = qMin(qint64(max), qint64(fileSize) * 5) + LZS_MAX_TOKEN_SIZE;
+
+	// Internal buffer is still allocated using this method instead of clear
+	out.resize(0);
+
+	if (fileSize <= 0) {
+		return true;
+	}
+
+	LzsStream s;
+	s.data = (const quint8 *)data;
+	s.end = s.data + fileSize;
+	s.flags = 0;
+	s.pos = 0;
+
+	forever {
+		if (capacity > std::numeric_limits<int>::max()) {
+			out.clear();
+			return false;
+		}
+
+		try {
+			out.resize(capacity);
+		} catch (const std::bad_alloc &) {
+			out.clear();
+			return false;
+		}
+
+		if (lzsDecodeTokens(s, out.data(), int(capacity), max)) {
+			break;
 		}
+
+		// The output never exceeds max by more than one token
+		capacity = qMax(qint64(s.pos) + LZS_MAX_TOKEN_SIZE,
+		                qMin(capacity * 2, qint64(max) + LZS_MAX_TOKEN_SIZE));
+	}
+
+	out.resize(s.pos);
+
+	return true;
+}
+
+int LzsDecoder::decompress(const char *data, int fileSize, char *out, int outSize)
+{
+	if (fileSize <= 0 || outSize <= 0) {
+		return 0;
 	}
+
+	LzsStream s;
+	s.data = (const quint8 *)data;
+	s.end = s.data + fileSize;
+	s.flags = 0;
+	s.pos = 0;
+
+	if (!lzsDecodeTokens(s, out, outSize, outSize)) {
+		lzsDecodeTail(s, out, outSize);
+	}
+
+	return s.pos;
+}
+
+const QByteArray &LZS::decompress(const QByteArray &data, int max)
+{
+	return decompress(data.constData(), data.size(), max);
+}
+
+const QByteArray &LZS::decompress(const char *data, int fileSize, int max)
+{
+	static thread_local LzsDecoder decoder;
+
+	decoder.decompress(data, fileSize, result, max);
+
+	return result;
 }
 
-void LZS::InsertNode(qint32 r)
+void LzsEncoder::InsertNode(qint32 r)
 {
 	/* Inserts string of length 18, text_buf[r..r+18-1], into one of the trees (text_buf[r]'th tree) and returns the longest-match position and length via the global variables match_position and match_length.
 	If match_length = 18, then removes the old node in favor of the new one, because the old one will be deleted sooner.
@@ -165,7 +423,7 @@ void LZS::InsertNode(qint32 r)
 	dad[p] = 4096;//remove p
 }
 
-void LZS::DeleteNode(qint32 p)//deletes node p from tree
+void LzsEncoder::DeleteNode(qint32 p)//deletes node p from tree
 {
 	qint32 q;
 	if (dad[p] == 4096)	return;//not in tree
@@ -210,20 +468,37 @@ void LZS::DeleteNode(qint32 p)//deletes node p from tree
 	dad[p] = 4096;
 }
 
-const QByteArray &LZS::compress(const QByteArray &fileData)
+bool LzsEncoder::compress(const char *data, int sizeData, QByteArray &out, Level level)
 {
-	return compress(fileData.constData(), fileData.size());
+	switch (level) {
+	case Fast:
+		return compressHashChain(data, sizeData, out, false);
+	case Best:
+		return compressHashChain(data, sizeData, out, true);
+	case Normal:
+		break;
+	}
+
+	return compressTree(data, sizeData, out);
 }
 
-const QByteArray &LZS::compress(const char *data, int sizeData)
+bool LzsEncoder::compressTree(const char *data, int sizeData, QByteArray &out)
 {
 	int i, c, len, r, s, last_match_length, code_buf_ptr,
-			curResult = 0, sizeAlloc = sizeData / 2;
+			sizeAlloc = sizeData / 2;
 	unsigned char code_buf[17], mask;
-	const char *dataEnd = &data[sizeData-1] + 1;
+	const char *dataEnd = data + qMax(sizeData, 0);
+
+	// Internal buffer is still allocated using this method instead of clear
+	out.resize(0);
 
-	if (result.size() < sizeAlloc) {
-		result.resize(sizeAlloc);
+	if (out.capacity() < sizeAlloc) {
+		try {
+			out.reserve(sizeAlloc);
+		} catch (const std::bad_alloc &) {
+			out.clear();
+			return false;
+		}
 	}
 
 	/* quint32
@@ -247,13 +522,12 @@ const QByteArray &LZS::compress(const char *data, int sizeData)
 
 //	for (i=s ; i<r ; ++i)
 //		text_buf[i] = '\x0';//Clear the buffer with  any character that will appear often.
-	memset(text_buf, 0, r);
+	memset(text_buf, 0, sizeof(text_buf));//The 17 extra bytes mirror the beginning of the buffer
 
 	for (len=0 ; len<18 && data<dataEnd ; ++len)
 		text_buf[r + len] = *data++;//Read 18 bytes into the last 18 bytes of the buffer
 	if (/* (textsize =  */len/* ) */ == 0) {
-		result.clear();
-		return result;//text of size zero
+		return true;//text of size zero
 	}
 
 	for (i=1 ; i<=18 ; ++i)
@@ -282,8 +556,7 @@ const QByteArray &LZS::compress(const char *data, int sizeData)
 		{
 //			for (i=0 ; i<code_buf_ptr ; ++i)//Send at most 8 units of
 //				result.append(code_buf[i]);//code together
-			result.replace(curResult, code_buf_ptr, (char *)code_buf, code_buf_ptr);
-			curResult += code_buf_ptr;
+			out.append((char *)code_buf, code_buf_ptr);
 			code_buf[0] = 0;
 			code_buf_ptr = mask = 1;
 		}
@@ -320,10 +593,130 @@ const QByteArray &LZS::compress(const char *data, int sizeData)
 	{
 //		for (i = 0; i < code_buf_ptr ; ++i)
 //			result.append(code_buf[i]);
-		result.replace(curResult, code_buf_ptr, (char *)code_buf, code_buf_ptr);
-		curResult += code_buf_ptr;
+		out.append((char *)code_buf, code_buf_ptr);
+	}
+
+	return true;
+}
+
+bool LzsEncoder::compressHashChain(const char *data, int sizeData, QByteArray &out, bool optimal)
+{
+	const int size = qMax(sizeData, 0), start = LZS_MAX_TOKEN_SIZE, end = start + size;
+
+	// Internal buffer is still allocated using this method instead of clear
+	out.resize(0);
+
+	if (size == 0) {
+		return true;
 	}
-	result.truncate(curResult);
+
+	try {
+		if (out.capacity() < size / 2) {
+			out.reserve(size / 2);
+		}
+		// Padded to hash the last positions
+		_window.fill('\0', end + LZS_MIN_MATCH);
+		_head.fill(-1, 1 << LZS_HASH_BITS);
+		_prev.resize(4096);
+		if (optimal) {
+			_matchPositions.resize(size);
+			_matchLengths.resize(size);
+			_costs.resize(size + 1);
+		}
+	} catch (const std::bad_alloc &) {
+		out.clear();
+		return false;
+	}
+
+	memcpy(_window.data() + start, data, size_t(size));
+
+	LzsHashChain chain;
+	chain.buf = (const quint8 *)_window.constData();
+	chain.head = _head.data();
+	chain.prev = _prev.data();
+
+	for (int pos = 0; pos < start; ++pos) {
+		chain.insert(pos);
+	}
+
+	LzsTokenWriter writer(out);
+
+	if (!optimal) {
+		int pos = start;
+		while (pos < end) {
+			int matchPos = 0,
+			    length = chain.longestMatch(pos, qMin(LZS_MAX_TOKEN_SIZE, end - pos), LZS_FAST_DEPTH, matchPos);
+
+			if (length < LZS_MIN_MATCH) {
+				writer.literal(chain.buf[pos]);
+				length = 1;
+			} else {
+				writer.reference(matchPos - start, length);
+			}
+
+			for (int i = 0; i < length; ++i) {
+				chain.insert(pos + i);
+			}
+			pos += length;
+		}
+
+		writer.flush();
+
+		return true;
+	}
+
+	qint32 *matchPositions = _matchPositions.data(), *costs = _costs.data();
+	quint8 *matchLengths = _matchLengths.data();
+
+	// Longest match at every position: any shorter length is also a match there
+	for (int pos = start; pos < end; ++pos) {
+		int matchPos = 0, i = pos - start;
+		matchLengths[i] = quint8(chain.longestMatch(pos, qMin(LZS_MAX_TOKEN_SIZE, end - pos), LZS_BEST_DEPTH, matchPos));
+		matchPositions[i] = matchPos - start;
+		chain.insert(pos);
+	}
+
+	// Cheapest encoding of the suffix starting at every position, in bits
+	// (a literal costs 8 bits plus its flag, a reference 16 bits plus its flag)
+	costs[size] = 0;
+	for (int i = size - 1; i >= 0; --i) {
+		int bestCost = costs[i + 1] + 9, bestLength = 1;
+
+		for (int length = LZS_MIN_MATCH; length <= matchLengths[i]; ++length) {
+			if (costs[i + length] + 17 < bestCost) {
+				bestCost = costs[i + length] + 17;
+				bestLength = length;
+			}
+		}
+
+		costs[i] = bestCost;
+		matchLengths[i] = quint8(bestLength);
+	}
+
+	for (int i = 0; i < size; i += matchLengths[i]) {
+		if (matchLengths[i] == 1) {
+			writer.literal(chain.buf[start + i]);
+		} else {
+			writer.reference(matchPositions[i], matchLengths[i]);
+		}
+	}
+
+	writer.flush();
+
+	return true;
+}
+
+const QByteArray &LZS::compress(const QByteArray &fileData, LzsEncoder::Level level)
+{
+	return compress(fileData.constData(), fileData.size(), level);
+}
+
+const QByteArray &LZS::compress(const char *data, int sizeData, LzsEncoder::Level level)
+{
+	static thread_local LzsEncoder encoder;
+
+	encoder.compress(data, sizeData, result, level);
+
 	return result;
 }
 
@@ -26,23 +26,69 @@
 #pragma once
 
 #include <QByteArray>
+#include <QList>
 
+/*
+ * LZS decoder writing directly into the output, which is also the window
+ * of back-references (no ring buffer). It has no state, it is kept as
+ * a class for symmetry with LzsEncoder.
+ */
+class LzsDecoder
+{
+public:
+	LzsDecoder() {}
+	// Decompress into out (previous content is discarded, capacity is kept)
+	bool decompress(const char *data, int fileSize, QByteArray &out, int max = std::numeric_limits<int>::max());
+	// Decompress into a caller-supplied buffer, returns the number of bytes written.
+	// Bytes after the returned count may have been modified
+	int decompress(const char *data, int fileSize, char *out, int outSize);
+};
+
+/*
+ * LZS encoder with three effort levels, all readable by the game:
+ *  - Fast: greedy parsing with short hash chains, for interactive saves
+ *  - Normal: the original binary search trees (same output as before)
+ *  - Best: exhaustive search in the window and optimal parsing
+ * An instance can be reused for several files, but not shared between threads.
+ */
+class LzsEncoder
+{
+public:
+	enum Level {
+		Fast, Normal, Best
+	};
+	LzsEncoder() {}
+	// Compress into out (previous content is discarded, capacity is kept)
+	bool compress(const char *data, int sizeData, QByteArray &out, Level level = Normal);
+private:
+	bool compressTree(const char *data, int sizeData, QByteArray &out);
+	bool compressHashChain(const char *data, int sizeData, QByteArray &out, bool optimal);
+	void InsertNode(qint32 r);
+	void DeleteNode(qint32 p);
+	qint32 match_length;//of longest match. These are set by the InsertNode() procedure.
+	qint32 match_position;
+	qint32 lson[4097];//left & right children & parents -- These constitute binary search trees.
+	qint32 rson[4353];
+	qint32 dad[4097];
+	unsigned char text_buf[4113];//ring buffer of size 4096, with extra 17 bytes to facilitate string comparison
+	// Hash chains and optimal parsing (allocated on first use)
+	QByteArray _window;
+	QList<qint32> _head, _prev, _matchPositions, _costs;
+	QList<quint8> _matchLengths;
+};
+
+/*
+ * Convenience wrappers, the returned reference is valid until the next call
+ * in the same thread.
+ */
 class LZS
 {
 public:
 	static const QByteArray &decompress(const QByteArray &data, int max = std::numeric_limits<int>::max());
 	static const QByteArray &decompress(const char *data, int fileSize, int max =  std::numeric_limits<int>::max());
-	static const QByteArray &compress(const QByteArray &fileData);
-	static const QByteArray &compress(const char *data, int sizeData);
+	static const QByteArray &compress(const QByteArray &fileData, LzsEncoder::Level level = LzsEncoder::Normal);
+	static const QByteArray &compress(const char *data, int sizeData, LzsEncoder::Level level = LzsEncoder::Normal);
 	static void clear();
 private:
-	static void InsertNode(qint32 r);
-	static void DeleteNode(qint32 p);
-	static qint32 match_length;//of longest match. These are set by the InsertNode() procedure.
-	static qint32 match_position;
-	static qint32 lson[4097];//left & right children & parents -- These constitute binary search trees.
-	static qint32 rson[4353];
-	static qint32 dad[4097];
-	static unsigned char text_buf[4113];//ring buffer of size 4096, with extra 17 bytes to facilitate string comparison
-	static QByteArray result;
+	static thread_local QByteArray result;
 };
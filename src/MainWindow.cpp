@@ -41,7 +41,7 @@
 #include "FieldPC.h"
 #include "TextPreview.h"
 #include "ConfigDialog.h"
-#include "FieldThread.h"
+#include "FieldLoader.h"
 #include "FF8Image.h"
 #include "Search.h"
 #include "SearchAll.h"
@@ -52,7 +52,7 @@
 
 MainWindow::MainWindow()
     : fieldArchive(nullptr), field(nullptr), currentField(nullptr),
-      fieldThread(new FieldThread), msdFile(nullptr), jsmFile(nullptr), menuGameLang(nullptr),
+      fieldLoader(new FieldLoader(this)), msdFile(nullptr), jsmFile(nullptr), menuGameLang(nullptr),
       fsDialog(nullptr), _varManager(nullptr), firstShow(true)
 {
 	setMinimumSize(700, 600);
@@ -213,7 +213,7 @@ MainWindow::MainWindow()
 		connect(pageWidget, SIGNAL(modified()), SLOT(setModified()));
 	}
 	connect(bgPreview, SIGNAL(triggered()), SLOT(bgPage()));
-	connect(fieldThread, SIGNAL(background(QImage)), SLOT(fillBackground(QImage)));
+	connect(fieldLoader, SIGNAL(loaded(Field*)), SLOT(fieldLoaded(Field*)));
 }
 
 void MainWindow::fillRecentMenu()
@@ -316,7 +316,8 @@ bool MainWindow::openArchive(const QString &path)
 		int fieldID=0;
 		for (Field *field: fieldArchive->getFields()) {
 			QString desc;
-			if (field->hasJsmFile())
+			// Do not open lazy fields here, the location is set later by fillPage()
+			if (field->isLoaded() && field->hasJsmFile())
 				desc = Data::location(field->getJsmFile()->mapID());
 			else
 				desc = QString();
@@ -548,6 +549,7 @@ void MainWindow::fillPage()
 	bgPreview->clear();
 
 	QElapsedTimer t;t.start();
+	Field *previousField = currentField;
 
 	if (this->field != nullptr) {
 		currentField = this->field;
@@ -565,36 +567,74 @@ void MainWindow::fillPage()
 		currentField = fieldArchive->getField(fieldID);
 		if (currentField == nullptr)	return;
 
+		if (item->text(1).isEmpty() && currentField->hasJsmFile()) {
+			item->setText(1, Data::location(currentField->getJsmFile()->mapID()));
+		}
+
 		emit fieldIdChanged(fieldID);
 
-		fieldArchive->openBG(currentField);
-		/*if (fieldThread->isRunning()) {
-			qDebug() << "exit thread";
-			fieldThread->exit(0);
+		// Prefetched fields are opened now, the others by fieldLoaded()
+		FieldArchive::BGData data;
+		bool prefetched = fieldLoader->take(currentField, data);
+
+		if (prefetched) {
+			fieldArchive->openBG(currentField, data);
 		}
-		qDebug() << "setData thread";
-		fieldThread->setData(fieldArchive, currentField);
-		qDebug() << "start thread";
-		fieldThread->start();*/
+
+		fieldLoader->load(fieldArchive, prefetched ? nullptr : currentField,
+		                  fieldArchive->neighbourFields(currentField));
+	}
+
+	if (fieldArchive != nullptr) {
+		fieldArchive->setCurrentField(currentField);
 	}
 
 	for (PageWidget *pageWidget: pageWidgets)
 		pageWidget->setData(currentField);
 
-	if (currentField->hasBackgroundFile())
-		bgPreview->fill(QPixmap::fromImage(currentField->getBackgroundFile()->background()));
-	else
-		bgPreview->fill(QPixmap());
-	bgPreview->setEnabled(currentField->hasBackgroundFile());
+	// Only the displayed field keeps its MIM data in memory
+	if (previousField != nullptr && previousField != currentField && previousField->hasBackgroundFile()) {
+		previousField->getBackgroundFile()->releaseMim();
+	}
+
+	fillBackgroundPreview();
 
 //	qDebug() << "BG" << t.elapsed();
 
 	pageWidgets.at(tabBar->currentIndex())->fill();
 }
 
-void MainWindow::fillBackground(const QImage &image)
+void MainWindow::fieldLoaded(Field *field)
 {
-	bgPreview->fill(QPixmap::fromImage(image));
+	FieldArchive::BGData data;
+
+	if (field != currentField || fieldArchive == nullptr || !fieldLoader->take(field, data)) {
+		return;
+	}
+
+	fieldArchive->openBG(field, data);
+
+	// Pages were filled without the second-stage files
+	for (PageWidget *pageWidget: pageWidgets)
+		pageWidget->clear();
+
+	fillBackgroundPreview();
+
+	if (tabBar->currentIndex() < tabBar->count() - 1)
+		pageWidgets.at(tabBar->currentIndex())->fill();
+}
+
+void MainWindow::fillBackgroundPreview()
+{
+	// The MIM data is missing until the field is loaded
+	bool hasBackground = currentField->hasBackgroundFile()
+	        && currentField->getBackgroundFile()->hasMim();
+
+	if (hasBackground)
+		bgPreview->fill(QPixmap::fromImage(currentField->getBackgroundFile()->background()));
+	else
+		bgPreview->fill(QPixmap());
+	bgPreview->setEnabled(hasBackground);
 }
 
 void MainWindow::setModified(bool modified)
@@ -669,6 +709,7 @@ int MainWindow::closeFiles(bool quit)
 	}
 
 	currentField = nullptr;
+	fieldLoader->clear();
 
 	if (fieldArchive != nullptr) {
 		delete fieldArchive;
@@ -799,6 +840,7 @@ void MainWindow::saveAs(const QString &optPath)
 	if (fieldArchive != nullptr) {
 		ProgressWidget progress(tr("Save..."), ProgressWidget::Cancel, this);
 
+		fieldLoader->clear();
 		ok = ((FieldArchivePC *)fieldArchive)->save(&progress, path);
 	} else if (msdFile != nullptr) {
 		QByteArray data;
@@ -1079,6 +1121,7 @@ void MainWindow::optimizeArchive()
 
 	ProgressWidget progress(tr("Optimization..."), ProgressWidget::Cancel, this);
 
+	fieldLoader->clear();
 	((FieldArchivePC *)fieldArchive)->optimiseArchive(&progress);
 }
 
@@ -1154,6 +1197,9 @@ void MainWindow::setCurrentPage(int index)
 		}
 		QString path;
 
+		// The archive can be modified by this page
+		fieldLoader->clear();
+
 		if (fsDialog) {
 			path = fsDialog->getCurrentPath();
 			mainStackedWidget->removeWidget(fsDialog);
@@ -20,7 +20,7 @@
 #include <QtWidgets>
 
 class FieldArchive;
-class FieldThread;
+class FieldLoader;
 class FieldPC;
 class Field;
 class MsdFile;
@@ -60,7 +60,7 @@ public slots:
 private slots:
 	void filterMap();
 	void fillPage();
-	void fillBackground(const QImage &image);
+	void fieldLoaded(Field *field);
 	void about();
 	int closeFiles(bool quit = false);
 	void setModified(bool modified = true);
@@ -100,11 +100,12 @@ private:
 	void buildGameLangMenu(const QStringList &langs);
 	QString savePath() const;
 	void fillRecentMenu();
+	void fillBackgroundPreview();
 
 	FieldArchive *fieldArchive;
 	Field *field;
 	Field *currentField;
-	FieldThread *fieldThread;//TODO
+	FieldLoader *fieldLoader;
 	MsdFile *msdFile;
 	JsmFile *jsmFile;
 	QString filePath;
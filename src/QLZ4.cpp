@@ -18,7 +18,7 @@
 #include "QLZ4.h"
 #include <lz4.h>
 
-QByteArray QLZ4::result;
+thread_local QByteArray QLZ4::result;
 
 const QByteArray &QLZ4::decompressAll(const char *data, int size, bool *ok)
 {
@@ -35,5 +35,5 @@ public:
 	}
 	static const QByteArray &compress(const char *data, int size);
 private:
-	static QByteArray result;
+	static thread_local QByteArray result;
 };
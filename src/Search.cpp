@@ -552,42 +552,30 @@ bool Search::findPrevScript()
 
 void Search::findAllScript()
 {
-	int fieldID = -1, groupID = 0, methodID = 0, opcodeID = 0;
-
-	QDeadlineTimer t(50);
+	FieldArchive::Sorting sort = sorting();
 
 	searchAllDialog->setScriptSearch();
-	while (findNextScript(fieldID, groupID, methodID, ++opcodeID)) {
-		if (t.hasExpired()) {
-			QCoreApplication::processEvents();
-			t.setRemainingTime(50);
-		}
-		// Cancelled
-		if (searchAllDialog->isHidden()) {
-			break;
-		}
-		searchAllDialog->addResultOpcode(fieldID, groupID, methodID, opcodeID);
+
+	// Results are streamed to the dialog, which cancels the search when hidden
+	if (typeScriptChoice->currentIndex() == 0) {
+		fieldArchive->findAllScriptText(regexp(), sort, searchAllDialog);
+	}
+	else if (typeScriptChoice->currentIndex() == 1) {
+		fieldArchive->findAllScript(JsmFile::SearchOpcode, searchOpcode->currentIndex() | (searchOpcodeValue->value() << 16), sort, searchAllDialog);
+	}
+	else if (typeScriptChoice->currentIndex() == 2) {
+		fieldArchive->findAllScript(JsmFile::SearchVar, (popScriptVar->isChecked() << 31) | (pushScriptVar->isChecked() << 30) | (selectScriptVar->currentIndex() & 0x3FFFFFFF), sort, searchAllDialog);
+	}
+	else if (typeScriptChoice->currentIndex() == 3) {
+		fieldArchive->findAllScript(JsmFile::SearchExec, (selectScriptGroup->value() & 0xFFFF) | ((selectScriptLabel->value() & 0xFFFF) << 16), sort, searchAllDialog);
+	}
+	else if (typeScriptChoice->currentIndex() == 4) {
+		fieldArchive->findAllScript(JsmFile::SearchMapJump, (selectScriptGroup->value() & 0xFFFF) | ((selectScriptLabel->value() & 0xFFFF) << 16), sort, searchAllDialog);
 	}
 }
 
 void Search::findAllText()
 {
-	FieldArchive::Sorting sort = sorting();
-	int fieldID = -1, textID = -1, from = -1;
-
-	QDeadlineTimer t(50);
-
 	searchAllDialog->setTextSearch();
-	int size;
-	while (fieldArchive->searchText(regexp(), fieldID, textID, ++from, size, sort)) {
-		if (t.hasExpired()) {
-			QCoreApplication::processEvents();
-			t.setRemainingTime(50);
-		}
-		// Cancelled
-		if (searchAllDialog->isHidden()) {
-			break;
-		}
-		searchAllDialog->addResultText(fieldID, textID, from, size);
-	}
+	fieldArchive->findAllText(regexp(), sorting(), searchAllDialog);
 }
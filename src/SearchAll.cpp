@@ -94,6 +94,40 @@ void SearchAll::addResultText(int mapID, int textID, int index, int size)
 	addResult(mapID, createItemText(mapID, textID, index, size));
 }
 
+bool SearchAll::observerWasCanceled() const
+{
+	return isHidden();
+}
+
+void SearchAll::setObserverCanCancel(bool canCancel) const
+{
+	Q_UNUSED(canCancel)
+}
+
+void SearchAll::setObserverMaximum(unsigned int max)
+{
+	Q_UNUSED(max)
+}
+
+void SearchAll::setObserverValue(int value)
+{
+	Q_UNUSED(value)
+}
+
+void SearchAll::addTextResults(const QList<FieldArchive::TextSearchResult> &results)
+{
+	for (const FieldArchive::TextSearchResult &result: results) {
+		addResultText(result.fieldID, result.textID, result.from, result.size);
+	}
+}
+
+void SearchAll::addScriptResults(const QList<FieldArchive::ScriptSearchResult> &results)
+{
+	for (const FieldArchive::ScriptSearchResult &result: results) {
+		addResultOpcode(result.fieldID, result.groupID, result.methodID, result.opcodeID);
+	}
+}
+
 void SearchAll::addResult(int mapID, QTreeWidgetItem *item)
 {
 	QTreeWidgetItem *itemToAdd = itemByMapID.value(mapID);
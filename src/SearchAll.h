@@ -18,10 +18,9 @@
 #pragma once
 
 #include <QtWidgets>
+#include "FieldArchive.h"
 
-class FieldArchive;
-
-class SearchAll : public QDialog
+class SearchAll : public QDialog, public FieldArchive::SearchObserver
 {
 	Q_OBJECT
 public:
@@ -30,6 +29,13 @@ public:
 	void setTextSearch();
 	void setFieldArchive(FieldArchive *fieldArchive);
 	void clear();
+	// FieldArchive::SearchObserver, the search is canceled by closing the dialog
+	bool observerWasCanceled() const override;
+	void setObserverCanCancel(bool canCancel) const override;
+	void setObserverMaximum(unsigned int max) override;
+	void setObserverValue(int value) override;
+	void addTextResults(const QList<FieldArchive::TextSearchResult> &results) override;
+	void addScriptResults(const QList<FieldArchive::ScriptSearchResult> &results) override;
 public slots:
 	void addResultOpcode(int mapID, int groupID, int methodID, int opcodeID);
 	void addResultText(int mapID, int textID, int index, int size);
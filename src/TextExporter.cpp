@@ -23,6 +23,7 @@
 #include "files/MsdFile.h"
 #include "Config.h"
 #include "FF8Text.h"
+#include "FF8Font.h"
 
 TextExporter::TextExporter(FieldArchive *archive) :
       _archive(archive)
@@ -37,6 +38,24 @@ bool TextExporter::toCsv(const QString &fileName, const QStringList &langs, QCha
 	
 	QList<Field *> fields = _archive->sortedByMapId();
 	
+	// Fonts are chosen per column, the config is not modified
+	FF8Font *currentFont = FF8Font::getCurrentConfigFont();
+	if (currentFont == nullptr) {
+		_lastErrorString = QObject::tr("No font available");
+		return false;
+	}
+	// Without a second font, every column uses the current one
+	QStringList fontL = FF8Font::fontList();
+	FF8Font *latinFont = !fontL.isEmpty() ? FF8Font::font(fontL.first()) : nullptr,
+	        *jpFont = fontL.size() > 1 ? FF8Font::font(fontL.at(1)) : nullptr;
+	QSharedPointer<const FF8TextCodec> currentCodec = currentFont->codec(),
+	        latinCodec = latinFont != nullptr ? latinFont->codec() : currentCodec,
+	        jpCodec = jpFont != nullptr ? jpFont->codec() : currentCodec;
+	QList<QSharedPointer<const FF8TextCodec> > codecs;
+	for (const QString &lang: langs) {
+		codecs.append(lang.compare("jp", Qt::CaseInsensitive) == 0 ? jpCodec : latinCodec);
+	}
+	
 	if (observer) {
 		observer->setObserverMaximum(quint32(_archive->nbFields()));
 	}
@@ -52,81 +71,159 @@ bool TextExporter::toCsv(const QString &fileName, const QStringList &langs, QCha
 	csv.writeLine(langs.empty() ? QStringList() << "Text" << "Comment" : QStringList() << langs << "Comment");
 	const QStringList &mapList = _archive->mapList();
 	
-	QVariant oldEncoding = Config::value("encoding");
+	const int jobs = QThread::idealThreadCount();
+	QThreadPool pool;
+	// Rows are written in the field order, at most 2 * jobs fields are waiting
+	QSemaphore inFlight(jobs * 2);
+	QMutex linesMutex;
+	QMap<int, QList<QStringList> > linesByField;
+	int fieldId = 0, writtenFieldId = 0, i = 0;
+	bool canceled = false;
 	
-	int i = 0;
+	pool.setMaxThreadCount(jobs);
+	
+	auto writeLines = [&]() {
+		QMutexLocker locker(&linesMutex);
+	
+		while (linesByField.contains(writtenFieldId)) {
+			for (const QStringList &line: linesByField.take(writtenFieldId)) {
+				csv.writeLine(line);
+			}
+			++writtenFieldId;
+			inFlight.release();
+		}
+	};
 	
 	for (Field *f: fields) {
 		if (observer) {
 			if (observer->observerWasCanceled()) {
-				return false;
+				canceled = true;
+				break;
 			}
 			observer->setObserverValue(i++);
 		}
 		
-		if (f && f->isOpen() && f->hasMsdFile()) {
-			QString fieldName = f->name();
-			if (fieldName.isEmpty()) {
-				continue;
-			}
-			qsizetype index = mapList.indexOf(fieldName);
-			if (index < 0) {
-				continue;
+		if (!f || !f->isOpen()) {
+			continue;
+		}
+		
+		QString fieldName = f->name();
+		if (fieldName.isEmpty()) {
+			continue;
+		}
+		qsizetype index = mapList.indexOf(fieldName);
+		if (index < 0) {
+			continue;
+		}
+		
+		while (!inFlight.tryAcquire(1, 50)) {
+			writeLines();
+			QCoreApplication::processEvents();
+			if (observer && observer->observerWasCanceled()) {
+				canceled = true;
+				break;
 			}
+		}
+		
+		if (canceled) {
+			break;
+		}
+		
+		pool.start([this, f, index, fieldId, &langs, &codecs, currentCodec, &linesMutex, &linesByField]() {
+			QList<QStringList> lines;
+			fieldToCsv(f, index, langs, codecs, currentCodec, lines);
+	
+			QMutexLocker locker(&linesMutex);
+			linesByField.insert(fieldId, lines);
+		});
+		++fieldId;
+		
+		writeLines();
+	}
+	
+	while (!pool.waitForDone(50)) {
+		writeLines();
+		QCoreApplication::processEvents();
+	}
+	
+	writeLines();
+	
+	// Lazy fields were loaded by the workers
+	_archive->addLoadedFields();
+	_archive->evictFields();
+	
+	if (!csv.flush()) {
+		_lastErrorString = io.errorString();
+		return false;
+	}
+	
+	return !canceled;
+}
+
+void TextExporter::fieldToCsv(Field *f, qsizetype mapId, const QStringList &langs,
+                              const QList<QSharedPointer<const FF8TextCodec> > &codecs,
+                              const QSharedPointer<const FF8TextCodec> &codec,
+                              QList<QStringList> &lines) const
+{
+	if (!f->hasMsdFile()) {
+		return;
+	}
+	
+	lines.append(QStringList() << QString("#%1").arg(f->name()) << QString::number(mapId));
+	
+	if (langs.size() > 1 && f->isPc()) {
+		FieldPC *field = (FieldPC *)f;
+		QList<QByteArray> msdList;
+		QList<QList<QByteArray>> textsByLang;
+		
+		// Every language is decoded from the same fs data, the field itself is not reopened
+		if (!field->readMsdLangs(langs, ((FieldArchivePC *)_archive)->getFsArchive(), msdList)) {
+			msdList.clear();
+		}
+		
+		for (int langId = 0; langId < langs.size(); ++langId) {
+			QList<QByteArray> texts;
 			
-			csv.writeLine(QStringList() << QString("#%1").arg(fieldName) << QString::number(index));
+			// The current language is read from memory, with its unsaved changes
+			if (field->isCurrentMsdLang(langs.at(langId))) {
+				texts = f->getMsdFile()->getTexts();
+			} else {
+				MsdFile msd2;
+				if (langId >= msdList.size() || !msd2.open(msdList.at(langId))) {
+					continue;
+				}
+				texts = msd2.getTexts();
+			}
 			
-			MsdFile *msd = f->getMsdFile();
-			if (msd != nullptr) {
-				QList<QList<QByteArray>> textsByLang;
-
-				if (langs.size() > 1 && f->isPc()) {
-					int langId = 0;
-					for (const QString &lang: langs) {
-						((FieldPC *)f)->changeGameLang(lang, ((FieldArchivePC *)_archive)->getFsArchive());
-						MsdFile *msd2 = f->getMsdFile();
-						if (msd2 != nullptr) {
-							const QList<QByteArray> &texts = msd2->getTexts();
-							int textId = 0;
-							for (const QByteArray &text: texts) {
-								if (textId >= textsByLang.size()) {
-									QList<QByteArray> textByLang(langs.size());
-									textByLang[langId] = text;
-									textsByLang.append(textByLang);
-								} else {
-									textsByLang[textId][langId] = text;
-								}
-								textId += 1;
-							}
-						}
-						langId += 1;
-					}
-					((FieldPC *)f)->changeGameLang(Config::value("gameLang", "en").toString(), ((FieldArchivePC *)_archive)->getFsArchive());
-					
-					for (const QList<QByteArray> &texts: textsByLang) {
-						QStringList line;
-						
-						langId = 0;
-						for (const QByteArray &text: texts) {
-							Config::setValue("encoding", langs.at(langId).compare("jp", Qt::CaseInsensitive) == 0 ? "01" : "00");
-							line << FF8Text(text);
-							langId += 1;
-						}
-						
-						csv.writeLine(line << "");
-					}
+			int textId = 0;
+			for (const QByteArray &text: texts) {
+				if (textId >= textsByLang.size()) {
+					QList<QByteArray> textByLang(langs.size());
+					textByLang[langId] = text;
+					textsByLang.append(textByLang);
 				} else {
-					for (const QByteArray &text: msd->getTexts()) {
-						csv.writeLine(QStringList() << FF8Text(text) << "");
-					}
+					textsByLang[textId][langId] = text;
 				}
+				textId += 1;
 			}
 		}
+		
+		for (const QList<QByteArray> &texts: textsByLang) {
+			QStringList line;
+			
+			int langId = 0;
+			for (const QByteArray &text: texts) {
+				line << FF8Text(text, codecs.at(langId));
+				langId += 1;
+			}
+			
+			lines.append(line << "");
+		}
+	} else {
+		for (const QByteArray &text: f->getMsdFile()->getTexts()) {
+			lines.append(QStringList() << FF8Text(text, codec) << "");
+		}
 	}
-	
-	Config::setValue("encoding", oldEncoding);
-	
-	return true;
 }
 
 bool TextExporter::fromCsv(const QString &fileName, quint8 column, QChar fieldSeparator, QChar quoteCharacter, CsvFile::CsvEncoding encoding, ArchiveObserver *observer)
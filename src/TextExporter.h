@@ -21,18 +21,25 @@
 #include "CsvFile.h"
 
 class FieldArchive;
+class Field;
+class FF8TextCodec;
 struct ArchiveObserver;
 
 class TextExporter
 {
 public:
 	explicit TextExporter(FieldArchive *archive);
+	// Fields are read and decoded by several threads, rows are written in the field order
 	bool toCsv(const QString &fileName, const QStringList &langs, QChar fieldSeparator, QChar quoteCharacter, CsvFile::CsvEncoding encoding, ArchiveObserver *observer = nullptr);
 	bool fromCsv(const QString &fileName, quint8 column, QChar fieldSeparator, QChar quoteCharacter, CsvFile::CsvEncoding encoding, ArchiveObserver *observer = nullptr);
 	inline const QString &errorString() const {
 		return _lastErrorString;
 	}
 private:
+	void fieldToCsv(Field *f, qsizetype mapId, const QStringList &langs,
+	                const QList<QSharedPointer<const FF8TextCodec> > &codecs,
+	                const QSharedPointer<const FF8TextCodec> &codec,
+	                QList<QStringList> &lines) const;
 	FieldArchive *_archive;
 	QString _lastErrorString;
 };
@@ -0,0 +1,235 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "TextLayout.h"
+#include "files/TdwFile.h"
+#include "Data.h"
+
+TextLayout::TextLayout(const TdwFile *font, const QList<QByteArray> &names, const QList<QByteArray> &locations) :
+	_font(font), _tdwFile(nullptr), _jp(font->tableCount() == 4)
+{
+	for (int i = 0; i < 14; ++i) {
+		_namesWidth[i] = textWidth(names.value(i));
+	}
+
+	for (int i = 0; i < 8; ++i) {
+		_locationsWidth[i] = textWidth(locations.value(i));
+	}
+}
+
+void TextLayout::setFieldFont(const TdwFile *tdwFile)
+{
+	_tdwFile = tdwFile != nullptr && tdwFile->tableCount() >= 1 ? tdwFile : nullptr;
+}
+
+int TextLayout::textWidth(const QByteArray &ff8Text) const
+{
+	int width = 0;
+
+	for (quint8 c: ff8Text) {
+		if (c>=32 && c<227)
+			width += _font->charWidth(0, c-32);
+	}
+
+	return width;
+}
+
+QList<QSize> TextLayout::pageSizes(const QByteArray &ff8Text, const FF8Window &window, QList<int> *pagesPos) const
+{
+	if (window.type == JsmOpcode::AASK) {
+		return pageSizes(ff8Text, window.ask_first, window.ask_last, pagesPos);
+	}
+
+	return pageSizes(ff8Text, -1, -1, pagesPos);
+}
+
+QList<QSize> TextLayout::pageSizes(const QByteArray &ff8Text, int askFirst, int askLast, QList<int> *pagesPos) const
+{
+	QList<QSize> pages;
+	int line=0, width, maxW=0, height=28, size=ff8Text.size();
+	const char *data = ff8Text.constData();
+	quint8 caract;
+
+	if (pagesPos) {
+		pagesPos->clear();
+		pagesPos->append(0);
+	}
+
+	// Argument of a control code, the end of the string is read as 0
+	auto next = [&](int &i) -> quint8 {
+		return ++i < size ? quint8(data[i]) : 0;
+	};
+
+	width = askFirst==0 && askLast>=0 ? 79 : 15;
+
+	for (int i = 0; i < size; ++i) {
+		caract = quint8(data[i]);
+		if (caract==0) break;
+		switch (caract) {
+		case 0x1: // New Page
+			if (width>maxW)	maxW = width;
+			pages.append(QSize(maxW, height));
+			maxW = 0;
+			width = 15;
+			height = 28;
+			if (pagesPos) {
+				pagesPos->append(i+1);
+			}
+			break;
+		case 0x2: // \n
+			if (width>maxW)	maxW = width;
+			++line;
+			width = (askFirst<=line && askLast>=line ? 79 : 15);//32+15+32 (padding for arrow) or 15
+			height += 16;
+			break;
+		case 0x3: // Character names
+			caract = next(i);
+			if (caract>=0x30 && caract<=0x3a)
+				width += _namesWidth[caract-0x30];
+			else if (caract==0x40)
+				width += _namesWidth[11];
+			else if (caract==0x50)
+				width += _namesWidth[12];
+			else if (caract==0x60)
+				width += _namesWidth[13];
+			break;
+		case 0x4: // Vars
+			caract = next(i);
+			if ((caract>=0x20 && caract<=0x27) || (caract>=0x30 && caract<=0x37))
+				width += _font->charWidth(0, 1);// 0
+			else if (caract>=0x40 && caract<=0x47)
+				width += _font->charWidth(0, 1)*8;// 00000000
+			break;
+		case 0x5: // Icons
+			caract = next(i)-0x20;
+			if (caract<96)
+				width += iconWidth[caract]+iconPadding[caract];
+			break;
+		case 0xe: // Locations
+			caract = next(i);
+			if (caract>=0x20 && caract<=0x27)
+				width += _locationsWidth[caract-0x20];
+			break;
+		case 0x19: // Jap 1
+		case 0x1a: // Jap 2
+		case 0x1b: // Jap 3
+			if (_jp) {
+				quint8 tableId = caract-0x18;
+				caract = next(i);
+				if (caract>=0x20)
+					width += _font->charWidth(tableId, caract-0x20);
+			}
+			break;
+		case 0x1c: // Jap 4
+			if (_tdwFile) {
+				caract = next(i);
+				if (caract>=0x20)
+					width += _tdwFile->charWidth(0, caract-0x20);
+			}
+			break;
+		default:
+			if (caract<0x20)
+				++i;
+			else if (_jp || caract<232)
+				width += _font->charWidth(0, caract-0x20);
+			else
+				width += _font->charWidth(0, quint8(optimisedDuo[caract-232][0])) + _font->charWidth(0, quint8(optimisedDuo[caract-232][1]));
+			break;
+		}
+	}
+
+	if (width>maxW)	maxW = width;
+	pages.append(QSize(maxW, height));
+
+	return pages;
+}
+
+bool TextLayout::fitsOnScreen(const QSize &pageSize)
+{
+	// See TextPreview::realPos()
+	return pageSize.width() <= 312 - 8 && pageSize.height() <= 223 - 8;
+}
+
+QStringList TextLayout::characterNames()
+{
+	return QStringList() << Data::name(0) << Data::name(1) << Data::name(2)
+	                     << Data::name(3) << Data::name(4) << Data::name(5)
+	                     << Data::name(6) << Data::name(7) << Data::name(8)
+	                     << Data::name(9) << Data::name(10) << Data::name(15)
+	                     << Data::name(12) << Data::name(14);
+}
+
+QStringList TextLayout::locationNames()
+{
+	return QStringList() << QCoreApplication::translate("TextPreview", "Galbadia")
+	                     << QCoreApplication::translate("TextPreview", "Esthar")
+	                     << QCoreApplication::translate("TextPreview", "Balamb")
+	                     << QCoreApplication::translate("TextPreview", "Dollet")
+	                     << QCoreApplication::translate("TextPreview", "Timber")
+	                     << QCoreApplication::translate("TextPreview", "Trabia")
+	                     << QCoreApplication::translate("TextPreview", "Centra")
+	                     << QCoreApplication::translate("TextPreview", "F. Horizon");
+}
+
+const quint8 TextLayout::iconWidth[96] =
+{
+	15, 15, 15, 15, 9, 9, 9, 9, 31, 0, 0, 31, 12, 12, 12, 12,
+	15, 15, 15, 15, 9, 9, 9, 9, 31, 0, 0, 31, 12, 12, 12, 12,
+	0, 8, 6, 11, 8, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 12, 12, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+	16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+	16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 24
+};
+
+const quint8 TextLayout::iconPadding[96] =
+{
+	2, 2, 2, 2, 8, 8, 8, 8, 2, 17, 17, 2, 3, 3, 3, 3,
+	2, 2, 2, 2, 8, 8, 8, 8, 2, 17, 17, 2, 3, 3, 3, 3,
+	9, 1, 3, 6, 9, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+const char *TextLayout::optimisedDuo[24] =
+{
+	"\x47\x4c",//in
+	"\x43\x00",//e
+	"\x4c\x43",//ne
+	"\x52\x4d",//to
+	"\x50\x43",//re
+	"\x2c\x34",//HP
+	"\x4a\x00",//l
+	"\x4a\x4a",//ll
+	"\x2b\x2a",//GF
+	"\x4c\x52",//nt
+	"\x47\x4a",//il
+	"\x4d\x00",//o
+	"\x43\x44",//ef
+	"\x4d\x4c",//on
+	"\x00\x55",// w
+	"\x00\x50",// r
+	"\x55\x47",//wi
+	"\x44\x47",//fi
+	"\x29\x27",//EC
+	"\x51\x00",//s
+	"\x3f\x50",//ar
+	"\x2a\x29",//FE
+	"\x00\x37",// S
+	"\x3f\x45" //ag
+};
+
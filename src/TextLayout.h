@@ -0,0 +1,56 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#pragma once
+
+#include <QtCore>
+#include "files/JsmFile.h"
+
+class TdwFile;
+
+/*
+ * Size of the text windows, computed like the game does from the
+ * width of every character in the fonts. Nothing is drawn and nothing is
+ * modified by the measures: a TextLayout can be shared between threads.
+ */
+class TextLayout
+{
+public:
+	// names and locations are the FF8 texts replacing the {Name} and {Location} codes
+	TextLayout(const TdwFile *font, const QList<QByteArray> &names, const QList<QByteArray> &locations);
+	// Additional font of the field, used by the 0x1c characters
+	void setFieldFont(const TdwFile *tdwFile);
+	// Size of every page, pagesPos receives the position of every page in ff8Text
+	QList<QSize> pageSizes(const QByteArray &ff8Text, int askFirst = -1, int askLast = -1,
+	                       QList<int> *pagesPos = nullptr) const;
+	QList<QSize> pageSizes(const QByteArray &ff8Text, const FF8Window &window,
+	                       QList<int> *pagesPos = nullptr) const;
+	int textWidth(const QByteArray &ff8Text) const;
+	// Windows are kept 8 pixels away from the edges of the screen
+	static bool fitsOnScreen(const QSize &pageSize);
+	static QStringList characterNames();
+	static QStringList locationNames();
+
+	static const quint8 iconWidth[96];
+	static const quint8 iconPadding[96];
+	static const char *optimisedDuo[24];
+private:
+	const TdwFile *_font, *_tdwFile;
+	bool _jp;
+	int _namesWidth[14];
+	int _locationsWidth[8];
+};
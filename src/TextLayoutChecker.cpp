@@ -0,0 +1,225 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "TextLayoutChecker.h"
+#include "FieldPC.h"
+#include "FieldArchivePC.h"
+#include "ArchiveObserver.h"
+#include "files/MsdFile.h"
+#include "FF8Font.h"
+
+TextLayoutChecker::TextLayoutChecker(FieldArchive *archive) :
+    _archive(archive), _textCount(0)
+{
+
+}
+
+TextLayout TextLayoutChecker::fontLayout(const FF8Font *font)
+{
+	QSharedPointer<const FF8TextCodec> codec = font->codec();
+	QList<QByteArray> names, locations;
+
+	for (const QString &name: TextLayout::characterNames()) {
+		names.append(codec->toFF8(name));
+	}
+
+	for (const QString &location: TextLayout::locationNames()) {
+		locations.append(codec->toFF8(location));
+	}
+
+	return TextLayout(font->tdw(), names, locations);
+}
+
+bool TextLayoutChecker::check(const QStringList &langs, ArchiveObserver *observer, int jobs)
+{
+	if (!_archive) {
+		return false;
+	}
+
+	jobs = qMax(1, jobs);
+	_overflows.clear();
+	_textCount = 0;
+
+	// Fonts are chosen per language, like in the text export
+	QStringList fontL = FF8Font::fontList();
+	FF8Font *currentFont = FF8Font::getCurrentConfigFont(),
+	        *latinFont = !fontL.isEmpty() ? FF8Font::font(fontL.first()) : nullptr,
+	        *jpFont = fontL.size() > 1 ? FF8Font::font(fontL.at(1)) : nullptr;
+
+	if (currentFont == nullptr || latinFont == nullptr || jpFont == nullptr) {
+		_lastErrorString = QObject::tr("The latin and the japanese fonts are required to measure the texts");
+		return false;
+	}
+
+	TextLayout latinLayout = fontLayout(latinFont),
+	        jpLayout = fontLayout(jpFont),
+	        currentLayout = fontLayout(currentFont);
+	QList<TextLayout> layouts;
+	for (const QString &lang: langs) {
+		layouts.append(lang.compare("jp", Qt::CaseInsensitive) == 0 ? jpLayout : latinLayout);
+	}
+
+	QList<Field *> fields = _archive->sortedByMapId();
+	// One slot per field, written by only one worker
+	QList<QList<Overflow> > overflowsByField(fields.size());
+	QList<int> textCountByField(fields.size(), 0);
+	QList<Overflow> *fieldOverflows = overflowsByField.data();
+	int *fieldTextCount = textCountByField.data();
+	QThreadPool pool;
+	QAtomicInt checkedCount = 0, canceled = 0;
+
+	pool.setMaxThreadCount(jobs);
+
+	if (observer) {
+		observer->setObserverMaximum(quint32(fields.size()));
+	}
+
+	auto wasCanceled = [&]() {
+		QCoreApplication::processEvents();
+
+		if (observer) {
+			if (observer->observerWasCanceled()) {
+				canceled.storeRelaxed(1);
+			}
+			observer->setObserverValue(checkedCount.loadRelaxed());
+		}
+
+		return canceled.loadRelaxed() != 0;
+	};
+
+	for (qsizetype i = 0; i < fields.size(); ++i) {
+		Field *f = fields.at(i);
+
+		if (!f || !f->isOpen()) {
+			checkedCount.fetchAndAddRelaxed(1);
+			continue;
+		}
+
+		pool.start([this, f, i, &langs, &layouts, &currentLayout, fieldOverflows, fieldTextCount, &checkedCount, &canceled]() {
+			if (!canceled.loadRelaxed()) {
+				checkField(f, langs, layouts, currentLayout, fieldOverflows[i], fieldTextCount[i]);
+			}
+			checkedCount.fetchAndAddRelaxed(1);
+		});
+	}
+
+	while (!pool.waitForDone(50)) {
+		wasCanceled();
+	}
+
+	// Lazy fields were loaded by the workers
+	_archive->addLoadedFields();
+	_archive->evictFields();
+
+	if (observer) {
+		observer->setObserverValue(checkedCount.loadRelaxed());
+	}
+
+	for (qsizetype i = 0; i < fields.size(); ++i) {
+		_overflows.append(overflowsByField.at(i));
+		_textCount += textCountByField.at(i);
+	}
+
+	return !canceled.loadRelaxed();
+}
+
+void TextLayoutChecker::checkField(Field *f, const QStringList &langs, const QList<TextLayout> &layouts,
+                                   const TextLayout &currentLayout, QList<Overflow> &overflows, int &textCount) const
+{
+	if (!f->hasMsdFile()) {
+		return;
+	}
+
+	// Windows are read from the script of the field, in the language of the archive
+	JsmFile *jsm = f->hasJsmFile() ? f->getJsmFile() : nullptr;
+	const TdwFile *tdwFile = f->hasTdwFile() ? f->getTdwFile() : nullptr;
+	Overflow overflow;
+	overflow.fieldName = f->name();
+
+	auto checkTexts = [&](const TextLayout &layout, const QList<QByteArray> &texts) {
+		int textId = 0;
+		for (const QByteArray &text: texts) {
+			overflow.textId = textId;
+			checkText(layout, text, jsm != nullptr && textId < 256 ? jsm->windows(quint8(textId)) : QList<FF8Window>(),
+			          overflow, overflows);
+			++textId;
+		}
+		textCount += int(texts.size());
+	};
+
+	if (langs.size() > 1 && f->isPc()) {
+		QList<QByteArray> msdList;
+
+		// Every language is decoded from the same fs data, the field itself is not reopened
+		if (!((FieldPC *)f)->readMsdLangs(langs, ((FieldArchivePC *)_archive)->getFsArchive(), msdList)) {
+			return;
+		}
+
+		for (int langId = 0; langId < msdList.size(); ++langId) {
+			MsdFile msd;
+			if (!msd.open(msdList.at(langId))) {
+				continue;
+			}
+			TextLayout layout = layouts.at(langId);
+			layout.setFieldFont(tdwFile);
+			overflow.lang = langs.at(langId);
+			checkTexts(layout, msd.getTexts());
+		}
+	} else {
+		TextLayout layout = currentLayout;
+		layout.setFieldFont(tdwFile);
+		checkTexts(layout, f->getMsdFile()->getTexts());
+	}
+}
+
+void TextLayoutChecker::checkText(const TextLayout &layout, const QByteArray &text, const QList<FF8Window> &windows,
+                                  Overflow &overflow, QList<Overflow> &overflows)
+{
+	auto checkPages = [&](const QList<QSize> &pages) {
+		int page = 0;
+		for (const QSize &size: pages) {
+			if (!TextLayout::fitsOnScreen(size)) {
+				overflow.page = page;
+				overflow.size = size;
+				overflows.append(overflow);
+			}
+			++page;
+		}
+	};
+
+	overflow.windowId = -1;
+
+	if (windows.isEmpty()) {
+		checkPages(layout.pageSizes(text));
+		return;
+	}
+
+	// Only the choice lines change the size of the window
+	QSet<QPair<int, int> > askLines;
+	int windowId = 0;
+	for (const FF8Window &window: windows) {
+		QPair<int, int> ask = window.type == JsmOpcode::AASK
+		        ? qMakePair(window.ask_first, window.ask_last)
+		        : qMakePair(-1, -1);
+		if (!askLines.contains(ask)) {
+			askLines.insert(ask);
+			overflow.windowId = windowId;
+			checkPages(layout.pageSizes(text, ask.first, ask.second));
+		}
+		++windowId;
+	}
+}
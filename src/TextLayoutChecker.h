@@ -0,0 +1,62 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#pragma once
+
+#include <QtCore>
+#include "FieldArchive.h"
+#include "TextLayout.h"
+
+class FF8Font;
+
+class TextLayoutChecker
+{
+public:
+	// Page of a text too big to be displayed entirely on screen
+	struct Overflow {
+		QString fieldName;
+		QString lang; // Empty for the texts of the field archive
+		int textId;
+		int windowId; // -1 when the text is not opened by a window
+		int page;
+		QSize size;
+	};
+
+	explicit TextLayoutChecker(FieldArchive *archive);
+	// Fields are measured by several threads, overflows are sorted by map id
+	bool check(const QStringList &langs, ArchiveObserver *observer = nullptr,
+	           int jobs = QThread::idealThreadCount());
+	inline const QList<Overflow> &overflows() const {
+		return _overflows;
+	}
+	inline int textCount() const {
+		return _textCount;
+	}
+	inline const QString &errorString() const {
+		return _lastErrorString;
+	}
+private:
+	static TextLayout fontLayout(const FF8Font *font);
+	void checkField(Field *f, const QStringList &langs, const QList<TextLayout> &layouts,
+	                const TextLayout &currentLayout, QList<Overflow> &overflows, int &textCount) const;
+	static void checkText(const TextLayout &layout, const QByteArray &text, const QList<FF8Window> &windows,
+	                      Overflow &overflow, QList<Overflow> &overflows);
+	FieldArchive *_archive;
+	QList<Overflow> _overflows;
+	int _textCount;
+	QString _lastErrorString;
+};
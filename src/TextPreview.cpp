@@ -17,17 +17,19 @@
  ****************************************************************************/
 #include "TextPreview.h"
 #include "FF8Text.h"
-#include "Data.h"
 #include "Config.h"
 #include "FF8Font.h"
+#include "TextLayout.h"
 
 bool TextPreview::curFrame = true;
+int TextPreview::fontGeneration = 0;
 QImage TextPreview::iconImage;
 TdwFile *TextPreview::font;
 TdwFile *TextPreview::tdwFile = nullptr;
 
 TextPreview::TextPreview(QWidget *parent)
-	: QWidget(parent), currentPage(0), currentWin(0), useTimer(false), acceptMove(false), fontColor(TdwFile::White)
+	: QWidget(parent), currentPage(0), currentWin(0), useTimer(false), acceptMove(false), fontColor(TdwFile::White),
+	  blinkingGlyphs(false), layoutStart(0), layoutAskFirst(-1), layoutAskLast(-1), layoutFontGeneration(-1)
 {
 	pagesPos.append(0);
 
@@ -38,42 +40,12 @@ TextPreview::TextPreview(QWidget *parent)
 		reloadFont();
 
 		bool jp = tr("false", "Use Japanese Encoding") == "true";
-		names << FF8Text::toFF8(Data::name(0), jp) << FF8Text::toFF8(Data::name(1), jp)
-				<< FF8Text::toFF8(Data::name(2), jp) << FF8Text::toFF8(Data::name(3), jp)
-				<< FF8Text::toFF8(Data::name(4), jp) << FF8Text::toFF8(Data::name(5), jp)
-				<< FF8Text::toFF8(Data::name(6), jp) << FF8Text::toFF8(Data::name(7), jp)
-				<< FF8Text::toFF8(Data::name(8), jp) << FF8Text::toFF8(Data::name(9), jp)
-				<< FF8Text::toFF8(Data::name(10), jp) << FF8Text::toFF8(Data::name(15), jp)
-				<< FF8Text::toFF8(Data::name(12), jp) << FF8Text::toFF8(Data::name(14), jp);
-
-		namesWidth[0] = calcFF8TextWidth(names.at(0));
-		namesWidth[1] = calcFF8TextWidth(names.at(1));
-		namesWidth[2] = calcFF8TextWidth(names.at(2));
-		namesWidth[3] = calcFF8TextWidth(names.at(3));
-		namesWidth[4] = calcFF8TextWidth(names.at(4));
-		namesWidth[5] = calcFF8TextWidth(names.at(5));
-		namesWidth[6] = calcFF8TextWidth(names.at(6));
-		namesWidth[7] = calcFF8TextWidth(names.at(7));
-		namesWidth[8] = calcFF8TextWidth(names.at(8));
-		namesWidth[9] = calcFF8TextWidth(names.at(9));
-		namesWidth[10] = calcFF8TextWidth(names.at(10));
-		namesWidth[11] = calcFF8TextWidth(names.at(11));
-		namesWidth[12] = calcFF8TextWidth(names.at(12));
-		namesWidth[13] = calcFF8TextWidth(names.at(13));
-
-		locations << FF8Text::toFF8(tr("Galbadia"), jp) << FF8Text::toFF8(tr("Esthar"), jp)
-				<< FF8Text::toFF8(tr("Balamb"), jp) << FF8Text::toFF8(tr("Dollet"), jp)
-				<< FF8Text::toFF8(tr("Timber"), jp) << FF8Text::toFF8(tr("Trabia"), jp)
-				<< FF8Text::toFF8(tr("Centra"), jp) << FF8Text::toFF8(tr("F. Horizon"), jp);
-
-		locationsWidth[0] = calcFF8TextWidth(locations.at(0));
-		locationsWidth[1] = calcFF8TextWidth(locations.at(1));
-		locationsWidth[2] = calcFF8TextWidth(locations.at(2));
-		locationsWidth[3] = calcFF8TextWidth(locations.at(3));
-		locationsWidth[4] = calcFF8TextWidth(locations.at(4));
-		locationsWidth[5] = calcFF8TextWidth(locations.at(5));
-		locationsWidth[6] = calcFF8TextWidth(locations.at(6));
-		locationsWidth[7] = calcFF8TextWidth(locations.at(7));
+		for (const QString &name: TextLayout::characterNames()) {
+			names.append(FF8Text::toFF8(name, jp));
+		}
+		for (const QString &location: TextLayout::locationNames()) {
+			locations.append(FF8Text::toFF8(location, jp));
+		}
 	}
 
 	startTimer(500);
@@ -81,26 +53,14 @@ TextPreview::TextPreview(QWidget *parent)
 
 void TextPreview::setFontImageAdd(TdwFile *tdwFile)
 {
-	if (tdwFile == nullptr || tdwFile->tableCount() < 1)	return;
-
-	TextPreview::tdwFile = tdwFile;
+	// The previous font can be deleted with its field, it is never kept
+	TextPreview::tdwFile = tdwFile != nullptr && tdwFile->tableCount() >= 1 ? tdwFile : nullptr;
+	++fontGeneration;
 }
 
 QImage TextPreview::getIconImage(int charId)
 {
-	return iconImage.copy((charId%16)*31, (charId/16)*12, iconWidth[charId], 12);
-}
-
-int TextPreview::calcFF8TextWidth(const QByteArray &ff8Text)
-{
-	int width = 0;
-
-    for (quint8 c: ff8Text) {
-		if (c>=32 && c<227)
-			width += font->charWidth(0, c-32);
-	}
-
-	return width;
+	return iconImage.copy((charId%16)*31, (charId/16)*12, TextLayout::iconWidth[charId], 12);
 }
 
 void TextPreview::clear()
@@ -108,6 +68,9 @@ void TextPreview::clear()
 	ff8Text.clear();
 	ff8Windows.clear();
 	maxW=maxH=0;
+	// Fonts of the last layout are not read anymore, the next paint lays out again
+	layoutFonts.clear();
+	layoutFontGeneration = -1;
 }
 
 void TextPreview::reloadFont()
@@ -118,6 +81,7 @@ void TextPreview::reloadFont()
 	} else {
 		font = ff8Font->tdw();
 	}
+	++fontGeneration;
 }
 
 void TextPreview::setWins(const QList<FF8Window> &windows, bool update)
@@ -221,113 +185,17 @@ void TextPreview::prevPage()
 
 void TextPreview::calcSize()
 {
-	int line=0, ask_first=-1, ask_last=-1, width, height=28, size=this->ff8Text.size();
-	maxW=maxH=0;
-	pagesPos.clear();
-	pagesPos.append(0);
-	quint8 caract;
-	bool jp = font->tableCount() == 4;
-	if (!ff8Windows.isEmpty()) {
-		const FF8Window &ff8Window = ff8Windows.at(currentWin);
-
-		if (ff8Window.type == JsmOpcode::AASK) {
-			ask_first = ff8Window.ask_first;
-			ask_last = ff8Window.ask_last;
-		}
-	}
-
-	width = ask_first==0 && ask_last>=0 ? 79 : 15;
+	TextLayout layout(font, names, locations);
+	layout.setFieldFont(tdwFile);
+	QList<QSize> pages = ff8Windows.isEmpty()
+	        ? layout.pageSizes(ff8Text, -1, -1, &pagesPos)
+	        : layout.pageSizes(ff8Text, ff8Windows.at(currentWin), &pagesPos);
 
-	for (int i = 0; i < size; ++i) {
-		caract = (quint8)ff8Text.at(i);
-		if (caract==0) break;
-		switch (caract) {
-		case 0x1: // New Page
-			if (height>maxH)	maxH = height;
-			if (width>maxW)	maxW = width;
-			width = 15;
-			height = 28;
-			pagesPos.append(i+1);
-			break;
-		case 0x2: // \n
-			if (width>maxW)	maxW = width;
-			++line;
-			width = (ask_first<=line && ask_last>=line ? 79 : 15);//32+15+32 (padding for arrow) or 15
-			height += 16;
-			break;
-		case 0x3: // Character names
-			caract = (quint8)ff8Text.at(++i);
-			if (caract>=0x30 && caract<=0x3a)
-				width += namesWidth[caract-0x30];
-			else if (caract==0x40)
-				width += namesWidth[11];
-			else if (caract==0x50)
-				width += namesWidth[12];
-			else if (caract==0x60)
-				width += namesWidth[13];
-			break;
-		case 0x4: // Vars
-			caract = (quint8)ff8Text.at(++i);
-			if ((caract>=0x20 && caract<=0x27) || (caract>=0x30 && caract<=0x37))
-				width += font->charWidth(0, 1);// 0
-			else if (caract>=0x40 && caract<=0x47)
-				width += font->charWidth(0, 1)*8;// 00000000
-			break;
-		case 0x5: // Icons
-			caract = (quint8)ff8Text.at(++i)-0x20;
-            if (caract<96)
-				width += iconWidth[caract]+iconPadding[caract];
-			break;
-		case 0xe: // Locations
-			caract = (quint8)ff8Text.at(++i);
-			if (caract>=0x20 && caract<=0x27)
-				width += locationsWidth[caract-0x20];
-			break;
-		case 0x19: // Jap 1
-			if (jp) {
-				caract = (quint8)ff8Text.at(++i);
-				if (caract>=0x20)
-					width += font->charWidth(1, caract-0x20);
-			}
-			break;
-		case 0x1a: // Jap 2
-			if (jp) {
-				caract = (quint8)ff8Text.at(++i);
-				if (caract>=0x20)
-					width += font->charWidth(2, caract-0x20);
-			}
-			break;
-		case 0x1b: // Jap 3
-			if (jp) {
-				caract = (quint8)ff8Text.at(++i);
-				if (caract>=0x20)
-					width += font->charWidth(3, caract-0x20);
-			}
-			break;
-		case 0x1c: // Jap 4
-			if (tdwFile) {
-				caract = (quint8)ff8Text.at(++i);
-				if (caract>=0x20)
-					width += tdwFile->charWidth(0, caract-0x20);
-			}
-			break;
-		default:
-			if (caract<0x20)
-				++i;
-			else if (jp) {
-				width += font->charWidth(0, caract-0x20);
-			} else {
-				if (caract<232)
-					width += font->charWidth(0, caract-0x20);
-				else if (caract>=232)
-					width += font->charWidth(0, (quint8)optimisedDuo[caract-232][0]) + font->charWidth(0, (quint8)optimisedDuo[caract-232][1]);
-			}
-			break;
-		}
+	maxW=maxH=0;
+	for (const QSize &page: pages) {
+		if (page.height()>maxH)	maxH = page.height();
+		if (page.width()>maxW)	maxW = page.width();
 	}
-
-	if (height>maxH)	maxH = height;
-	if (width>maxW)	maxW = width;
 	if (maxW>322)	maxW = 322;
 	if (maxH>226)	maxH = 226;
 
@@ -363,7 +231,6 @@ void TextPreview::drawTextArea(QPainter *painter)
 
 	if (ff8Text.isEmpty())	return;
 
-	bool jp = font->tableCount() == 4;
 	FF8Window ff8Window = getWindow();
 
 	/* Window Background */
@@ -407,10 +274,58 @@ void TextPreview::drawTextArea(QPainter *painter)
 
 	/* Text */
 
+	int start = pagesPos.value(currentPage, 0);
+
+	if (isLayoutOutdated(start, ask_first, ask_last)) {
+		layoutText(start, ask_first, ask_last);
+	}
+
+	useTimer = blinkingGlyphs;
+
+	drawGlyphs(painter);
+}
+
+bool TextPreview::isLayoutOutdated(int start, int askFirst, int askLast) const
+{
+	if (layoutFontGeneration != fontGeneration || layoutStart != start
+	        || layoutAskFirst != askFirst || layoutAskLast != askLast
+	        || layoutFF8Text != ff8Text) {
+		return true;
+	}
+
+	for (const QPair<TdwFile *, quint32> &layoutFont: layoutFonts) {
+		if (layoutFont.first->glyphRevision() != layoutFont.second) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void TextPreview::layoutText(int start, int ask_first, int ask_last)
+{
+	bool jp = font->tableCount() == 4;
+	bool tagInJp = tr("false", "Use Japanese Encoding") == "true";
+	TdwFile *namesFont = FF8Font::font(tagInJp ? "01" : "00")->tdw();
+
+	glyphs.clear();
+	icons.clear();
+	blinkingGlyphs = false;
+	layoutFF8Text = ff8Text;
+	layoutStart = start;
+	layoutAskFirst = ask_first;
+	layoutAskLast = ask_last;
+	layoutFontGeneration = fontGeneration;
+	layoutFonts.clear();
+	layoutFonts.append(qMakePair(font, font->glyphRevision()));
+	layoutFonts.append(qMakePair(namesFont, namesFont->glyphRevision()));
+	// The field font is read only by the texts using it
+	bool fieldFontUsed = false;
+
 	fontColor = TdwFile::White;
 
 	int charId, line=0, x = (ask_first==0 && ask_last>=0 ? 40 : 8), y = 8;
-	int start = pagesPos.value(currentPage, 0), size = ff8Text.size();
+	int size = ff8Text.size();
 
 	for (int i=start ; i<size ; ++i)
 	{
@@ -419,13 +334,13 @@ void TextPreview::drawTextArea(QPainter *painter)
 		if (charId>=32)
 		{
 			if (jp) {
-				letter(&x, &y, charId-32, painter);// 210-32
+				letter(&x, &y, charId-32);// 210-32
 			} else {
 				if (charId<227) {
-					letter(&x, &y, charId-32, painter);
+					letter(&x, &y, charId-32);
 				} else if (charId>=232) {
-					letter(&x, &y, optimisedDuo[charId-232][0], painter);
-					letter(&x, &y, optimisedDuo[charId-232][1], painter);
+					letter(&x, &y, TextLayout::optimisedDuo[charId-232][0]);
+					letter(&x, &y, TextLayout::optimisedDuo[charId-232][1]);
 				}
 			}
 		}
@@ -446,29 +361,29 @@ void TextPreview::drawTextArea(QPainter *painter)
 				charId = (quint8)ff8Text.at(i);
 
 				if (charId>=0x30 && charId<=0x3a)
-					word(&x, &y, names.at(charId-0x30), painter, 5);
+					word(&x, &y, names.at(charId-0x30), 5);
 				else if (charId==0x40)
-					word(&x, &y, names.at(11), painter, 5);
+					word(&x, &y, names.at(11), 5);
 				else if (charId==0x50)
-					word(&x, &y, names.at(12), painter, 5);
+					word(&x, &y, names.at(12), 5);
 				else if (charId==0x60)
-					word(&x, &y, names.at(13), painter, 5);
+					word(&x, &y, names.at(13), 5);
 				break;
 			case 0x04:// Var
 				charId = (quint8)ff8Text.at(i);
 
 				if ((charId>=0x20 && charId<=0x27) || (charId>=0x30 && charId<=0x37))
-					word(&x, &y, FF8Text::toFF8("0", false), painter);
+					word(&x, &y, FF8Text::toFF8("0", false));
 				else if (charId>=0x40 && charId<=0x47)
-					word(&x, &y, FF8Text::toFF8("00000000", false), painter);
+					word(&x, &y, FF8Text::toFF8("00000000", false));
 				break;
 			case 0x05: // Icons
 				charId = (quint8)ff8Text.at(i)-0x20;
 
 				if (charId>=0 && charId<96)
 				{
-					painter->drawImage(x, y, getIconImage(charId));
-					x += iconWidth[charId] + iconPadding[charId];
+					icons.append(Icon{charId, QPoint(x, y)});
+					x += TextLayout::iconWidth[charId] + TextLayout::iconPadding[charId];
 				}
 				break;
 			case 0x06: // Colors
@@ -478,33 +393,37 @@ void TextPreview::drawTextArea(QPainter *painter)
 					fontColor = (TdwFile::Color)(charId-0x20);
 				else if (charId>=0x28 && charId<=0x2f)// BlinkColors
 				{
-					useTimer = true;
+					blinkingGlyphs = true;
 					fontColor = (TdwFile::Color)(charId-0x20);
 				}
 				break;
 			case 0x0e: // Locations
 				charId = (quint8)ff8Text.at(i);
 				if (charId>=0x20 && charId<=0x27)
-					word(&x, &y, locations.at(charId-0x20), painter, 5);
+					word(&x, &y, locations.at(charId-0x20), 5);
 				break;
 			case 0x19: // Jap 1
 				if (jp) {
-					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, painter, 1);
+					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, 1);
 				}
 				break;
 			case 0x1a: // Jap 2
 				if (jp) {
-					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, painter, 2);
+					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, 2);
 				}
 				break;
 			case 0x1b: // Jap 3
 				if (jp) {
-					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, painter, 3);
+					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, 3);
 				}
 				break;
 			case 0x1c: // Jap 4
 				if (jp) {
-					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, painter, 4);
+					if (tdwFile && !fieldFontUsed) {
+						layoutFonts.append(qMakePair(tdwFile, tdwFile->glyphRevision()));
+						fieldFontUsed = true;
+					}
+					letter(&x, &y, (quint8)ff8Text.at(i)-0x20, 4);
 				}
 				break;
 			}
@@ -512,6 +431,49 @@ void TextPreview::drawTextArea(QPainter *painter)
 	}
 }
 
+void TextPreview::drawGlyphs(QPainter *painter)
+{
+	// Consecutive letters with the same atlas are drawn at once
+	QList<QPainter::PixmapFragment> fragments;
+	QPixmap atlasPixmap;
+	qint64 atlasKey = -1;
+
+	for (const Glyph &glyph: glyphs) {
+		const QImage &atlas = glyph.font->letterAtlas(glyph.charId, glyph.color, curFrame);
+		QRect rect = glyph.font->letterRect(glyph.charId);
+
+		if (!atlas.rect().contains(rect)) {
+			continue;
+		}
+
+		if (atlas.cacheKey() != atlasKey) {
+			if (!fragments.isEmpty()) {
+				painter->drawPixmapFragments(fragments.constData(), int(fragments.size()), atlasPixmap);
+				fragments.clear();
+			}
+
+			atlasKey = atlas.cacheKey();
+			QString key = QString("tdwAtlas%1").arg(atlasKey);
+
+			if (!QPixmapCache::find(key, &atlasPixmap)) {
+				atlasPixmap = QPixmap::fromImage(atlas);
+				QPixmapCache::insert(key, atlasPixmap);
+			}
+		}
+
+		fragments.append(QPainter::PixmapFragment::create(
+		    QPointF(glyph.pos) + QPointF(rect.width() / 2.0, rect.height() / 2.0), QRectF(rect)));
+	}
+
+	if (!fragments.isEmpty()) {
+		painter->drawPixmapFragments(fragments.constData(), int(fragments.size()), atlasPixmap);
+	}
+
+	for (const Icon &icon: icons) {
+		painter->drawImage(icon.pos, iconImage, QRect((icon.charId%16)*31, (icon.charId/16)*12, TextLayout::iconWidth[icon.charId], 12));
+	}
+}
+
 void TextPreview::paintEvent(QPaintEvent *event)
 {
 	Q_UNUSED(event)
@@ -620,97 +582,40 @@ void TextPreview::mouseReleaseEvent(QMouseEvent *)
 	}
 }
 
-void TextPreview::letter(int *x, int *y, int charId, QPainter *painter, quint8 tableId)
+void TextPreview::letter(int *x, int *y, int charId, quint8 tableId)
 {
-	QImage image;
+	TdwFile *tdw;
+	int absoluteCharId = charId;
 
 	if (tableId >= 5) {
 		bool tagInJp = tr("false", "Use Japanese Encoding") == "true";
-		image = FF8Font::font(tagInJp ? "01" : "00")->tdw()->letter(charId, fontColor, curFrame);
+		tdw = FF8Font::font(tagInJp ? "01" : "00")->tdw();
 	} else if (tableId == 4) {
-		if (tdwFile) {
-			image = tdwFile->letter(0, charId, fontColor, curFrame);
-		}
+		tdw = tdwFile;
 	} else {
-		image = font->letter(tableId, charId, fontColor, curFrame);
+		tdw = font;
+		absoluteCharId = tableId * 224 + charId;
 	}
 
-	if (!image.isNull()) {
-		painter->drawImage(*x, *y, image);
+	if (!tdw) {
+		return;
 	}
 
-	if (tableId >= 5) {
-		bool tagInJp = tr("false", "Use Japanese Encoding") == "true";
-		*x += FF8Font::font(tagInJp ? "01" : "00")->tdw()->charWidth(0, charId);
-	} else if (tableId == 4) {
-		if (tdwFile) {
-			*x += tdwFile->charWidth(0, charId);
-		}
-	} else {
-		*x += font->charWidth(tableId, charId);
+	if (charId >= 0) {
+		glyphs.append(Glyph{tdw, absoluteCharId, fontColor, QPoint(*x, *y)});
 	}
+
+	*x += tdw->charWidth(tableId < 4 ? tableId : 0, charId);
 }
 
-void TextPreview::word(int *x, int *y, const QByteArray &charIds, QPainter *painter, quint8 tableId)
+void TextPreview::word(int *x, int *y, const QByteArray &charIds, quint8 tableId)
 {
 	for (char charId: charIds) {
 		if (charId<0x20)	return;
-		letter(x, y, charId-0x20, painter, tableId);
-	}
-}
-
-const quint8 TextPreview::iconWidth[96] =
-{
-	15, 15, 15, 15, 9, 9, 9, 9, 31, 0, 0, 31, 12, 12, 12, 12,
-	15, 15, 15, 15, 9, 9, 9, 9, 31, 0, 0, 31, 12, 12, 12, 12,
-	0, 8, 6, 11, 8, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
-	12, 12, 12, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
-	16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
-	16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 24
-};
-
-const quint8 TextPreview::iconPadding[96] =
-{
-	2, 2, 2, 2, 8, 8, 8, 8, 2, 17, 17, 2, 3, 3, 3, 3,
-	2, 2, 2, 2, 8, 8, 8, 8, 2, 17, 17, 2, 3, 3, 3, 3,
-	9, 1, 3, 6, 9, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
-	5, 5, 5, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
-};
-
-const char *TextPreview::optimisedDuo[24] =
-{
-	"\x47\x4c",//in
-	"\x43\x00",//e
-	"\x4c\x43",//ne
-	"\x52\x4d",//to
-	"\x50\x43",//re
-	"\x2c\x34",//HP
-	"\x4a\x00",//l
-	"\x4a\x4a",//ll
-	"\x2b\x2a",//GF
-	"\x4c\x52",//nt
-	"\x47\x4a",//il
-	"\x4d\x00",//o
-	"\x43\x44",//ef
-	"\x4d\x4c",//on
-	"\x00\x55",// w
-	"\x00\x50",// r
-	"\x55\x47",//wi
-	"\x44\x47",//fi
-	"\x29\x27",//EC
-	"\x51\x00",//s
-	"\x3f\x50",//ar
-	"\x2a\x29",//FE
-	"\x00\x37",// S
-	"\x3f\x45" //ag
-};
+		letter(x, y, charId-0x20, tableId);
+	}
+}
 
 QList<QByteArray> TextPreview::names;
 
-int TextPreview::namesWidth[14];
-
 QList<QByteArray> TextPreview::locations;
-
-int TextPreview::locationsWidth[8];
@@ -53,10 +53,24 @@ public:
 signals:
 	void positionChanged(const QPoint &);
 private:
+	// Letter of a text page, drawn from the letter atlas of its font
+	struct Glyph {
+		TdwFile *font;
+		int charId; // Absolute charId
+		TdwFile::Color color;
+		QPoint pos;
+	};
+	struct Icon {
+		int charId;
+		QPoint pos;
+	};
 	void drawTextArea(QPainter *painter);
+	bool isLayoutOutdated(int start, int askFirst, int askLast) const;
+	void layoutText(int start, int askFirst, int askLast);
+	void drawGlyphs(QPainter *painter);
 	QPoint realPos(const FF8Window &ff8Window);
-	void letter(int *x, int *y, int charId, QPainter *painter, quint8 tableId=0);
-	void word(int *x, int *y, const QByteArray &charIds, QPainter *painter, quint8 tableId=0);
+	void letter(int *x, int *y, int charId, quint8 tableId=0);
+	void word(int *x, int *y, const QByteArray &charIds, quint8 tableId=0);
 
 	QList<FF8Window> ff8Windows;
 	QByteArray ff8Text;
@@ -68,19 +82,21 @@ private:
 	bool useTimer, acceptMove, readOnly;
 	QPointF moveStartPosition;
 	TdwFile::Color fontColor;
+	// Layout of the current page, computed again when the text, the page or a font change
+	QList<Glyph> glyphs;
+	QList<Icon> icons;
+	bool blinkingGlyphs;
+	QByteArray layoutFF8Text;
+	int layoutStart, layoutAskFirst, layoutAskLast, layoutFontGeneration;
+	QList<QPair<TdwFile *, quint32> > layoutFonts;
+	static int fontGeneration;
 
 	static TdwFile *font;
 	static TdwFile *tdwFile;
 	static QImage iconImage;
 
-	static int calcFF8TextWidth(const QByteArray &ff8Text);
-	static const quint8 iconWidth[96];
-	static const quint8 iconPadding[96];
-	static const char *optimisedDuo[24];
 	static QList<QByteArray> names;
-	static int namesWidth[14];
 	static QList<QByteArray> locations;
-	static int locationsWidth[8];
 protected:
 	void paintEvent(QPaintEvent *event) override;
 	void timerEvent(QTimerEvent *event) override;
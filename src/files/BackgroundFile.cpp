@@ -19,8 +19,6 @@
 #include "FF8Color.h"
 #include "FF8Image.h"
 
-QByteArray BackgroundFile::mim = QByteArray();
-
 Tile Tile::fromTile1(const Tile1 &tileType1, int sizeOfTile)
 {
 	Tile tile;
@@ -117,14 +115,16 @@ Tile2 Tile::toTile2(const Tile &tile)
 }
 
 BackgroundFile::BackgroundFile() :
-    File(), opened(false), _mapType(TypeNew), _visibleTile(-1)
+    File(), opened(false), _mapType(TypeNew), _visibleTile(-1),
+    _cacheVisibleTile(-1)
 {
 }
 
 bool BackgroundFile::open(const QByteArray &map, const QByteArray &mim,
                           const QMultiMap<quint8, quint8> *defaultParams)
 {
-	this->mim = mim;
+	_mim = mim;
+	invalidateCache();
 
 	if (!opened) {
 		allparams.clear();
@@ -225,7 +225,7 @@ bool BackgroundFile::openParameters()
 
 QImage BackgroundFile::background(bool hideBG) const
 {
-	int mimSize = mim.size(), palOffset = 4096, srcYWidth = 1664;
+	int mimSize = _mim.size(), palOffset = 4096, srcYWidth = 1664;
 
 	if (mimSize == 401408) {
 		palOffset = 0;
@@ -237,7 +237,9 @@ QImage BackgroundFile::background(bool hideBG) const
 		return FF8Image::errorImage();
 	}
 
-	return toImage(palOffset, srcYWidth, _tilesZOrder, _bounds, hideBG);
+	QMutexLocker locker(&_cacheMutex);
+
+	return toImage(palOffset, srcYWidth, hideBG);
 }
 
 QImage BackgroundFile::background(const QList<quint8> &activeParams, bool hideBG)
@@ -319,6 +321,7 @@ void BackgroundFile::setTiles(const QList<Tile> &tiles)
 	_tiles = tiles;
 	setModified(true);
 	openParameters();
+	invalidateCache();
 }
 
 const Tile &BackgroundFile::tile(quint16 index) const
@@ -328,9 +331,17 @@ const Tile &BackgroundFile::tile(quint16 index) const
 
 void BackgroundFile::setTile(quint16 index, const Tile &tile)
 {
+	const Tile old = _tiles.at(index);
 	_tiles.replace(index, tile);
 	setModified(true);
-	openParameters();
+	invalidateTile(old);
+	invalidateTile(tile);
+
+	// The texture fields do not change the parameters, the bounds or the depth order
+	if (old.X != tile.X || old.Y != tile.Y || old.Z != tile.Z || old.layerID != tile.layerID
+	        || old.parameter != tile.parameter || old.state != tile.state) {
+		openParameters();
+	}
 }
 
 void BackgroundFile::setVisibleTile(int index)
@@ -338,177 +349,268 @@ void BackgroundFile::setVisibleTile(int index)
 	_visibleTile = index;
 }
 
-QImage BackgroundFile::toImage(int palOffset, int srcYWidth,
-                               const QMultiMap<quint16, int> &tiles,
-                               const BackgroundBounds &bounds, bool hideBG) const
+QRect BackgroundFile::tileRect(const Tile &tile) const
+{
+	return QRect(_bounds.left + tile.X, _bounds.top + tile.Y, 16, 16);
+}
+
+void BackgroundFile::invalidateTile(const Tile &tile)
+{
+	QMutexLocker locker(&_cacheMutex);
+	_cacheDirtyRects.append(tileRect(tile));
+}
+
+void BackgroundFile::invalidateCache()
+{
+	QMutexLocker locker(&_cacheMutex);
+	_cache = QImage();
+	_cacheDirtyRects.clear();
+	_palettes.clear();
+}
+
+void BackgroundFile::releaseMim()
 {
-	int width = bounds.left + bounds.right + 16,
-	        height = bounds.top + bounds.bottom + 16;
-	const char *constMimData = mim.constData();
-	QImage image(width, height, QImage::Format_RGB32);
-	QRgb *pixels = (QRgb *)image.bits();
-	image.fill(0xFF000000);
-
-	for (int tileIndex: tiles) {
+	_mim = QByteArray();
+	invalidateCache();
+}
+
+QImage BackgroundFile::toImage(int palOffset, int srcYWidth, bool hideBG) const
+{
+	int width = _bounds.left + _bounds.right + 16,
+	        height = _bounds.top + _bounds.bottom + 16,
+	        visibleTile = _visibleTile < _tiles.size() ? _visibleTile : -1;
+	QList<bool> visibleTiles(_tiles.size());
+	QList<QRect> dirtyRects = std::move(_cacheDirtyRects);
+	_cacheDirtyRects.clear();
+
+	for (int tileIndex = 0; tileIndex < _tiles.size(); ++tileIndex) {
 		const Tile &tile = _tiles.at(tileIndex);
 
-		if (((hideBG || tile.parameter != 255) &&
-		    !params.contains(tile.parameter, tile.state)) ||
-		        (!layers.isEmpty() && !layers.value(tile.layerID))) {
-			continue;
+		// The selected tile is drawn last, above the others
+		visibleTiles[tileIndex] = tileIndex != visibleTile
+		        && (!(hideBG || tile.parameter != 255) || params.contains(tile.parameter, tile.state))
+		        && (layers.isEmpty() || layers.value(tile.layerID));
+	}
+
+	bool fullRender = _cache.isNull() || _cache.width() != width || _cache.height() != height
+	        || _cacheBounds.left != _bounds.left || _cacheBounds.top != _bounds.top
+	        || _cacheVisibleTiles.size() != visibleTiles.size();
+
+	if (!fullRender) {
+		for (int tileIndex = 0; tileIndex < _tiles.size(); ++tileIndex) {
+			if (visibleTiles.at(tileIndex) != _cacheVisibleTiles.at(tileIndex)) {
+				dirtyRects.append(tileRect(_tiles.at(tileIndex)));
+			}
 		}
 
-		if (_visibleTile < 0 || _visibleTile != tileIndex) {
-			drawTile(tile, palOffset, srcYWidth, width, bounds,
-			         constMimData, pixels);
+		if (visibleTile != _cacheVisibleTile) {
+			if (_cacheVisibleTile >= 0 && _cacheVisibleTile < _tiles.size()) {
+				dirtyRects.append(tileRect(_tiles.at(_cacheVisibleTile)));
+			}
+			if (visibleTile >= 0) {
+				dirtyRects.append(tileRect(_tiles.at(visibleTile)));
+			}
 		}
+
+		// Too many changes, drawing everything once is faster
+		fullRender = dirtyRects.size() > _tiles.size() / 4;
 	}
 
-	if (_visibleTile >= 0) {
-		const Tile &tile = _tiles.at(_visibleTile);
-		drawTile(tile, palOffset, srcYWidth, width, bounds,
-		         constMimData, pixels);
+	if (_palettes.isEmpty()) {
+		updatePalettes(palOffset);
+	}
 
-		for (int i = 0; i < 16; ++i) {
-			pixels[bounds.left + tile.X + (bounds.top + tile.Y) * width + i] = qRgb(255, 0, 0);
-			pixels[bounds.left + tile.X + (bounds.top + tile.Y + 15) * width + i] = qRgb(255, 0, 0);
-			pixels[bounds.left + tile.X + (bounds.top + tile.Y + i) * width] = qRgb(255, 0, 0);
-			pixels[bounds.left + tile.X + 15 + (bounds.top + tile.Y + i) * width] = qRgb(255, 0, 0);
-		}
+	if (fullRender) {
+		_cache = QImage(width, height, QImage::Format_RGB32);
+		dirtyRects = QList<QRect>() << _cache.rect();
 	}
 
-	return image;
+	QRgb *pixels = (QRgb *)_cache.bits();
+
+	for (const QRect &rect: dirtyRects) {
+		drawRect(palOffset, srcYWidth, visibleTiles, rect & _cache.rect(), pixels);
+	}
+
+	_cacheVisibleTiles = visibleTiles;
+	_cacheVisibleTile = visibleTile;
+	_cacheBounds = _bounds;
+
+	return _cache;
 }
 
-void BackgroundFile::drawTile(const Tile &tile, int palOffset, int srcYWidth,
-                              int imageWidth, const BackgroundBounds &bounds,
-                              const char *constMimData, QRgb *pixels)
+void BackgroundFile::drawRect(int palOffset, int srcYWidth, const QList<bool> &visibleTiles,
+                              const QRect &clip, QRgb *pixels) const
 {
-	quint16 color;
-	const int baseX = bounds.left + tile.X,
-	        palStart = palOffset + tile.palID * 512;
-	int pos = palOffset + 8192 + tile.texID * 128 + tile.srcY * srcYWidth,
-	        x = 0, y = (bounds.top + tile.Y) * imageWidth;
-
-	if (tile.depth == 2) {
-		pos += tile.srcX * 2;
-		srcYWidth /= 2;
-
-		for (int i = 0; i < srcYWidth * 16; ++i) {
-			memcpy(&color, constMimData + pos + i * 2, 2);
-			BGcolor(color, tile.blendType, pixels, baseX + x + y, !tile.draw);
-
-			if (x == 15) {
-				x = 0;
-				i += srcYWidth - 16;
-				y += imageWidth;
-			} else {
-				++x;
-			}
+	if (clip.isEmpty()) {
+		return;
+	}
+
+	const int width = _cache.width();
+	const char *constMimData = _mim.constData();
+
+	for (int y = clip.top(); y <= clip.bottom(); ++y) {
+		std::fill(pixels + y * width + clip.left(), pixels + y * width + clip.right() + 1, QRgb(0xFF000000));
+	}
+
+	for (int tileIndex: _tilesZOrder) {
+		const Tile &tile = _tiles.at(tileIndex);
+
+		if (visibleTiles.at(tileIndex) && tileRect(tile).intersects(clip)) {
+			drawTile(tile, palOffset, srcYWidth, width, _bounds, clip,
+			         constMimData, _palettes.constData(), pixels);
 		}
-	} else if (tile.depth == 1) {
-		pos += tile.srcX;
-
-		for (int i = 0; i < srcYWidth * 16;  ++i) {
-			memcpy(&color, constMimData + palStart + quint8(mim.at(pos+i)) * 2, 2);
-			BGcolor(color, tile.blendType, pixels, baseX + x + y, !tile.draw);
-
-			if (x == 15) {
-				x = 0;
-				i += srcYWidth - 16;
-				y += imageWidth;
-			} else {
-				++x;
-			}
+	}
+
+	if (_visibleTile >= 0 && _visibleTile < _tiles.size()) {
+		const Tile &tile = _tiles.at(_visibleTile);
+		const QRect rect = tileRect(tile);
+
+		if (!rect.intersects(clip)) {
+			return;
 		}
-	} else {
-		pos += tile.srcX / 2;
-
-		for (int i = 0; i < srcYWidth * 16;  ++i) {
-			quint8 index = quint8(mim.at(pos+i));
-			memcpy(&color, constMimData + palStart + (index & 0xF) * 2, 2);
-			BGcolor(color, tile.blendType, pixels, baseX + x + y, !tile.draw);
-			++x;
-
-			memcpy(&color, constMimData + palStart + (index >> 4) * 2, 2);
-			BGcolor(color, tile.blendType, pixels, baseX + x + y, !tile.draw);
-
-			if (x == 15) {
-				x = 0;
-				i += srcYWidth - 8;
-				y += imageWidth;
-			} else {
-				++x;
+
+		drawTile(tile, palOffset, srcYWidth, width, _bounds, clip,
+		         constMimData, _palettes.constData(), pixels);
+
+		for (int i = 0; i < 16; ++i) {
+			const QPoint border[4] = {
+			    QPoint(rect.left() + i, rect.top()), QPoint(rect.left() + i, rect.bottom()),
+			    QPoint(rect.left(), rect.top() + i), QPoint(rect.right(), rect.top() + i)
+			};
+			for (const QPoint &point: border) {
+				if (clip.contains(point)) {
+					pixels[point.x() + point.y() * width] = qRgb(255, 0, 0);
+				}
 			}
 		}
 	}
 }
 
-void BackgroundFile::BGcolor(quint16 value, quint8 blendType, QRgb *pixels,
-                             int index, bool forceBlack)
+void BackgroundFile::updatePalettes(int palOffset) const
 {
-	if (!forceBlack && value == 0) {
-		return;
+	const char *constMimData = _mim.constData() + palOffset;
+	quint16 color;
+
+	_palettes.resize(16 * 256);
+
+	for (int i = 0; i < _palettes.size(); ++i) {
+		memcpy(&color, constMimData + i * 2, 2);
+		_palettes[i] = color == 0 ? QRgb(0) : FF8Color::fromPsColor(color);
 	}
+}
 
-	QRgb color;
+void BackgroundFile::drawTile(const Tile &tile, int palOffset, int srcYWidth,
+                              int imageWidth, const BackgroundBounds &bounds,
+                              const QRect &clip, const char *constMimData,
+                              const QRgb *palettes, QRgb *pixels)
+{
+	const int baseX = bounds.left + tile.X, baseY = bounds.top + tile.Y,
+	        pos = palOffset + 8192 + tile.texID * 128 + tile.srcY * srcYWidth;
+	const QRgb *palette = palettes + tile.palID * 256;
+	// Part of the 16x16 tile inside clip
+	const int x0 = qMax(0, clip.left() - baseX), x1 = qMin(16, clip.right() + 1 - baseX),
+	        y0 = qMax(0, clip.top() - baseY), y1 = qMin(16, clip.bottom() + 1 - baseY);
+	QRgb colors[16] = {};
+	quint16 color;
 
-	if (forceBlack) {
-		color = 0;
-	} else {
-		color = FF8Color::fromPsColor(value);
+	if (x0 >= x1) {
+		return;
 	}
 
-	if (blendType == 4) {
-		pixels[index] = color;
-	} else {
-		QRgb color0 = pixels[index];
-		int r = qRed(color), g = 0, b = 0;
-
-		switch (blendType) {
-		case 0:
-			r = (qRed(color0) + r) / 2;
-			g = (qGreen(color0) + r) / 2;
-			b = (qBlue(color0) + r) / 2;
-			break;
-		case 1:
-			r = qRed(color0) + r;
-			if (r > 255)	r = 255;
-			g = qGreen(color0) + qGreen(color);
-			if (g > 255)	g = 255;
-			b = qBlue(color0) + qBlue(color);
-			if (b > 255)	b = 255;
-			break;
-		case 2:
-			r = qRed(color0) - r;
-			if (r < 0)	r = 0;
-			g = qGreen(color0) - qGreen(color);
-			if (g < 0)	g = 0;
-			b = qBlue(color0) - qBlue(color);
-			if (b < 0)	b = 0;
-			break;
-		case 3:
-			r = qRed(color0) + int(.25 * r);
-			if (r > 255)	r = 255;
-			g = qGreen(color0) + int(.25 * qGreen(color));
-			if (g > 255)	g = 255;
-			b = qBlue(color0) + int(.25 * qBlue(color));
-			if (b > 255)	b = 255;
-			break;
+	for (int y = y0; y < y1; ++y) {
+		const quint8 *row = (const quint8 *)constMimData + pos + y * srcYWidth;
+
+		// Black tiles (draw = 0) keep colors to 0
+		if (!tile.draw) {
+		} else if (tile.depth == 2) {
+			for (int x = x0; x < x1; ++x) {
+				memcpy(&color, row + (tile.srcX + x) * 2, 2);
+				colors[x] = color == 0 ? QRgb(0) : FF8Color::fromPsColor(color);
+			}
+		} else if (tile.depth == 1) {
+			for (int x = x0; x < x1; ++x) {
+				colors[x] = palette[row[tile.srcX + x]];
+			}
+		} else {
+			for (int x = x0; x < x1; ++x) {
+				quint8 index = row[tile.srcX / 2 + x / 2];
+				colors[x] = palette[x & 1 ? index >> 4 : index & 0xF];
+			}
 		}
 
-		pixels[index] = qRgb(r, g, b);
+		blendRow(pixels + (baseY + y) * imageWidth + baseX + x0, colors + x0,
+		         x1 - x0, tile.blendType, !tile.draw);
+	}
+}
+
+/*
+ * Blend a row of colors, where 0 is transparent (except when forceBlack is set).
+ * Written without branches in the loops, so they can be vectorized.
+ */
+void BackgroundFile::blendRow(QRgb *pixels, const QRgb *colors, int count,
+                              quint8 blendType, bool forceBlack)
+{
+	switch (blendType) {
+	case 0:
+		for (int i = 0; i < count; ++i) {
+			const QRgb color0 = pixels[i], color = colors[i];
+			// Green and blue are averaged with the new red
+			const int r = (qRed(color0) + qRed(color)) / 2;
+			const QRgb blended = qRgb(r, (qGreen(color0) + r) / 2, (qBlue(color0) + r) / 2);
+			pixels[i] = forceBlack || color != 0 ? blended : color0;
+		}
+		break;
+	case 1:
+		for (int i = 0; i < count; ++i) {
+			const QRgb color0 = pixels[i], color = colors[i];
+			const QRgb blended = qRgb(qMin(qRed(color0) + qRed(color), 255),
+			                          qMin(qGreen(color0) + qGreen(color), 255),
+			                          qMin(qBlue(color0) + qBlue(color), 255));
+			pixels[i] = forceBlack || color != 0 ? blended : color0;
+		}
+		break;
+	case 2:
+		for (int i = 0; i < count; ++i) {
+			const QRgb color0 = pixels[i], color = colors[i];
+			const QRgb blended = qRgb(qMax(qRed(color0) - qRed(color), 0),
+			                          qMax(qGreen(color0) - qGreen(color), 0),
+			                          qMax(qBlue(color0) - qBlue(color), 0));
+			pixels[i] = forceBlack || color != 0 ? blended : color0;
+		}
+		break;
+	case 3:
+		for (int i = 0; i < count; ++i) {
+			const QRgb color0 = pixels[i], color = colors[i];
+			const QRgb blended = qRgb(qMin(qRed(color0) + (qRed(color) >> 2), 255),
+			                          qMin(qGreen(color0) + (qGreen(color) >> 2), 255),
+			                          qMin(qBlue(color0) + (qBlue(color) >> 2), 255));
+			pixels[i] = forceBlack || color != 0 ? blended : color0;
+		}
+		break;
+	case 4:
+		for (int i = 0; i < count; ++i) {
+			const QRgb color = colors[i];
+			pixels[i] = forceBlack || color != 0 ? color : pixels[i];
+		}
+		break;
+	default:
+		// Unknown blend type: only red is kept
+		for (int i = 0; i < count; ++i) {
+			const QRgb color = colors[i];
+			pixels[i] = forceBlack || color != 0 ? qRgb(qRed(color), 0, 0) : pixels[i];
+		}
+		break;
 	}
 }
 
-QImage BackgroundFile::mimToImage(MapDepth depth)
+QImage BackgroundFile::mimToImage(MapDepth depth) const
 {
 	if (depth == DepthColor) {
 		int width = 832;
-		int height = (mim.size() - 0x3000) / (2 * width);
-		const char *data = mim.constData();
+		int height = (_mim.size() - 0x3000) / (2 * width);
+		const char *data = _mim.constData();
 
-		if (mim.size() < 0x3000 + width * height * 2) {
+		if (_mim.size() < 0x3000 + width * height * 2) {
 			return QImage();
 		}
 
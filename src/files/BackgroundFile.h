@@ -85,7 +85,12 @@ public:
 
 	QImage background(bool hideBG=false) const;
 	QImage background(const QList<quint8> &activeParams, bool hideBG = false);
-	static QImage mimToImage(MapDepth depth);
+	QImage mimToImage(MapDepth depth) const;
+	// Free the MIM data and the rendered image, open() must be called again before rendering
+	void releaseMim();
+	inline bool hasMim() const {
+		return !_mim.isEmpty();
+	}
 
 	inline const QList<Tile> &tiles() const {
 		return _tiles;
@@ -109,19 +114,32 @@ private:
 	using File::open;
 	bool openParameters();
 	QList<Tile> parseTiles(const QByteArray &map, MapType &type) const;
-	QImage toImage(int palOffset, int srcYWidth,
-	               const QMultiMap<quint16, int> &tiles,
-	               const BackgroundBounds &bounds, bool hideBG) const;
+	QImage toImage(int palOffset, int srcYWidth, bool hideBG) const;
+	void drawRect(int palOffset, int srcYWidth, const QList<bool> &visibleTiles,
+	              const QRect &clip, QRgb *pixels) const;
+	QRect tileRect(const Tile &tile) const;
+	void invalidateTile(const Tile &tile);
+	void invalidateCache();
+	void updatePalettes(int palOffset) const;
 	static void drawTile(const Tile &tile, int palOffset, int srcYWidth,
 	                     int imageWidth, const BackgroundBounds &bounds,
-	                     const char *constMimData, QRgb *pixels);
-	static void BGcolor(quint16 value, quint8 blendType, QRgb *pixels,
-	                    int index, bool forceBlack);
-	static QByteArray mim;
+	                     const QRect &clip, const char *constMimData,
+	                     const QRgb *palettes, QRgb *pixels);
+	static void blendRow(QRgb *pixels, const QRgb *colors, int count,
+	                     quint8 blendType, bool forceBlack);
+	QByteArray _mim;
 	bool opened;
 	MapType _mapType;
 	QList<Tile> _tiles;
 	QMultiMap<quint16, int> _tilesZOrder;
 	BackgroundBounds _bounds;
 	int _visibleTile;
+	// Last rendered image, only the tiles whose visibility changed are redrawn
+	mutable QMutex _cacheMutex;
+	mutable QImage _cache;
+	mutable QList<bool> _cacheVisibleTiles;
+	mutable QList<QRect> _cacheDirtyRects;
+	mutable QList<QRgb> _palettes; // 16 palettes of 256 colors, transparent is 0
+	mutable BackgroundBounds _cacheBounds;
+	mutable int _cacheVisibleTile;
 };
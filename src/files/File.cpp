@@ -17,10 +17,10 @@
  ****************************************************************************/
 #include "File.h"
 
-QString File::lastError;
+thread_local QString File::lastError;
 
 File::File() :
-	modified(false)
+	modified(false), _revision(0)
 {
 }
 
@@ -81,6 +81,9 @@ bool File::isModified() const
 void File::setModified(bool modified)
 {
 	this->modified = modified;
+	if (modified) {
+		++_revision;
+	}
 }
 
 const QString &File::errorString() const
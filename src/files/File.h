@@ -32,8 +32,14 @@ public:
 	virtual QString filterText() const=0;
 	bool isModified() const;
 	void setModified(bool modified);
+	// Incremented by setModified(true), to detect changes since a given time
+	inline quint32 revision() const {
+		return _revision;
+	}
 	const QString &errorString() const;
 protected:
 	bool modified;
-	static QString lastError;
+	static thread_local QString lastError;
+private:
+	quint32 _revision;
 };
@@ -25,13 +25,17 @@ JsmFile::JsmFile() :
 	File(), _hasSym(false), needUpdate(true), needUpdateMore(true),
     groupItem(0), _oldFormat(false)
 {
-	if(opcodeNameCalc.isEmpty()) {
+	// Thread-safe initialization, fields can be opened concurrently
+	static const bool opcodeNamesInitialized = []() {
 		for(int i=0 ; i<18 ; ++i)
 			opcodeNameCalc.append(JsmOpcodeCal::cal_table[i]);
 
 		for(int i=0 ; i<JSM_OPCODE_COUNT ; ++i)
 			opcodeName.append(JsmOpcode::opcodes[i]);
-	}
+
+		return true;
+	}();
+	Q_UNUSED(opcodeNamesInitialized)
 }
 
 JsmFile::~JsmFile()
@@ -405,8 +409,7 @@ void JsmFile::searchWindows()
 	ff8Windows.clear();
 
 	for(int i=4 ; i<nbOpcode ; ++i) {
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
+		key = scripts.key(i);
 
 		switch(key) {
 		case JsmOpcode::AMESW:
@@ -538,9 +541,8 @@ void JsmFile::searchGroupTypes()
 			pos = scripts.posScript(groupID, methodID, &nbOpcode);
 
 			for(int opcodeID=0 ; opcodeID < nbOpcode ; ++opcodeID) {
-				JsmOpcode op = scripts.opcode(pos + opcodeID);
-				key = op.key();
-				param = op.param();
+				key = scripts.key(pos + opcodeID);
+				param = scripts.param(pos + opcodeID);
 
 				if(!scripts.script(groupID, methodID).flag()) {
 					switch(key) {
@@ -665,7 +667,8 @@ void JsmFile::setWindow(quint8 textID, int winID, const FF8Window &window)
 		return;
 	}
 
-	needUpdate = modified = true;
+	needUpdate = true;
+	setModified(true);
 
 	searchWindows();
 }
@@ -696,7 +699,8 @@ QString JsmFile::toString(int groupID, int methodID, bool moreDecompiled,
 QString JsmFile::_toString(int groupID, int methodID, int indent) const
 {
 	QString ret;
-	QList<JsmOpcode *> opcodes = scripts.opcodesp(groupID, methodID, true);
+	JsmArena arena;
+	QList<JsmOpcode *> opcodes = scripts.opcodesp(groupID, methodID, true, arena);
 
 	for (JsmOpcode *op: opcodes) {
 		if (indent > 0) {
@@ -704,7 +708,6 @@ QString JsmFile::_toString(int groupID, int methodID, int indent) const
 		}
 		ret.append(op->toString());
 		ret.append("\n");
-		delete op;
 	}
 
 	return ret;
@@ -712,27 +715,22 @@ QString JsmFile::_toString(int groupID, int methodID, int indent) const
 
 QString JsmFile::_toStringMore(int groupID, int methodID, const Field *field, int indent) const
 {
-	QSet<void *> collectPointers;
-	JsmProgram program = scripts.program(groupID, methodID, collectPointers);
-	QStringList ret = program.toStringList(field, indent);
+	// Destroyed after program
+	JsmArena arena;
+	JsmProgram program = scripts.program(groupID, methodID, arena);
 
-	qDeleteAll(collectPointers);
-
-	return ret.join("\n");
+	return program.toStringList(field, indent).join("\n");
 }
 
 int JsmFile::opcodePositionInText(int groupID, int methodID, int opcodeID) const
 {
-	QList<JsmOpcode *> opcodes = scripts.opcodesp(groupID, methodID, false);
 	int line = opcodeID;
-	QList<qint32> labels = scripts.searchJumps(opcodes);
+	QList<qint32> labels = scripts.searchJumps(groupID, methodID);
 
 	for(int i=0 ; i <= opcodeID ; ++i) {
 		if(labels.contains(i))	++line;
 	}
 
-	qDeleteAll(opcodes);
-
 	return line;
 }
 
@@ -941,7 +939,7 @@ int JsmFile::fromString(int groupID, int methodID, const QString &text, QString
 
 	scripts.replaceScript(groupID, methodID, res);
 
-	modified = true;
+	setModified(true);
 	needUpdateMore = true;
 
 	return 0;
@@ -1092,9 +1090,8 @@ bool JsmFile::searchReverse(SearchType type, const QList<quint64> &values, int &
 
 bool JsmFile::search(SearchType type, quint64 value, quint16 pos, int opcodeID) const
 {
-	JsmOpcode op = scripts.opcode(pos + opcodeID);
-	quint32 key = op.key();
-	qint32 param = op.param();
+	quint32 key = scripts.key(pos + opcodeID);
+	qint32 param = scripts.param(pos + opcodeID);
 
 	switch(type) {
 	case SearchText:
@@ -1141,6 +1138,109 @@ bool JsmFile::search(SearchType type, quint64 value, quint16 pos, int opcodeID)
 	return false;
 }
 
+void JsmFile::indexKeys(QHash<quint64, QList<quint64> > &keys) const
+{
+	int groupListSize = scripts.nbGroup(), nbOpcode, methodCount;
+
+	for(int groupID = 0; groupID < groupListSize; ++groupID) {
+		methodCount = scripts.nbScript(groupID);
+
+		for(int methodID = 0; methodID < methodCount; ++methodID) {
+			const int pos = quint16(scripts.posScript(groupID, methodID, &nbOpcode));
+
+			for(int opcodeID = 0; opcodeID < nbOpcode; ++opcodeID) {
+				const quint64 location = indexLocation(groupID, methodID, opcodeID);
+				quint32 key = scripts.key(pos + opcodeID);
+				qint32 param = scripts.param(pos + opcodeID);
+				int textOffset = 0;
+
+				// Same conditions as search(type, value, pos, opcodeID)
+				if(key <= 0xFFFF) {
+					keys[indexKey(SearchOpcode, key | (0xFFFFFFFFULL << 16))].append(location);
+					if(param != -1) {
+						keys[indexKey(SearchOpcode, key | (quint64(quint32(param)) << 16))].append(location);
+					}
+				}
+
+				if(key >= 10 && key <= 18 && quint32(param) <= 0x3FFFFFFF) {
+					bool pop = key == JsmOpcode::POPM_B || key == JsmOpcode::POPM_W || key == JsmOpcode::POPM_L;
+					keys[indexKey(SearchVar, (pop ? 0x80000000 : 0x40000000) | quint32(param))].append(location);
+				}
+
+				if(opcodeID < 1) {
+					continue;
+				}
+
+				const qint32 prevParam = scripts.param(pos + opcodeID - 1);
+
+				if(key >= 20 && key <= 22 && quint32(prevParam) <= 0xFFFF && quint32(param) <= 0xFFFF) {
+					keys[indexKey(SearchExec, (quint32(prevParam) << 16) | quint32(param))].append(location);
+				}
+
+				switch(key) {
+				case JsmOpcode::MAPJUMP:
+				case JsmOpcode::MAPJUMP3:
+				case JsmOpcode::MAPJUMPO:
+					if(scripts.key(pos + opcodeID - 1) == JsmOpcode::PSHN_L) {
+						keys[indexKey(SearchMapJump, quint32(prevParam))].append(location);
+					}
+					break;
+				case JsmOpcode::AMESW:
+				case JsmOpcode::AMES:
+				case JsmOpcode::RAMESW:
+					textOffset = 3;
+					break;
+				case JsmOpcode::MES:
+					textOffset = 1;
+					break;
+				case JsmOpcode::AASK:
+					textOffset = 7;
+					break;
+				case JsmOpcode::ASK:
+					textOffset = 5;
+					break;
+				}
+
+				if(textOffset > 0 && opcodeID >= textOffset
+				        && scripts.key(pos + opcodeID - textOffset) == JsmOpcode::PSHN_L) {
+					keys[indexKey(SearchText, quint32(scripts.param(pos + opcodeID - textOffset)))].append(location);
+				}
+			}
+		}
+	}
+}
+
+QList<quint64> JsmFile::indexKeys(SearchType type, quint64 value)
+{
+	QList<quint64> ret;
+
+	switch(type) {
+	case SearchText:
+	case SearchMapJump:
+		if(value <= 0xFFFFFFFF) {
+			ret.append(indexKey(type, value));
+		}
+		break;
+	case SearchOpcode:
+		ret.append(indexKey(type, (value & 0xFFFF) | (quint64(quint32(value >> 16)) << 16)));
+		break;
+	case SearchVar:
+		// Neither pop nor push flag: both
+		if((value & 0x80000000) || !(value & 0xC0000000)) {
+			ret.append(indexKey(type, 0x80000000 | (value & 0x3FFFFFFF)));
+		}
+		if((value & 0x40000000) || !(value & 0xC0000000)) {
+			ret.append(indexKey(type, 0x40000000 | (value & 0x3FFFFFFF)));
+		}
+		break;
+	case SearchExec:
+		ret.append(indexKey(type, value & 0xFFFFFFFF));
+		break;
+	}
+
+	return ret;
+}
+
 QList<int> JsmFile::searchAllVars() const
 {
 	int nbOpcode = scripts.data().nbOpcode();
@@ -1149,11 +1249,13 @@ QList<int> JsmFile::searchAllVars() const
 
 	for(int i=0 ; i<nbOpcode ; ++i)
 	{
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
+		key = scripts.key(i);
 
-		if(key >= 10 && key <= 18 && !vars.contains(op.opcode())) {
-			vars.append(op.opcode());
+		if(key >= 10 && key <= 18) {
+			const int var = int(scripts.opcode(i).opcode());
+			if(!vars.contains(var)) {
+				vars.append(var);
+			}
 		}
 	}
 
@@ -1171,9 +1273,8 @@ QList<int> JsmFile::searchAllSpells(const QString &fieldName) const
 
 	for(int i=0 ; i<nbOpcode ; ++i)
 	{
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
-		param = op.param();
+		key = scripts.key(i);
+		param = scripts.param(i);
 
 		if(key == JsmOpcode::SETDRAWPOINT) {
 			setDrawPoint = true;
@@ -1204,9 +1305,8 @@ QList<int> JsmFile::searchAllCards(const QString &fieldName) const
 
 	for(int i=0 ; i<nbOpcode ; ++i)
 	{
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
-		param = op.param();
+		key = scripts.key(i);
+		param = scripts.param(i);
 
 		if(key == JsmOpcode::GETCARD && i > 0) {
 			if(scripts.key(i - 1) == JsmOpcode::PSHN_L) {
@@ -1230,9 +1330,8 @@ QList<int> JsmFile::searchAllCardPlayers(const QString &fieldName) const
 
 	for(int i=0 ; i<nbOpcode ; ++i)
 	{
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
-		param = op.param();
+		key = scripts.key(i);
+		param = scripts.param(i);
 
 		if(key == JsmOpcode::CARDGAME && i > 6) {
 			if(scripts.key(i - 7) == JsmOpcode::PSHN_L) {
@@ -1256,15 +1355,37 @@ QList<int> JsmFile::searchAllMoments() const
 
 	for(int i=0 ; i<nbOpcode ; ++i)
 	{
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
-		param = op.param();
+		key = scripts.key(i);
+		param = scripts.param(i);
 
 		if((key==JsmOpcode::POPM_B || key == JsmOpcode::POPM_W || key == JsmOpcode::POPM_L) && i>0 && param==256) {
-			op = scripts.opcode(i-1);
-			param = op.param();
+			param = scripts.param(i-1);
+
+			if(scripts.key(i-1)==JsmOpcode::PSHN_L && !ret.contains(param))
+				ret.append(param);
+		}
+	}
+
+	return ret;
+}
+
+QList<int> JsmFile::searchAllMapJumps() const
+{
+	int nbOpcode = scripts.data().nbOpcode();
+	quint32 key;
+	qint32 param;
+	QList<int> ret;
+
+	for(int i=1 ; i<nbOpcode ; ++i)
+	{
+		key = scripts.key(i);
+
+		// Same opcodes as search(SearchMapJump, ...)
+		if((key==JsmOpcode::MAPJUMP || key==JsmOpcode::MAPJUMP3 || key==JsmOpcode::MAPJUMPO)
+		        && scripts.key(i-1)==JsmOpcode::PSHN_L) {
+			param = scripts.param(i-1);
 
-			if(op.key()==JsmOpcode::PSHN_L && !ret.contains(param))
+			if(!ret.contains(param))
 				ret.append(param);
 		}
 	}
@@ -1281,10 +1402,9 @@ void JsmFile::searchAllOpcodeTypes(QMap<int, int> &ret/*, QMap<int, QString> &st
 
 	for(int i=0 ; i<nbOpcode ; ++i)
 	{
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
-		param = op.param();
-		int type = !op.hasParam() ? JUST_KEY : (param < 0 ? KEY_AND_SPARAM : KEY_AND_UPARAM);
+		key = scripts.key(i);
+		param = scripts.param(i);
+		int type = !scripts.data().hasParam(i) ? JUST_KEY : (param < 0 ? KEY_AND_SPARAM : KEY_AND_UPARAM);
 
 		switch(key) {
 		case JsmOpcode::PSHN_L:
@@ -1348,9 +1468,8 @@ void JsmFile::searchAllSavePoints(QList<Vertex> &ret)
 	qint32 param;
 
 	for(int i=0 ; i<nbOpcode ; ++i) {
-		JsmOpcode op = scripts.opcode(i);
-		key = op.key();
-		param = op.param();
+		key = scripts.key(i);
+		param = scripts.param(i);
 
 		switch(key) {
 		case JsmOpcode::SETLINE:
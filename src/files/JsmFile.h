@@ -87,11 +87,19 @@ public:
 	bool search(SearchType type, const QList<quint64> &values, int &groupID, int &methodID, int &opcodeID) const;
 	bool searchReverse(SearchType type, quint64 value, int &groupID, int &methodID, int &opcodeID) const;
 	bool searchReverse(SearchType type, const QList<quint64> &values, int &groupID, int &methodID, int &opcodeID) const;
+	// Index of every (type, value) matched by search(), values are locations packed by indexLocation()
+	void indexKeys(QHash<quint64, QList<quint64> > &keys) const;
+	// Keys of indexKeys() to lookup to do search(type, value)
+	static QList<quint64> indexKeys(SearchType type, quint64 value);
+	inline static quint64 indexLocation(int groupID, int methodID, int opcodeID) {
+		return (quint64(quint16(groupID)) << 48) | (quint64(quint16(methodID)) << 32) | quint32(opcodeID);
+	}
 	QList<int> searchAllVars() const;
 	QList<int> searchAllSpells(const QString &fieldName) const;
 	QList<int> searchAllCards(const QString &fieldName) const;
 	QList<int> searchAllCardPlayers(const QString &fieldName) const;
 	QList<int> searchAllMoments() const;
+	QList<int> searchAllMapJumps() const;
 	void searchAllOpcodeTypes(QMap<int, int> &ret) const;
 	void searchDefaultBGStates(QMultiMap<quint8, quint8> &params) const;
 
@@ -119,6 +127,9 @@ public:
 	static QStringList opcodeNameCalc;
 private:
 	bool search(SearchType type, quint64 value, quint16 pos, int opcodeID) const;
+	inline static quint64 indexKey(SearchType type, quint64 value) {
+		return (quint64(type) << 56) | (value & 0x00FFFFFFFFFFFFFFULL);
+	}
 	QString _toString(int position, int nbOpcode, int indent = 0) const;
 	QString _toStringMore(int position, int nbOpcode, const Field *field, int indent = 0) const;
 
@@ -52,7 +52,7 @@ quint16 MrtFile::formation(int index) const
 void MrtFile::setFormation(int index, quint16 formation)
 {
 	formations[index] = formation;
-	modified = true;
+	setModified(true);
 }
 
 QList<int> MrtFile::searchAllBattles() const
@@ -132,7 +132,7 @@ void MsdFile::setText(int id, const FF8Text &text)
 {
 	if (id >= 0 && id < nbText()) {
 		texts.replace(id, text.toFF8());
-		modified = true;
+		setModified(true);
 	}
 }
 
@@ -140,7 +140,7 @@ void MsdFile::setTexts(const QList<QByteArray> &texts)
 {
 	this->texts = texts;
 	needEndOfString = QList<bool>(texts.size(), true);
-	modified = true;
+	setModified(true);
 }
 
 void MsdFile::insertText(int id)
@@ -148,7 +148,7 @@ void MsdFile::insertText(int id)
 //	qDebug() << "MsdFile::insertText(int id)" << id;
 	texts.insert(id, QByteArray());
 	needEndOfString.insert(id, true);
-	modified = true;
+	setModified(true);
 }
 
 void MsdFile::removeText(int id)
@@ -157,7 +157,7 @@ void MsdFile::removeText(int id)
 //		qDebug() << "MsdFile::removeText(int id)" << id;
 		texts.removeAt(id);
 		needEndOfString.removeAt(id);
-		modified = true;
+		setModified(true);
 	}
 }
 
@@ -18,7 +18,7 @@
 #include "files/TdwFile.h"
 
 TdwFile::TdwFile() :
-	File()
+	File(), _glyphRevision(0)
 {
 }
 
@@ -60,6 +60,7 @@ bool TdwFile::open(const QByteArray &tdw)
 
 	_charWidth.clear();
 	_charCount.clear();
+	glyphsChanged();
 
 	if (sizeHeader != 0) {
 		tableCount = sizeHeader / 112 + int(sizeHeader % 112 != 0);
@@ -107,6 +108,7 @@ void TdwFile::close()
 			delete table;
 		}
 		_charWidth.clear();
+		glyphsChanged();
 	}
 }
 
@@ -212,6 +214,39 @@ QImage TdwFile::letter(int charId, Color color, bool curFrame)
 	return ret;
 }
 
+const QImage &TdwFile::letterAtlas(int charId, Color color, bool curFrame)
+{
+	const bool darker = color > 7 && !curFrame;
+	const int palette = this->palette(color, charId), atlasId = palette * 2 + int(darker);
+
+	if (atlasId >= _atlas.size()) {
+		_atlas.resize(atlasId + 1);
+	}
+
+	QImage &atlas = _atlas[atlasId];
+
+	if (atlas.isNull()) {
+		_tim.setCurrentColorTable(palette);
+		QImage image = _tim.image();
+		if (darker) {
+			QVector<QRgb> colorTable;
+			for (QRgb color: image.colorTable()) {
+				colorTable.append(qRgba(qRed(color) * 0.75, qGreen(color) * 0.75, qBlue(color) * 0.75, qAlpha(color)));
+			}
+			image.setColorTable(colorTable);
+		}
+		atlas = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+	}
+
+	return atlas;
+}
+
+void TdwFile::glyphsChanged()
+{
+	_atlas.clear();
+	++_glyphRevision;
+}
+
 void TdwFile::setLetter(quint8 tableId, quint8 charId, const QImage &image)
 {
 	setLetter(tableId * 224 + charId, image);
@@ -236,6 +271,7 @@ void TdwFile::setLetter(int charId, const QImage &image)
 		++y2;
 	}
 
+	glyphsChanged();
 	modified = true;
 }
 
@@ -298,6 +334,7 @@ bool TdwFile::setLetterPixelIndex(int charId, const QPoint &pos, uint pixelIndex
 		while ((index = modifColorTable.indexOf(newColor, index + 1)) != -1) {
 			if (notModifColorTable.at(index) == notModifColor) {
 				_tim.imagePtr()->setPixel(letterPos(charId) + pos, index);
+				glyphsChanged();
 				modified = true;
 				return true;
 			}
@@ -307,6 +344,7 @@ bool TdwFile::setLetterPixelIndex(int charId, const QPoint &pos, uint pixelIndex
 	} else {
 		// pixelIndex must be a number between 0 and 15
 		_tim.imagePtr()->setPixel(letterPos(charId) + pos, pixelIndex % 16);
+		glyphsChanged();
 		modified = true;
 		return true;
 	}
@@ -320,6 +358,7 @@ quint8 TdwFile::charWidth(quint8 tableId, quint8 charId) const
 void TdwFile::setCharWidth(quint8 tableId, quint8 charId, quint8 width)
 {
 	_charWidth[tableId][charId] = width;
+	glyphsChanged();
 	modified = true;
 }
 
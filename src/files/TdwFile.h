@@ -43,6 +43,14 @@ public:
 	QImage letter(quint8 tableId, quint8 charId, Color color, bool curFrame);
 	// Absolute charId
 	QImage letter(int charId, Color color, bool curFrame);
+	// Image of every letter in the palette of this color, the letter is at letterRect(charId)
+	// Built on first use, and kept until the letters are modified
+	const QImage &letterAtlas(int charId, Color color, bool curFrame);
+	QRect letterRect(int charId) const;
+	// Incremented when the letters or their widths change
+	inline quint32 glyphRevision() const {
+		return _glyphRevision;
+	}
 	void setLetter(quint8 tableId, quint8 charId, const QImage &image);
 	void setLetter(int charId, const QImage &image);
 	void setImage(const QImage &image, int hCount, int vCount);
@@ -60,8 +68,10 @@ private:
 	int palette(Color color, int charId) const;
 	QPoint letterPos(int charId) const;
 	static QSize letterSize();
-	QRect letterRect(int charId) const;
+	void glyphsChanged();
 	TimFile _tim;
 	QList<int> _charCount;
 	QList<quint8 *> _charWidth;
+	QList<QImage> _atlas; // By palette, darker or not
+	quint32 _glyphRevision;
 };
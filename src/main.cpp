@@ -29,6 +29,7 @@
 #endif
 #include "Config.h"
 #include "FF8Font.h"
+#include "FsArchive.h"
 
 // Only for static compilation
 //Q_IMPORT_PLUGIN(qjpcodecs) // jp encoding
@@ -68,6 +69,10 @@ int main(int argc, char *argv[])
 
 	Config::set();
 
+	FsArchive::setLzsLevel(LzsEncoder::Level(qBound(int(LzsEncoder::Fast),
+	                                                Config::value("lzsLevel", int(FsArchive::lzsLevel())).toInt(),
+	                                                int(LzsEncoder::Best))));
+
 	QString lang = QLocale::system().name().toLower();
 	lang = Config::value("lang", lang.left(lang.indexOf("_"))).toString();
 
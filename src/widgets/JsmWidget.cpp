@@ -356,6 +356,9 @@ void JsmWidget::showPreview(const QString &line, QPoint cursorPos)
 
 					if (file) {
 						preview->showBackground(QPixmap::fromImage(file->background()));
+						if (field != data()) {
+							file->releaseMim();
+						}
 						preview->move(cursorPos);
 						preview->show();
 
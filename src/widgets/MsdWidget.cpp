@@ -340,8 +340,8 @@ void MsdWidget::fill()
 
 	if (!hasData())		return;
 
-	if (data()->hasTdwFile())
-		textPreview->setFontImageAdd(data()->getTdwFile());
+	// Fields without tdw file reset the font of the previous field
+	textPreview->setFontImageAdd(data()->hasTdwFile() ? data()->getTdwFile() : nullptr);
 
 	bool hasTexts = false;
 
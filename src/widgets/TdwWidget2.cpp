@@ -157,7 +157,7 @@ void TdwWidget2::setLetter(int i)
 
 	if (tdwGrid->currentTable() <= 3) {
 		if (ff8Font) {
-			textLetter->setText(FF8Text(ba.append((char)(0x20 + i)), ff8Font->tables()));
+			textLetter->setText(FF8Text(ba.append((char)(0x20 + i)), ff8Font->codec()));
 		} else {
 			textLetter->setText(FF8Text(ba.append((char)(0x20 + i))));
 		}
@@ -0,0 +1,243 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include <QtTest>
+#include "FF8Color.h"
+#include "files/BackgroundFile.h"
+
+#define MIM_SIZE      438272
+#define PAL_OFFSET    4096
+#define SRC_Y_WIDTH   1664
+#define TILE_COUNT    300
+
+/*
+ * Renders random tiles and compares the result with the per-pixel
+ * drawing used before the palette tables and blendRow().
+ */
+class BackgroundFileTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void backgroundMatchesReference();
+	void redrawnTileMatchesReference();
+private:
+	static QByteArray randomMim(QRandomGenerator &random);
+	static Tile randomTile(QRandomGenerator &random, quint16 z);
+	static QByteArray map(const QList<Tile> &tiles);
+	static QImage referenceImage(const QByteArray &mim, const QList<Tile> &tiles);
+	static void referenceColor(quint16 value, quint8 blendType, QRgb *pixels,
+	                           int index, bool forceBlack);
+	QByteArray _mim;
+	QList<Tile> _tiles;
+};
+
+void BackgroundFileTest::initTestCase()
+{
+	QRandomGenerator random(0x8F7);
+
+	_mim = randomMim(random);
+
+	for (int i = 0; i < TILE_COUNT; ++i) {
+		// Unique depths, to have only one drawing order
+		_tiles.append(randomTile(random, quint16(100 + i)));
+	}
+}
+
+void BackgroundFileTest::backgroundMatchesReference()
+{
+	BackgroundFile background;
+	QVERIFY(background.open(map(_tiles), _mim));
+	QCOMPARE(background.tiles().size(), _tiles.size());
+
+	QCOMPARE(background.background(), referenceImage(_mim, background.tiles()));
+}
+
+void BackgroundFileTest::redrawnTileMatchesReference()
+{
+	QRandomGenerator random(0x2A);
+	BackgroundFile background;
+	QVERIFY(background.open(map(_tiles), _mim));
+	background.background();
+
+	// Only the rectangles of these tiles are redrawn
+	for (int i = 0; i < 8; ++i) {
+		quint16 index = quint16(random.bounded(TILE_COUNT));
+		Tile tile = randomTile(random, background.tile(index).Z);
+		tile.X = background.tile(index).X;
+		tile.Y = background.tile(index).Y;
+		background.setTile(index, tile);
+	}
+
+	QCOMPARE(background.background(), referenceImage(_mim, background.tiles()));
+}
+
+QByteArray BackgroundFileTest::randomMim(QRandomGenerator &random)
+{
+	QByteArray mim(MIM_SIZE, '\0');
+	quint16 *colors = (quint16 *)mim.data();
+
+	random.fillRange((quint32 *)mim.data(), MIM_SIZE / 4);
+
+	// Transparent colors in the palettes and in the 16-bit textures
+	for (int i = 0; i < MIM_SIZE / 2; i += 7) {
+		colors[i] = 0;
+	}
+
+	return mim;
+}
+
+Tile BackgroundFileTest::randomTile(QRandomGenerator &random, quint16 z)
+{
+	Tile tile = Tile();
+	tile.X = qint16(random.bounded(-40, 40));
+	tile.Y = qint16(random.bounded(-30, 30));
+	tile.Z = z;
+	tile.depth = random.bounded(3);
+	// The 16 pixels of a row stay in the 1664 bytes of a texture row
+	tile.texID = random.bounded(tile.depth == 2 ? 9 : 12);
+	tile.srcX = quint16(random.bounded(8) * 16);
+	tile.srcY = quint16(random.bounded(16) * 16);
+	tile.palID = quint8(random.bounded(16));
+	tile.draw = random.bounded(8) != 0;
+	tile.blend = random.bounded(4);
+	// 5 is an unknown blend type
+	tile.blendType = quint8(random.bounded(6));
+	tile.layerID = 0;
+	tile.parameter = 255;
+	tile.state = 0;
+
+	return tile;
+}
+
+QByteArray BackgroundFileTest::map(const QList<Tile> &tiles)
+{
+	QByteArray map;
+	Tile2 tile2;
+
+	for (const Tile &tile: tiles) {
+		tile2 = Tile::toTile2(tile);
+		map.append((const char *)&tile2, sizeof(Tile2));
+	}
+
+	tile2 = Tile2();
+	tile2.X = 0x7fff;
+	map.append((const char *)&tile2, sizeof(Tile2));
+
+	return map;
+}
+
+QImage BackgroundFileTest::referenceImage(const QByteArray &mim, const QList<Tile> &tiles)
+{
+	BackgroundBounds bounds = BackgroundBounds();
+
+	for (const Tile &tile: tiles) {
+		if (tile.X >= 0 && tile.X > bounds.right)
+			bounds.right = tile.X;
+		else if (tile.X < 0 && -tile.X > bounds.left)
+			bounds.left = -tile.X;
+		if (tile.Y >= 0 && tile.Y > bounds.bottom)
+			bounds.bottom = tile.Y;
+		else if (tile.Y < 0 && -tile.Y > bounds.top)
+			bounds.top = -tile.Y;
+	}
+
+	const int width = bounds.left + bounds.right + 16,
+	        height = bounds.top + bounds.bottom + 16;
+	QImage image(width, height, QImage::Format_RGB32);
+	image.fill(QRgb(0xFF000000));
+	QRgb *pixels = (QRgb *)image.bits();
+	const char *constMimData = mim.constData();
+	quint16 color;
+
+	// Farthest tiles first
+	QList<Tile> sortedTiles = tiles;
+	std::sort(sortedTiles.begin(), sortedTiles.end(), [](const Tile &a, const Tile &b) {
+		return a.Z > b.Z;
+	});
+
+	for (const Tile &tile: sortedTiles) {
+		const int baseX = bounds.left + tile.X, baseY = bounds.top + tile.Y,
+		        palStart = PAL_OFFSET + tile.palID * 512,
+		        pos = PAL_OFFSET + 8192 + tile.texID * 128 + tile.srcY * SRC_Y_WIDTH;
+
+		for (int y = 0; y < 16; ++y) {
+			const char *row = constMimData + pos + y * SRC_Y_WIDTH;
+			const int line = (baseY + y) * width + baseX;
+
+			for (int x = 0; x < 16; ++x) {
+				if (tile.depth == 2) {
+					memcpy(&color, row + (tile.srcX + x) * 2, 2);
+				} else if (tile.depth == 1) {
+					memcpy(&color, constMimData + palStart + quint8(row[tile.srcX + x]) * 2, 2);
+				} else {
+					quint8 index = quint8(row[tile.srcX / 2 + x / 2]);
+					memcpy(&color, constMimData + palStart + (x & 1 ? index >> 4 : index & 0xF) * 2, 2);
+				}
+				referenceColor(color, tile.blendType, pixels, line + x, !tile.draw);
+			}
+		}
+	}
+
+	return image;
+}
+
+void BackgroundFileTest::referenceColor(quint16 value, quint8 blendType, QRgb *pixels,
+                                        int index, bool forceBlack)
+{
+	if (!forceBlack && value == 0) {
+		return;
+	}
+
+	QRgb color = forceBlack ? QRgb(0) : FF8Color::fromPsColor(value);
+
+	if (blendType == 4) {
+		pixels[index] = color;
+		return;
+	}
+
+	QRgb color0 = pixels[index];
+	int r = qRed(color), g = 0, b = 0;
+
+	switch (blendType) {
+	case 0:
+		r = (qRed(color0) + r) / 2;
+		g = (qGreen(color0) + r) / 2;
+		b = (qBlue(color0) + r) / 2;
+		break;
+	case 1:
+		r = qMin(qRed(color0) + r, 255);
+		g = qMin(qGreen(color0) + qGreen(color), 255);
+		b = qMin(qBlue(color0) + qBlue(color), 255);
+		break;
+	case 2:
+		r = qMax(qRed(color0) - r, 0);
+		g = qMax(qGreen(color0) - qGreen(color), 0);
+		b = qMax(qBlue(color0) - qBlue(color), 0);
+		break;
+	case 3:
+		r = qMin(qRed(color0) + int(.25 * r), 255);
+		g = qMin(qGreen(color0) + int(.25 * qGreen(color)), 255);
+		b = qMin(qBlue(color0) + int(.25 * qBlue(color)), 255);
+		break;
+	}
+
+	pixels[index] = qRgb(r, g, b);
+}
+
+QTEST_GUILESS_MAIN(BackgroundFileTest)
+#include "BackgroundFileTest.moc"
@@ -0,0 +1,147 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include <QtTest>
+#include "FF8Font.h"
+
+/*
+ * Texts decoded then encoded again by the codecs of the bundled fonts
+ * ("00" latin and "01" japanese) must give back the original bytes.
+ */
+class FF8TextCodecTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void characters_data();
+	void characters();
+	void strings_data();
+	void strings();
+};
+
+void FF8TextCodecTest::initTestCase()
+{
+	QStandardPaths::setTestModeEnabled(true);
+	QVERIFY(FF8Font::listFonts());
+	QVERIFY(FF8Font::font("00") != nullptr);
+	QVERIFY(FF8Font::font("01") != nullptr);
+	QVERIFY(!FF8Font::font("00")->codec()->isJp());
+	QVERIFY(FF8Font::font("01")->codec()->isJp());
+}
+
+void FF8TextCodecTest::characters_data()
+{
+	QTest::addColumn<QString>("fontName");
+	QTest::addColumn<QByteArray>("ff8");
+	QTest::addColumn<QString>("text");
+	QTest::addColumn<QByteArray>("expected");
+
+	for (const QString &fontName: {QStringLiteral("00"), QStringLiteral("01")}) {
+		const FF8Font *font = FF8Font::font(fontName);
+		const int tableCount = font->codec()->isJp() ? 4 : 1;
+		// A character present in several tables is encoded with its first occurrence
+		QHash<QString, QByteArray> firstCodes;
+
+		for (int table = 0; table < tableCount; ++table) {
+			const QStringList &chars = font->tables().at(table);
+
+			for (int ord = 0x20; ord <= 0xff; ++ord) {
+				QByteArray ff8;
+				QString text = chars.value(ord - 0x20);
+
+				if (table > 0) {
+					ff8.append(char(0x18 + table));
+				}
+				ff8.append(char(ord));
+
+				if (text.isEmpty()) {
+					// Unknown characters are escaped in hexadecimal
+					text = QStringLiteral("{x%1}").arg(QString::fromLatin1(ff8.toHex()));
+				} else if (text.size() == 1 && !firstCodes.contains(text)) {
+					firstCodes.insert(text, ff8);
+				}
+
+				QTest::addRow("%s table %d 0x%02x", qPrintable(fontName), table, ord)
+				        << fontName << ff8 << text << firstCodes.value(text, ff8);
+			}
+		}
+	}
+}
+
+void FF8TextCodecTest::characters()
+{
+	QFETCH(QString, fontName);
+	QFETCH(QByteArray, ff8);
+	QFETCH(QString, text);
+	QFETCH(QByteArray, expected);
+
+	QSharedPointer<const FF8TextCodec> codec = FF8Font::font(fontName)->codec();
+
+	QCOMPARE(codec->fromFF8(ff8), text);
+	QCOMPARE(codec->toFF8(text), expected);
+	QCOMPARE(codec->fromFF8(expected), text);
+}
+
+void FF8TextCodecTest::strings_data()
+{
+	QTest::addColumn<QString>("fontName");
+	QTest::addColumn<QByteArray>("ff8");
+	QTest::addColumn<QString>("text");
+
+	QTest::newRow("latin letters") << "00" << QByteArray("\x45\x46\x20\x31\x7f")
+	                               << QString::fromUtf8("AB +É");
+	QTest::newRow("pages and lines") << "00" << QByteArray("\x45\x01\x46\x02\x47")
+	                                 << "A\n{NewPage}\nB\nC";
+	QTest::newRow("names") << "00" << QByteArray("\x03\x30\x03\x3a\x03\x40\x03\x50\x03\x60")
+	                       << "{Squall}{Ward}{Angelo}{Griever}{Boko}";
+	QTest::newRow("colors and locations") << "00" << QByteArray("\x06\x22\x06\x2f\x0e\x20\x0e\x27")
+	                                      << "{Yellow}{WhiteBlink}{Galbadia}{Horizon}";
+	QTest::newRow("variables") << "00" << QByteArray("\x04\x21\x04\x33\x04\x47")
+	                           << "{Var1}{Var03}{Varb7}";
+	QTest::newRow("wait and jp") << "00" << QByteArray("\x09\x25\x09\xff\x1c\x20\x1c\x43")
+	                             << "{Wait005}{Wait223}{Jp000}{Jp035}";
+	QTest::newRow("duos") << "00" << QByteArray("\x45\xe8\xe9\xed\xfe\xff")
+	                      << "A{in}{e }{HP}{ S}{ag}";
+	QTest::newRow("unknown name") << "00" << QByteArray("\x03\x99") << "{x0399}";
+	QTest::newRow("unknown variable") << "00" << QByteArray("\x04\x50") << "{x0450}";
+	QTest::newRow("unknown color") << "00" << QByteArray("\x06\x30") << "{x0630}";
+	QTest::newRow("unknown location") << "00" << QByteArray("\x0e\x28") << "{x0e28}";
+	QTest::newRow("unknown wait") << "00" << QByteArray("\x09\x10") << "{x0910}";
+	QTest::newRow("unknown jp") << "00" << QByteArray("\x1c\x10") << "{x1c10}";
+	QTest::newRow("unknown opcodes") << "00" << QByteArray("\x05\x20\x1f\xff") << "{x0520}{x1fff}";
+	QTest::newRow("unknown character") << "00" << QByteArray("\xa8\x45") << "{xa8}A";
+	QTest::newRow("truncated opcode") << "00" << QByteArray("\x45\x03") << "A{x03}";
+	QTest::newRow("jp tables") << "01" << QByteArray("\x20\x19\x20\x1a\x20\x1b\x20")
+	                           << QString::fromUtf8("バｅ頭洞");
+	QTest::newRow("jp unknown character") << "01" << QByteArray("\x1b\xf0") << "{x1bf0}";
+	QTest::newRow("jp truncated table") << "01" << QByteArray("\x20\x19") << QString::fromUtf8("バ{x19}");
+}
+
+void FF8TextCodecTest::strings()
+{
+	QFETCH(QString, fontName);
+	QFETCH(QByteArray, ff8);
+	QFETCH(QString, text);
+
+	QSharedPointer<const FF8TextCodec> codec = FF8Font::font(fontName)->codec();
+
+	QCOMPARE(codec->fromFF8(ff8), text);
+	QCOMPARE(codec->toFF8(text), ff8);
+}
+
+QTEST_GUILESS_MAIN(FF8TextCodecTest)
+#include "FF8TextCodecTest.moc"
@@ -0,0 +1,210 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include <QtTest>
+#include "ArchiveObserver.h"
+#include "Config.h"
+#include "FieldArchiveCache.h"
+#include "FieldArchivePC.h"
+#include "files/MsdFile.h"
+
+struct NullObserver : public ArchiveObserver
+{
+	bool observerWasCanceled() const override { return false; }
+	void setObserverCanCancel(bool canCancel) const override { Q_UNUSED(canCancel) }
+	void setObserverMaximum(unsigned int max) override { Q_UNUSED(max) }
+	void setObserverValue(int value) override { Q_UNUSED(value) }
+};
+
+class FieldArchiveCacheTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+	void init();
+	void saveInvalidatesSavedFieldsOnly_data();
+	void saveInvalidatesSavedFieldsOnly();
+private:
+	static QByteArray msd(const QList<QByteArray> &texts);
+	static bool writeArchive(const QString &path, const QList<QPair<QString, QByteArray>> &entries);
+	bool writeFieldArchive(const QString &path);
+	static QStringList cachedFields(const QString &path);
+	static QByteArray firstText(const FieldArchivePC &archive, const QString &name);
+	QTemporaryDir dir;
+};
+
+void FieldArchiveCacheTest::initTestCase()
+{
+	QStandardPaths::setTestModeEnabled(true);
+	Config::set();
+	Config::setValue("gameLang", "en");
+	Config::setValue("encoding", "00");
+	Config::setValue("fieldCache", true);
+	Config::setValue("lazyOpen", false);
+	QVERIFY(dir.isValid());
+}
+
+void FieldArchiveCacheTest::cleanupTestCase()
+{
+	QDir(FieldArchiveCache::cacheDirectory()).removeRecursively();
+	Config::remove();
+}
+
+void FieldArchiveCacheTest::init()
+{
+	QDir(FieldArchiveCache::cacheDirectory()).removeRecursively();
+	QVERIFY(writeFieldArchive(dir.filePath("field.f")));
+}
+
+void FieldArchiveCacheTest::saveInvalidatesSavedFieldsOnly_data()
+{
+	QTest::addColumn<bool>("incrementalSave");
+
+	QTest::newRow("full") << false;
+	QTest::newRow("incremental") << true;
+}
+
+void FieldArchiveCacheTest::saveInvalidatesSavedFieldsOnly()
+{
+	QFETCH(bool, incrementalSave);
+	Config::setValue("incrementalSave", incrementalSave);
+
+	const QString path = dir.filePath("field.f");
+	NullObserver observer;
+
+	{
+		FieldArchivePC archive;
+		QCOMPARE(archive.open(path + "s", &observer), 0);
+		QCOMPARE(archive.nbFields(), 2);
+		QCOMPARE(cachedFields(path), QStringList({"aa1", "bb1"}));
+
+		for (Field *field: archive.getFields()) {
+			if (field->name() == "aa1") {
+				field->getMsdFile()->setTexts(QList<QByteArray>() << "modified text" << "second");
+			}
+		}
+
+		QVERIFY(archive.save(&observer, QString()));
+		QCOMPARE(cachedFields(path), QStringList({"bb1"}));
+	}
+
+	// The saved field is read from the archive, the other one from the cache
+	FieldArchivePC archive;
+	QCOMPARE(archive.open(path + "s", &observer), 0);
+	QCOMPARE(archive.nbFields(), 2);
+	QCOMPARE(firstText(archive, "aa1"), QByteArray("modified text"));
+	QCOMPARE(firstText(archive, "bb1"), QByteArray("bb1 text"));
+	QCOMPARE(cachedFields(path), QStringList({"aa1", "bb1"}));
+}
+
+QByteArray FieldArchiveCacheTest::msd(const QList<QByteArray> &texts)
+{
+	QByteArray offsets, data;
+
+	for (const QByteArray &text: texts) {
+		quint32 pos = texts.size() * 4 + data.size();
+		offsets.append((const char *)&pos, 4);
+		data.append(text);
+		data.append('\0');
+	}
+
+	return offsets + data;
+}
+
+bool FieldArchiveCacheTest::writeArchive(const QString &path, const QList<QPair<QString, QByteArray>> &entries)
+{
+	QFile fs(FsArchive::fsPath(path)), fl(FsArchive::flPath(path)), fi(FsArchive::fiPath(path));
+
+	if (!fs.open(QIODevice::WriteOnly | QIODevice::Truncate)
+	        || !fl.open(QIODevice::WriteOnly | QIODevice::Truncate)
+	        || !fi.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return false;
+	}
+
+	for (const QPair<QString, QByteArray> &entry: entries) {
+		Fi_infos infos;
+		infos.size = entry.second.size();
+		infos.pos = fs.pos();
+		infos.compression = CompressionNone;
+
+		if (fs.write(entry.second) != entry.second.size()
+		        || fl.write(entry.first.toLatin1() + "\r\n") < 0
+		        || fi.write((const char *)&infos, sizeof(infos)) != sizeof(infos)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FieldArchiveCacheTest::writeFieldArchive(const QString &path)
+{
+	const QString mapData("C:\\ff8\\Data\\eng\\FIELD\\mapdata\\");
+	QList<QPair<QString, QByteArray>> fieldEntries;
+
+	for (const QString &name: QStringList({"aa1", "bb1"})) {
+		const QString dirPath = mapData % name.left(2) % "\\" % name;
+		const QString innerPath = dir.filePath(name % ".f");
+
+		if (!writeArchive(innerPath, {{QString(dirPath % "\\" % name % ".msd"), msd({name.toLatin1() + " text"})}})) {
+			return false;
+		}
+
+		for (const QString &ext: QStringList({"fs", "fl", "fi"})) {
+			QFile f(innerPath.left(innerPath.size() - 1) % ext);
+
+			if (!f.open(QIODevice::ReadOnly)) {
+				return false;
+			}
+
+			fieldEntries.append({QString(dirPath % "." % ext), f.readAll()});
+		}
+	}
+
+	return writeArchive(path, fieldEntries);
+}
+
+QStringList FieldArchiveCacheTest::cachedFields(const QString &path)
+{
+	FieldArchiveCache cache(path, Config::value("gameLang").toString());
+	QStringList names;
+
+	if (cache.open()) {
+		for (const FieldArchiveCache::Entry &entry: cache.entries()) {
+			names.append(entry.name);
+		}
+	}
+
+	names.sort();
+
+	return names;
+}
+
+QByteArray FieldArchiveCacheTest::firstText(const FieldArchivePC &archive, const QString &name)
+{
+	for (Field *field: archive.getFields()) {
+		if (field->name() == name && field->hasMsdFile()) {
+			return field->getMsdFile()->data(0);
+		}
+	}
+
+	return QByteArray();
+}
+
+QTEST_GUILESS_MAIN(FieldArchiveCacheTest)
+#include "FieldArchiveCacheTest.moc"
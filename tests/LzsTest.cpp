@@ -0,0 +1,230 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include <QtTest>
+#include "LZS.h"
+
+#define GUARD_SIZE  64
+#define GUARD_BYTE  char(0xA5)
+
+Q_DECLARE_METATYPE(LzsEncoder::Level)
+
+/*
+ * Round trips at every level, and decoding of truncated, corrupted and
+ * random data: the decoder must stop cleanly, inside its buffers.
+ */
+class LzsTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void roundTrip_data();
+	void roundTrip();
+	void maxSize();
+	void fixedOutput();
+	void truncated_data();
+	void truncated();
+	void corrupted();
+	void randomInput();
+private:
+	static QByteArray randomData(QRandomGenerator &random, int size, int alphabet);
+	static QByteArray compress(const QByteArray &data, LzsEncoder::Level level);
+	static QByteArray decompress(const QByteArray &data, int max = std::numeric_limits<int>::max());
+	static void checkBounds(const QByteArray &data, int max);
+};
+
+void LzsTest::roundTrip_data()
+{
+	QTest::addColumn<LzsEncoder::Level>("level");
+	QTest::addColumn<QByteArray>("data");
+
+	QRandomGenerator random(0x125);
+	const QList<int> sizes = {0, 1, 2, 3, 17, 18, 19, 4095, 4096, 4097, 70000};
+	const QList<QPair<const char *, LzsEncoder::Level> > levels = {
+	    {"fast", LzsEncoder::Fast}, {"normal", LzsEncoder::Normal}, {"best", LzsEncoder::Best}
+	};
+
+	for (const QPair<const char *, LzsEncoder::Level> &level: levels) {
+		for (int size: sizes) {
+			QTest::addRow("%s random %d", level.first, size) << level.second << randomData(random, size, 256);
+			QTest::addRow("%s text %d", level.first, size) << level.second << randomData(random, size, 4);
+			// The window starts filled with zeros
+			QTest::addRow("%s zeros %d", level.first, size) << level.second << QByteArray(size, '\0');
+			QTest::addRow("%s runs %d", level.first, size) << level.second << QByteArray(size, 'a');
+		}
+	}
+}
+
+void LzsTest::roundTrip()
+{
+	QFETCH(LzsEncoder::Level, level);
+	QFETCH(QByteArray, data);
+
+	QByteArray compressed = compress(data, level);
+
+	QCOMPARE(decompress(compressed), data);
+}
+
+void LzsTest::maxSize()
+{
+	QRandomGenerator random(0x5A);
+	QByteArray data = randomData(random, 20000, 8),
+	        compressed = compress(data, LzsEncoder::Normal);
+
+	for (int max: {0, 1, 17, 18, 1000, 19999, 20000, 30000}) {
+		QByteArray out = decompress(compressed, max);
+
+		// Decoding stops between two tokens, after max
+		QVERIFY(out.size() >= qMin(max, int(data.size())));
+		QVERIFY(out.size() <= qMin(max, int(data.size())) + 18);
+		QVERIFY(data.startsWith(out));
+	}
+}
+
+void LzsTest::fixedOutput()
+{
+	QRandomGenerator random(0x77);
+	QByteArray data = randomData(random, 5000, 16),
+	        compressed = compress(data, LzsEncoder::Best);
+	LzsDecoder decoder;
+
+	for (int outSize: {1, 2, 3, 18, 19, 2500, 5000, 6000}) {
+		QByteArray out(outSize + GUARD_SIZE, GUARD_BYTE);
+		int written = decoder.decompress(compressed.constData(), int(compressed.size()), out.data(), outSize);
+
+		QCOMPARE(written, qMin(outSize, int(data.size())));
+		QCOMPARE(out.left(written), data.left(written));
+		QCOMPARE(out.mid(outSize), QByteArray(GUARD_SIZE, GUARD_BYTE));
+	}
+}
+
+void LzsTest::truncated_data()
+{
+	QTest::addColumn<LzsEncoder::Level>("level");
+
+	QTest::newRow("fast") << LzsEncoder::Fast;
+	QTest::newRow("normal") << LzsEncoder::Normal;
+	QTest::newRow("best") << LzsEncoder::Best;
+}
+
+void LzsTest::truncated()
+{
+	QFETCH(LzsEncoder::Level, level);
+
+	QRandomGenerator random(0x3C);
+	QByteArray data = randomData(random, 3000, 6),
+	        compressed = compress(data, level);
+
+	for (int size = 0; size < compressed.size(); ++size) {
+		QByteArray out = decompress(compressed.left(size));
+
+		// A reference cut after its first byte is decoded with a length of 3
+		QVERIFY2(data.startsWith(out) || data.startsWith(out.chopped(qMin(3, int(out.size())))),
+		         qPrintable(QString("size %1").arg(size)));
+		checkBounds(compressed.left(size), std::numeric_limits<int>::max());
+	}
+}
+
+void LzsTest::corrupted()
+{
+	QRandomGenerator random(0xC0);
+	QByteArray data = randomData(random, 8000, 4),
+	        compressed = compress(data, LzsEncoder::Normal);
+
+	for (int i = 0; i < 500; ++i) {
+		QByteArray corrupted = compressed;
+
+		for (int j = random.bounded(1, 8); j > 0; --j) {
+			corrupted[random.bounded(int(corrupted.size()))] = char(random.bounded(256));
+		}
+
+		checkBounds(corrupted, int(data.size()));
+		checkBounds(corrupted, std::numeric_limits<int>::max());
+	}
+}
+
+void LzsTest::randomInput()
+{
+	QRandomGenerator random(0xF00D);
+
+	for (int i = 0; i < 1000; ++i) {
+		checkBounds(randomData(random, random.bounded(2000), 256), std::numeric_limits<int>::max());
+	}
+}
+
+QByteArray LzsTest::randomData(QRandomGenerator &random, int size, int alphabet)
+{
+	QByteArray data(size, '\0');
+
+	for (int i = 0; i < size; ++i) {
+		data[i] = char('a' + random.bounded(alphabet));
+	}
+
+	return data;
+}
+
+QByteArray LzsTest::compress(const QByteArray &data, LzsEncoder::Level level)
+{
+	LzsEncoder encoder;
+	QByteArray out;
+
+	if (!encoder.compress(data.constData(), int(data.size()), out, level)) {
+		qWarning() << "LzsTest::compress error";
+	}
+
+	return out;
+}
+
+QByteArray LzsTest::decompress(const QByteArray &data, int max)
+{
+	LzsDecoder decoder;
+	QByteArray out;
+
+	if (!decoder.decompress(data.constData(), int(data.size()), out, max)) {
+		qWarning() << "LzsTest::decompress error";
+	}
+
+	return out;
+}
+
+/*
+ * The bytes after the input must not change the output, and the output
+ * is at most 9 bytes per input byte (8 references of 18 bytes behind a flag byte).
+ */
+void LzsTest::checkBounds(const QByteArray &data, int max)
+{
+	QByteArray padded1 = data + QByteArray(GUARD_SIZE, '\0'),
+	        padded2 = data + QByteArray(GUARD_SIZE, '\xff');
+	LzsDecoder decoder;
+	QByteArray out1, out2;
+
+	QVERIFY(decoder.decompress(padded1.constData(), int(data.size()), out1, max));
+	QVERIFY(decoder.decompress(padded2.constData(), int(data.size()), out2, max));
+	QCOMPARE(out1, out2);
+	QVERIFY(out1.size() <= qMin(qint64(data.size()) * 9, qint64(max) + 18));
+
+	// Same output with a buffer of the exact size, and nothing written after it
+	const int outSize = int(qMin(out1.size(), qsizetype(max)));
+	QByteArray buffer(outSize + GUARD_SIZE, GUARD_BYTE);
+	int written = decoder.decompress(data.constData(), int(data.size()), buffer.data(), outSize);
+
+	QCOMPARE(written, outSize);
+	QCOMPARE(buffer.left(written), out1.left(written));
+	QCOMPARE(buffer.mid(outSize), QByteArray(GUARD_SIZE, GUARD_BYTE));
+}
+
+QTEST_GUILESS_MAIN(LzsTest)
+#include "LzsTest.moc"
@@ -0,0 +1,155 @@
+/****************************************************************************
+ ** Deling Final Fantasy VIII Field Editor
+ ** Copyright (C) 2009-2024 Arzel Jérôme <myst6re@gmail.com>
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include <QtTest>
+#include "TextLayout.h"
+#include "files/TdwFile.h"
+
+/*
+ * Window sizes measured by TextLayout, with fonts where every character
+ * has the same width.
+ */
+class TextLayoutTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void pageSizes_data();
+	void pageSizes();
+	void pagesPos();
+	void fieldFont();
+	void fitsOnScreen_data();
+	void fitsOnScreen();
+private:
+	static QByteArray tdw(quint8 charWidth);
+	TdwFile _font, _fieldFont;
+};
+
+void TextLayoutTest::initTestCase()
+{
+	QVERIFY(_font.open(tdw(10)));
+	QVERIFY(_fieldFont.open(tdw(5)));
+	QCOMPARE(_font.tableCount(), 1);
+	QCOMPARE(_font.charWidth(0, 0x21), quint8(10));
+}
+
+void TextLayoutTest::pageSizes_data()
+{
+	QTest::addColumn<QByteArray>("text");
+	QTest::addColumn<int>("askFirst");
+	QTest::addColumn<int>("askLast");
+	QTest::addColumn<QList<QSize> >("sizes");
+
+	QTest::newRow("empty") << QByteArray() << -1 << -1 << QList<QSize>({QSize(15, 28)});
+	QTest::newRow("characters") << QByteArray("\x40\x41") << -1 << -1 << QList<QSize>({QSize(35, 28)});
+	QTest::newRow("end of string") << QByteArray("\x40\x00\x41", 3) << -1 << -1 << QList<QSize>({QSize(25, 28)});
+	QTest::newRow("lines") << QByteArray("\x40\x02\x40\x40") << -1 << -1 << QList<QSize>({QSize(35, 44)});
+	QTest::newRow("pages") << QByteArray("\x40\x01\x40\x40\x40") << -1 << -1
+	                       << QList<QSize>({QSize(25, 28), QSize(45, 28)});
+	QTest::newRow("first line asked") << QByteArray("\x40\x02\x40") << 0 << 0 << QList<QSize>({QSize(89, 44)});
+	QTest::newRow("second line asked") << QByteArray("\x40\x02\x40") << 1 << 1 << QList<QSize>({QSize(89, 44)});
+	QTest::newRow("name") << QByteArray("\x03\x30") << -1 << -1 << QList<QSize>({QSize(45, 28)});
+	QTest::newRow("variable") << QByteArray("\x04\x40") << -1 << -1 << QList<QSize>({QSize(95, 28)});
+	QTest::newRow("location") << QByteArray("\x0e\x20") << -1 << -1 << QList<QSize>({QSize(35, 28)});
+	QTest::newRow("icon") << QByteArray("\x05\x20") << -1 << -1 << QList<QSize>({QSize(32, 28)});
+	QTest::newRow("optimised duo") << QByteArray("\xe8") << -1 << -1 << QList<QSize>({QSize(35, 28)});
+	QTest::newRow("control code") << QByteArray("\x06\x40\x40") << -1 << -1 << QList<QSize>({QSize(25, 28)});
+	QTest::newRow("truncated name") << QByteArray("\x40\x03") << -1 << -1 << QList<QSize>({QSize(25, 28)});
+}
+
+void TextLayoutTest::pageSizes()
+{
+	QFETCH(QByteArray, text);
+	QFETCH(int, askFirst);
+	QFETCH(int, askLast);
+	QFETCH(QList<QSize>, sizes);
+
+	// Names are 3 characters long, locations 2
+	TextLayout layout(&_font, QList<QByteArray>(14, "\x40\x40\x40"), QList<QByteArray>(8, "\x40\x40"));
+
+	QCOMPARE(layout.pageSizes(text, askFirst, askLast), sizes);
+}
+
+void TextLayoutTest::pagesPos()
+{
+	TextLayout layout(&_font, QList<QByteArray>(), QList<QByteArray>());
+	QList<int> pagesPos;
+
+	QCOMPARE(layout.pageSizes(QByteArray("\x40\x01\x40\x02\x40\x01"), -1, -1, &pagesPos).size(), 3);
+	QCOMPARE(pagesPos, QList<int>({0, 2, 6}));
+}
+
+void TextLayoutTest::fieldFont()
+{
+	TextLayout layout(&_font, QList<QByteArray>(), QList<QByteArray>());
+	const QByteArray text("\x1c\x20");
+
+	// Without field font, the argument is measured as a character
+	QCOMPARE(layout.pageSizes(text), QList<QSize>({QSize(25, 28)}));
+
+	layout.setFieldFont(&_fieldFont);
+	QCOMPARE(layout.pageSizes(text), QList<QSize>({QSize(20, 28)}));
+
+	layout.setFieldFont(nullptr);
+	QCOMPARE(layout.pageSizes(text), QList<QSize>({QSize(25, 28)}));
+}
+
+void TextLayoutTest::fitsOnScreen_data()
+{
+	QTest::addColumn<QSize>("size");
+	QTest::addColumn<bool>("fits");
+
+	QTest::newRow("small") << QSize(15, 28) << true;
+	QTest::newRow("largest") << QSize(304, 215) << true;
+	QTest::newRow("too wide") << QSize(305, 215) << false;
+	QTest::newRow("too high") << QSize(304, 216) << false;
+}
+
+void TextLayoutTest::fitsOnScreen()
+{
+	QFETCH(QSize, size);
+	QFETCH(bool, fits);
+
+	QCOMPARE(TextLayout::fitsOnScreen(size), fits);
+}
+
+QByteArray TextLayoutTest::tdw(quint8 charWidth)
+{
+	QByteArray data;
+	// One table of 224 widths, stored in 4 bits each
+	const quint32 posHeader = 8, posData = posHeader + 112;
+	// 4-bit TIM of 4x1 pixels, with 8 palettes of 16 colors
+	const quint32 palSize = 12 + 8 * 16 * 2, imgSize = 12 + 2;
+	const quint16 palRect[4] = {0, 0, 16, 8}, imgRect[4] = {0, 0, 1, 1};
+
+	data.append((const char *)&posHeader, 4);
+	data.append((const char *)&posData, 4);
+	data.append(QByteArray(112, char((charWidth << 4) | charWidth)));
+
+	data.append("\x10\x00\x00\x00\x08\x00\x00\x00", 8);
+	data.append((const char *)&palSize, 4);
+	data.append((const char *)palRect, 8);
+	data.append(QByteArray(8 * 16 * 2, '\0'));
+	data.append((const char *)&imgSize, 4);
+	data.append((const char *)imgRect, 8);
+	data.append(QByteArray(2, '\0'));
+
+	return data;
+}
+
+QTEST_GUILESS_MAIN(TextLayoutTest)
+#include "TextLayoutTest.moc"